@@ -5,258 +5,119 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <dirent.h>
+#include <getopt.h>
 #include <string.h>
+#include <time.h>
+#include <limits.h>
 #include <stdint.h>
 #include <inttypes.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <arpa/inet.h>
-#include "tze_tz.h"
 #include "tze_err.h"
-#include "tze_list.h"
+#include "tze_tz.h"
+#include "tze_csrc.h"
+#include "tze_compact.h"
+#include "tze_diff.h"
+#include "tze_equiv.h"
 #include "tze_rule.h"
-#include "tze_name.h"
-#include "tze_dentry.h"
+#include "tze_list.h"
+#include "tze_scan.h"
+#include "tze_index.h"
+#include "tze_serve.h"
+#include "tze_query.h"
+#include "tze_reverse.h"
+#include "tze_shm.h"
+#include "tze_next.h"
+#include "tze_out.h"
+#include "tze_slim.h"
+#include "tze_stream.h"
+#include "tze_trace.h"
+#include "tze_trans.h"
 #include "tze_version.h"
 #include "tze_locality.h"
 
 #define TZE_DEF_SEP						';'
 #define TZE_CHR_SPACE					0x20
-#define TZE_LOCALITY_MAX				PATH_MAX
 #define TZE_SYSERROR_MAX				128
 
-enum scan_t {
-	SCAN_FILES,
-	SCAN_LINKS
+#define TZE_ROOT_MAX					(16)
+#define TZE_EXIT_CHANGED				(2)
+#define TZE_LINE_MIN					(1024)
+
+enum tze_opt_t {
+	TZE_OPT_INCLUDE = 0x100,
+	TZE_OPT_EXCLUDE,
+	TZE_OPT_DUPLICATES,
+	TZE_OPT_DIFF,
+	TZE_OPT_APPLY,
+	TZE_OPT_SERVE,
+	TZE_OPT_CLIENT,
+	TZE_OPT_PUBLISH,
+	TZE_OPT_LOOKUP,
+	TZE_OPT_EXPAND,
+	TZE_OPT_TRIE,
+	TZE_OPT_SLIM,
+	TZE_OPT_WINDOW,
+	TZE_OPT_SINCE,
+	TZE_OPT_COUNT,
+	TZE_OPT_CANONICAL_RULES,
+	TZE_OPT_FOLD_EQUAL,
+	TZE_OPT_READAHEAD,
+	TZE_OPT_JOBS,
+	TZE_OPT_INDEX,
+	TZE_OPT_TRACE,
+	TZE_OPT_STREAM,
+	TZE_OPT_REGROUP
 };
 
-static int tze_extract(const char		 *const file_name,
-					   const char		 *const locality,
-					   const char		  sep,
-					   const enum scan_t  scan,
-					   struct tze_list_t *loc_list,
-					   struct tze_err_t	 *err)
-{
-	char *rule = NULL;
-	bool v3 = false;
-	int ret = tze_tz_read(file_name, locality, &rule, &v3, err);
-
-	if (ret != 0) {
-		if (ret < 0) {
-			return -1;
-		}
-		/* unknown file format, skip an entry */
-		return 0;
-	}
-
-	ret = -1;
-
-	if (tze_rule_check(rule, locality, v3, err) < 0) {
-		goto free_rule;
-	}
-
-	if (tze_name_has_sep(rule, strlen(rule), sep)) {
-		tze_err_set(err, 0,
-					"%s: a timezone rule \"%s\" contains \"%c\" separator",
-					locality, rule, sep);
-		goto free_rule;
-	}
-
-	if (tze_name_has_sep(locality, strlen(locality), sep)) {
-		tze_err_set(err, 0,
-					"%s: a timezone locality contains \"%c\" separator",
-					locality, sep);
-		goto free_rule;
-	}
-
-	char *target_file = NULL;
-
-	if (scan == SCAN_FILES) {
-		struct tze_locality_t *loc = tze_locality_alloc(locality, rule);
-
-		if (loc == NULL) {
-			tze_err_set(err, errno,
-						"%s: unable to allocate a locality", locality);
-			goto free_rule;
-		}
-
-		tze_list_add_tail(loc_list, &loc->list);
-	} else {
-		target_file = realpath(file_name, NULL);
-
-		if (target_file == NULL) {
-			tze_err_set(err, errno,
-						"%s: unable to read a symlink target", locality);
-			goto free_rule;
-		}
-
-		const size_t file_name_size = strlen(file_name);
-		const size_t locality_size = strlen(locality);
-
-		if (file_name_size <= locality_size + 1) {
-			tze_err_set(err, 0, "%s: invalid file name: \"%s\"",
-						locality, file_name);
-			goto free_target_file;
-		}
-
-		const size_t target_file_size = strlen(target_file);
-		const size_t root_size = file_name_size - locality_size;
-
-		if (target_file_size <= root_size ||
-			memcmp(target_file, file_name, root_size) != 0) {
-			tze_err_set(err, 0,
-						"%s: a symlink points out of "
-						"the timezone root directory", locality);
-			goto free_target_file;
-		}
-
-		const char *const target = target_file + root_size;
-		struct tze_locality_t *loc, *target_loc = NULL;
-
-		tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
-			if (strcmp(loc->name, target) == 0) {
-				target_loc = loc;
-				break;
-			}
-		}
-
-		if (target_loc == NULL) {
-			tze_err_set(err, errno,
-						"%s: no \"%s\" target found in a timezone list",
-						locality, target);
-			goto free_target_file;
-		}
-
-		if (tze_locality_add_link(target_loc, sep, locality) != 0) {
-			tze_err_set(err, errno,
-						"%s: unable to add a link for \"%s\" target",
-						locality, target);
-			goto free_target_file;
-		}
-	}
-
-	ret = 0;
-
-free_target_file:
-	free(target_file);
-
-free_rule:
-	free(rule);
-	return ret;
-}
-
-static int tze_filter(const struct dirent *const e)
-{
-	if (e->d_name[0] == '.') {
-		if (e->d_name[1] == '\0') {
-			return 0;
-		}
-
-		if (e->d_name[1] == '.' && e->d_name[2] == '\0') {
-			return 0;
-		}
-	}
-
-	return 1;
-}
-
-static int tze_compar(const struct dirent **l,
-					  const struct dirent **r)
-{
-	return strcoll((*l)->d_name, (*r)->d_name);
-}
-
-static int tze_scan_dir(const char			*const dir_name,
-						const size_t		 root_size,
-						const char			 sep,
-						const enum scan_t	 scan,
-						struct tze_dentry_t	*dentry,
-						struct tze_list_t	*loc_list,
-						struct tze_err_t	*err)
-{
-	int ret = -1;
-	int is_root = (strlen(dir_name) == root_size);
-	struct dirent **namelist;
-	const int n = scandir(dir_name, &namelist, tze_filter, tze_compar);
-
-	if (n < 0) {
-		tze_err_set(err, errno, "failed to list \"%s\" subdirectory",
-					is_root ? "." : (dir_name + root_size));
-		return ret;
-	}
-
-	size_t i = 0;
-
-	for (; i < (size_t) n; i++) {
-		const char *const d_name = namelist[i]->d_name;
-
-		if (tze_dentry_set(dentry, dir_name, d_name) < 0) {
-			tze_err_set(err, errno,
-						"%s%s%s: unable to create a directory entry name",
-						is_root ? "" : dir_name + root_size,
-						is_root ? "" : "/",
-						d_name);
-			goto free_namelist;
-		}
-
-		struct stat st;
-		const char *const locality = tze_dentry_name(dentry) + root_size + 1;
-
-		if (lstat(tze_dentry_name(dentry), &st) < 0) {
-			tze_err_set(err, errno,
-						"failed to get \"%s\" "
-						"directory entry information",
-						locality);
-			goto free_namelist;
-		}
-
-		if (S_ISDIR(st.st_mode)) {
-			struct tze_dentry_t sub_dentry = TZE_DENTRY_INIT;
-			const int scan_ret = tze_scan_dir(tze_dentry_name(dentry),
-											  root_size, sep, scan,
-											  &sub_dentry, loc_list, err);
-
-			tze_dentry_free(&sub_dentry);
-
-			if (scan_ret < 0) {
-				goto free_namelist;
-			}
-		} else if (S_ISREG(st.st_mode) || S_ISLNK(st.st_mode)) {
-			const bool is_link = S_ISLNK(st.st_mode);
-
-			if (((scan == SCAN_FILES) && !is_link) ||
-				((scan == SCAN_LINKS) &&  is_link)) {
-				if (strlen(locality) > TZE_LOCALITY_MAX) {
-					tze_err_set(err, 0, "%s: a locality name is too long",
-								locality);
-					goto free_namelist;
-				}
-
-				if (tze_extract(tze_dentry_name(dentry), locality,
-								sep, scan, loc_list, err) < 0) {
-					goto free_namelist;
-				}
-			}
-		} else {
-			/* not a regular file, symlink or directory */
-			tze_err_set(err, 0, "%s: unsupported filesystem node type",
-						locality);
-			goto free_namelist;
-		}
-
-		free(namelist[i]);
-	}
-
-	ret = 0;
+enum tze_mode_t {
+	TZE_MODE_TABLE,						/* print a locality table		 */
+	TZE_MODE_DIFF,						/* print a patch between trees	 */
+	TZE_MODE_APPLY,						/* apply a patch to a table file */
+	TZE_MODE_SERVE,						/* serve lookups over a socket	 */
+	TZE_MODE_CLIENT,					/* query a lookup server		 */
+	TZE_MODE_PUBLISH,					/* publish to shared memory		 */
+	TZE_MODE_LOOKUP,					/* look up in shared memory		 */
+	TZE_MODE_EXPAND,					/* decode a compact table		 */
+	TZE_MODE_SLIM,						/* rewrite files to a mirror	 */
+	TZE_MODE_QUERY,						/* print a single locality		 */
+	TZE_MODE_STREAM,					/* print records while scanning	 */
+	TZE_MODE_REGROUP					/* group streamed records		 */
+};
 
-free_namelist:
-	for (; i < (size_t) n; i++) {
-		free(namelist[i]);
-	}
+enum tze_format_t {
+	TZE_FORMAT_TEXT,					/* name;links;rule lines		 */
+	TZE_FORMAT_C,						/* a C source with a lookup		 */
+	TZE_FORMAT_COMPACT,					/* front-coded names and rules	 */
+	TZE_FORMAT_REVERSE,					/* localities by rule fields	 */
+	TZE_FORMAT_TRANSITIONS,				/* full transition tables		 */
+	TZE_FORMAT_NEXT						/* upcoming transitions			 */
+};
 
-	free(namelist);
-	return ret;
-}
+struct tze_args_t {
+	enum tze_mode_t			mode;
+	enum tze_format_t		format;
+	bool					trie;
+	bool					fold;
+	const char			   *roots[TZE_ROOT_MAX];
+	size_t					root_count;
+	const char			   *patch;
+	const char			   *table;
+	const char			   *index;
+	const char			   *trace;
+	const char			   *out;
+	const char			   *socket;
+	const char			   *shm;
+	const char			   *out_dir;
+	int						from_year;
+	int						until_year;
+	int64_t					since;
+	size_t					count;
+	char					query_op;
+	const char			   *query;
+	struct tze_scan_conf_t	conf;
+};
 
 static int tze_check_sep(const char		   sep,
 						 struct tze_err_t *err)
@@ -307,17 +168,73 @@ static void tze_show_error(const struct tze_err_t *err,
 static int
 tze_get_args(int			    argc,
 			 char			  **argv,
-			 const char		  **root,
-			 char			   *sep,
+			 struct tze_args_t *args,
 			 struct tze_err_t  *err)
 {
-	*root = NULL;
-	*sep = TZE_DEF_SEP;
+	static const struct option LONG_OPTIONS[] = {
+		{ "include", required_argument, NULL, TZE_OPT_INCLUDE },
+		{ "exclude", required_argument, NULL, TZE_OPT_EXCLUDE },
+		{ "duplicates", required_argument, NULL, TZE_OPT_DUPLICATES },
+		{ "diff", no_argument, NULL, TZE_OPT_DIFF },
+		{ "apply", no_argument, NULL, TZE_OPT_APPLY },
+		{ "serve", required_argument, NULL, TZE_OPT_SERVE },
+		{ "client", required_argument, NULL, TZE_OPT_CLIENT },
+		{ "publish", required_argument, NULL, TZE_OPT_PUBLISH },
+		{ "lookup", required_argument, NULL, TZE_OPT_LOOKUP },
+		{ "expand", required_argument, NULL, TZE_OPT_EXPAND },
+		{ "trie", no_argument, NULL, TZE_OPT_TRIE },
+		{ "slim", required_argument, NULL, TZE_OPT_SLIM },
+		{ "window", required_argument, NULL, TZE_OPT_WINDOW },
+		{ "since", required_argument, NULL, TZE_OPT_SINCE },
+		{ "count", required_argument, NULL, TZE_OPT_COUNT },
+		{ "canonical-rules", no_argument, NULL, TZE_OPT_CANONICAL_RULES },
+		{ "fold-equal", no_argument, NULL, TZE_OPT_FOLD_EQUAL },
+		{ "readahead", required_argument, NULL, TZE_OPT_READAHEAD },
+		{ "jobs", required_argument, NULL, TZE_OPT_JOBS },
+		{ "index", required_argument, NULL, TZE_OPT_INDEX },
+		{ "trace", required_argument, NULL, TZE_OPT_TRACE },
+		{ "stream", no_argument, NULL, TZE_OPT_STREAM },
+		{ "regroup", required_argument, NULL, TZE_OPT_REGROUP },
+		{ NULL, 0, NULL, 0 }
+	};
+	static const struct {
+		const char *name;
+		char		op;
+	} QUERY_OPS[] = {
+		{ "record", TZE_SERVE_OP_RECORD },
+		{ "canonical", TZE_SERVE_OP_CANONICAL },
+		{ "list", TZE_SERVE_OP_PREFIX },
+		{ "complete", TZE_SERVE_OP_COMPLETE }
+	};
+
+	args->mode = TZE_MODE_TABLE;
+	args->format = TZE_FORMAT_TEXT;
+	args->trie = false;
+	args->fold = false;
+	args->root_count = 0;
+	args->patch = NULL;
+	args->table = NULL;
+	args->index = NULL;
+	args->trace = NULL;
+	args->out = NULL;
+	args->socket = NULL;
+	args->shm = NULL;
+	args->out_dir = NULL;
+	args->from_year = TZE_SLIM_DEF_FROM;
+	args->until_year = TZE_SLIM_DEF_UNTIL;
+	args->since = (int64_t) time(NULL);
+	args->count = TZE_NEXT_DEF_COUNT;
+	args->query_op = '\0';
+	args->query = NULL;
+	args->conf = (struct tze_scan_conf_t) TZE_SCAN_CONF_INIT(TZE_DEF_SEP);
 
 	int sep_set = 0;
+	int format_set = 0;
+	int window_set = 0;
+	int next_set = 0;
 
 	while (1) {
-		const int c = getopt(argc, argv, ":d:s:");
+		const int c = getopt_long(argc, argv, ":d:s:f:q:o:", LONG_OPTIONS, NULL);
 
 		if (c == -1) {
 			break;
@@ -325,13 +242,21 @@ tze_get_args(int			    argc,
 
 		switch (c) {
 		case 'd': {
-			if (*root != NULL) {
-				tze_err_set(err, 0, "\"%s\" root directory redefined",
-							*root);
+			for (size_t i = 0; i < args->root_count; i++) {
+				if (strcmp(args->roots[i], optarg) == 0) {
+					tze_err_set(err, 0, "\"%s\" root directory redefined",
+								optarg);
+					goto wrong_args;
+				}
+			}
+
+			if (args->root_count == TZE_ROOT_MAX) {
+				tze_err_set(err, 0, "too many root directories (> %i)",
+							TZE_ROOT_MAX);
 				goto wrong_args;
 			}
 
-			*root = optarg;
+			args->roots[args->root_count++] = optarg;
 			break;
 		}
 
@@ -352,145 +277,1214 @@ tze_get_args(int			    argc,
 				goto wrong_args;
 			}
 
-			*sep = *optarg;
+			args->conf.sep = *optarg;
 			sep_set = 1;
 
 			break;
 		}
 
-		case ':': {
-			switch (optopt) {
-			case 'd': {
+		case 'f': {
+			if (format_set) {
+				tze_err_set(err, 0, "an output format redefined");
+				goto wrong_args;
+			}
+
+			if (strcmp(optarg, "text") == 0) {
+				args->format = TZE_FORMAT_TEXT;
+			} else if (strcmp(optarg, "c") == 0) {
+				args->format = TZE_FORMAT_C;
+			} else if (strcmp(optarg, "compact") == 0) {
+				args->format = TZE_FORMAT_COMPACT;
+			} else if (strcmp(optarg, "reverse") == 0) {
+				args->format = TZE_FORMAT_REVERSE;
+			} else if (strcmp(optarg, "transitions") == 0) {
+				args->format = TZE_FORMAT_TRANSITIONS;
+			} else if (strcmp(optarg, "next") == 0) {
+				args->format = TZE_FORMAT_NEXT;
+			} else {
 				tze_err_set(err, 0,
-							"\"-%c\" option requires a root directory name",
-							(int) optopt);
+							"\"%s\" output format should be "
+							"\"text\", \"c\", \"compact\", \"reverse\", "
+							"\"transitions\" or \"next\"",
+							optarg);
 				goto wrong_args;
 			}
 
-			case 's': {
+			format_set = 1;
+			break;
+		}
+
+		case 'q': {
+			if (args->mode != TZE_MODE_TABLE) {
+				tze_err_set(err, 0, "an operation mode redefined");
+				goto wrong_args;
+			}
+
+			args->mode = TZE_MODE_QUERY;
+			args->query = optarg;
+			break;
+		}
+
+		case 'o': {
+			if (args->out != NULL) {
+				tze_err_set(err, 0, "an output file redefined");
+				goto wrong_args;
+			}
+
+			args->out = optarg;
+			break;
+		}
+
+		case TZE_OPT_INDEX: {
+			if (args->index != NULL) {
+				tze_err_set(err, 0, "an index table file redefined");
+				goto wrong_args;
+			}
+
+			args->index = optarg;
+			break;
+		}
+
+		case TZE_OPT_TRACE: {
+			if (args->trace != NULL) {
+				tze_err_set(err, 0, "a trace file redefined");
+				goto wrong_args;
+			}
+
+			args->trace = optarg;
+			break;
+		}
+
+		case TZE_OPT_TRIE: {
+			args->trie = true;
+			break;
+		}
+
+		case TZE_OPT_CANONICAL_RULES: {
+			args->conf.canon = true;
+			break;
+		}
+
+		case TZE_OPT_FOLD_EQUAL: {
+			args->fold = true;
+			break;
+		}
+
+		case TZE_OPT_INCLUDE:
+		case TZE_OPT_EXCLUDE: {
+			const bool include = (c == TZE_OPT_INCLUDE);
+
+			if (tze_filter_add(&args->conf.filter, include, optarg) < 0) {
+				tze_err_set(err, errno, "unable to add \"%s\" %s pattern",
+							optarg, include ? "include" : "exclude");
+				goto wrong_args;
+			}
+
+			break;
+		}
+
+		case TZE_OPT_DUPLICATES: {
+			if (strcmp(optarg, "link") == 0) {
+				args->conf.dup = TZE_DUP_LINK;
+			} else if (strcmp(optarg, "skip") == 0) {
+				args->conf.dup = TZE_DUP_SKIP;
+			} else {
 				tze_err_set(err, 0,
-							"\"-%c\" option requires "
-							"a description separator",
-							(int) optopt);
+							"\"%s\" duplicate policy should be "
+							"\"link\" or \"skip\"", optarg);
 				goto wrong_args;
 			}
 
-			default:
-				tze_err_set(err, 0, "unknown option \"-%c\"", (int) optopt);
+			break;
+		}
+
+		case TZE_OPT_DIFF:
+		case TZE_OPT_APPLY: {
+			if (args->mode != TZE_MODE_TABLE) {
+				tze_err_set(err, 0, "an operation mode redefined");
 				goto wrong_args;
 			}
+
+			args->mode = (c == TZE_OPT_DIFF) ? TZE_MODE_DIFF : TZE_MODE_APPLY;
+			break;
 		}
 
-		default:
-			tze_err_set(err, 0, "unknown option \"-%c\"", (int) optopt);
-			goto wrong_args;
+		case TZE_OPT_SERVE:
+		case TZE_OPT_CLIENT: {
+			if (args->mode != TZE_MODE_TABLE) {
+				tze_err_set(err, 0, "an operation mode redefined");
+				goto wrong_args;
+			}
+
+			args->mode = (c == TZE_OPT_SERVE) ?
+				TZE_MODE_SERVE : TZE_MODE_CLIENT;
+			args->socket = optarg;
+			break;
 		}
-	}
 
-	if (*root == NULL) {
-		tze_err_set(err, 0, "no root directory specified");
-		goto wrong_args;
-	}
+		case TZE_OPT_PUBLISH:
+		case TZE_OPT_LOOKUP: {
+			if (args->mode != TZE_MODE_TABLE) {
+				tze_err_set(err, 0, "an operation mode redefined");
+				goto wrong_args;
+			}
 
-	if (optind != argc) {
-		tze_err_set(err, 0, "unknown trailing arguments specified");
-		goto wrong_args;
-	}
+			args->mode = (c == TZE_OPT_PUBLISH) ?
+				TZE_MODE_PUBLISH : TZE_MODE_LOOKUP;
+			args->shm = optarg;
+			break;
+		}
 
-	return 0;
+		case TZE_OPT_EXPAND: {
+			if (args->mode != TZE_MODE_TABLE) {
+				tze_err_set(err, 0, "an operation mode redefined");
+				goto wrong_args;
+			}
 
-wrong_args:
-	return -1;
-}
+			args->mode = TZE_MODE_EXPAND;
+			args->table = optarg;
+			break;
+		}
 
-static int tze_show_usage()
-{
-	printf("Timezone extractor utility, v%s.\n"
-		   "\n"
-		   "  -d {root directory}\n"
-		   "  -s {description separator} (default is \"%c\")\n",
-		   TZE_VERSION,
-		   TZE_DEF_SEP);
+		case TZE_OPT_STREAM: {
+			if (args->mode != TZE_MODE_TABLE) {
+				tze_err_set(err, 0, "an operation mode redefined");
+				goto wrong_args;
+			}
 
-	return EXIT_FAILURE;
-}
+			args->mode = TZE_MODE_STREAM;
+			break;
+		}
 
-static int tze_loc_list_scan(struct tze_list_t *loc_list,
-							 const char		   *const root,
-							 const char			sep,
-							 const enum scan_t  scan,
-							 struct tze_err_t  *err)
-{
-	struct tze_dentry_t dentry = TZE_DENTRY_INIT;
-	const size_t root_size = strlen(root);
-	const int ret = tze_scan_dir(root, root_size, sep, scan,
-								 &dentry, loc_list, err);
-	tze_dentry_free(&dentry);
+		case TZE_OPT_REGROUP: {
+			if (args->mode != TZE_MODE_TABLE) {
+				tze_err_set(err, 0, "an operation mode redefined");
+				goto wrong_args;
+			}
 
-	return ret;
-}
+			args->mode = TZE_MODE_REGROUP;
+			args->table = optarg;
+			break;
+		}
 
-static void tze_loc_list_print(const struct tze_list_t *loc_list,
-							   const char				sep)
-{
-	struct tze_locality_t *loc;
+		case TZE_OPT_SLIM: {
+			if (args->mode != TZE_MODE_TABLE) {
+				tze_err_set(err, 0, "an operation mode redefined");
+				goto wrong_args;
+			}
 
-	tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
-		if (loc->links == NULL) {
-			printf("%s%c%s\n", loc->name, sep, loc->rule);
-		} else {
-			printf("%s%c%s%c%s\n",
-				   loc->name, sep, loc->links, sep, loc->rule);
+			args->mode = TZE_MODE_SLIM;
+			args->out_dir = optarg;
+			break;
 		}
-	}
-}
 
-static void tze_loc_list_free(struct tze_list_t *loc_list)
-{
-	while (!tze_list_is_empty(loc_list)) {
-		struct tze_locality_t *loc = tze_list_entry(loc_list->next,
-													struct tze_locality_t,
-													list);
-		tze_list_del(&loc->list);
-		tze_locality_free(loc);
-	}
-}
+		case TZE_OPT_WINDOW: {
+			int from, until, n = 0;
 
-int main(int    argc,
-		 char **argv)
-{
-	if (argc <= 1) {
-		return tze_show_usage();
-	}
+			if (sscanf(optarg, "%4d:%4d%n", &from, &until, &n) != 2 ||
+				optarg[n] != '\0' || from < 1 || from > until) {
+				tze_err_set(err, 0,
+							"\"%s\" window should be "
+							"{from year}:{until year}", optarg);
+				goto wrong_args;
+			}
 
-	int ret = -1;
-	const char *root = NULL;
-	char sep = TZE_DEF_SEP;
-	struct tze_err_t err = TZE_ERR_INIT;
+			args->from_year = from;
+			args->until_year = until;
+			window_set = 1;
+			break;
+		}
 
-	if (tze_get_args(argc, argv, &root, &sep, &err) >= 0) {
-		TZE_LIST_HEAD(loc_list);
+		case TZE_OPT_SINCE: {
+			char *end;
 
-		ret = tze_loc_list_scan(&loc_list, root, sep,
-								SCAN_FILES, &err);
+			errno = 0;
+			args->since = (int64_t) strtoll(optarg, &end, 10);
 
-		if (ret >= 0) {
-			if (tze_list_is_empty(&loc_list)) {
-				tze_err_set(&err, 0, "no timezone files found");
-				ret = -1;
-			} else {
-				ret = tze_loc_list_scan(&loc_list, root, sep,
-										SCAN_LINKS, &err);
+			if (errno != 0 || end == optarg || *end != '\0') {
+				tze_err_set(err, 0,
+							"\"%s\" should be seconds since the epoch",
+							optarg);
+				goto wrong_args;
+			}
 
-				if (ret >= 0) {
-					tze_loc_list_print(&loc_list, sep);
-				}
+			next_set = 1;
+			break;
+		}
+
+		case TZE_OPT_COUNT: {
+			char *end;
+			const unsigned long count = strtoul(optarg, &end, 10);
+
+			if (end == optarg || *end != '\0' || !isdigit(*optarg) ||
+				count == 0 || count > TZE_NEXT_COUNT_MAX) {
+				tze_err_set(err, 0,
+							"\"%s\" transition count should be "
+							"in [1, %i]", optarg, TZE_NEXT_COUNT_MAX);
+				goto wrong_args;
 			}
+
+			args->count = (size_t) count;
+			next_set = 1;
+			break;
 		}
 
-		tze_loc_list_free(&loc_list);
+		case TZE_OPT_READAHEAD: {
+			char *end;
+			const unsigned long readahead = strtoul(optarg, &end, 10);
+
+			if (end == optarg || *end != '\0' || !isdigit(*optarg) ||
+				readahead > TZE_SCAN_READAHEAD_MAX) {
+				tze_err_set(err, 0,
+							"\"%s\" readahead window should be "
+							"in [0, %i]", optarg, TZE_SCAN_READAHEAD_MAX);
+				goto wrong_args;
+			}
+
+			args->conf.readahead = (size_t) readahead;
+			break;
+		}
+
+		case TZE_OPT_JOBS: {
+			char *end;
+			const unsigned long jobs = strtoul(optarg, &end, 10);
+
+			if (end == optarg || *end != '\0' || !isdigit(*optarg) ||
+				jobs < 1 || jobs > TZE_SCAN_JOBS_MAX) {
+				tze_err_set(err, 0,
+							"\"%s\" job count should be in [1, %i]",
+							optarg, TZE_SCAN_JOBS_MAX);
+				goto wrong_args;
+			}
+
+			args->conf.jobs = (size_t) jobs;
+			break;
+		}
+
+		case ':': {
+			switch (optopt) {
+			case 'd': {
+				tze_err_set(err, 0,
+							"\"-%c\" option requires a root directory name",
+							(int) optopt);
+				goto wrong_args;
+			}
+
+			case 's': {
+				tze_err_set(err, 0,
+							"\"-%c\" option requires "
+							"a description separator",
+							(int) optopt);
+				goto wrong_args;
+			}
+
+			case 'f': {
+				tze_err_set(err, 0,
+							"\"-%c\" option requires an output format",
+							(int) optopt);
+				goto wrong_args;
+			}
+
+			case 'q': {
+				tze_err_set(err, 0,
+							"\"-%c\" option requires a locality name",
+							(int) optopt);
+				goto wrong_args;
+			}
+
+			case 'o': {
+				tze_err_set(err, 0,
+							"\"-%c\" option requires an output file name",
+							(int) optopt);
+				goto wrong_args;
+			}
+
+			case TZE_OPT_INDEX: {
+				tze_err_set(err, 0,
+							"\"--index\" option requires a table file name");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_TRACE: {
+				tze_err_set(err, 0,
+							"\"--trace\" option requires a file name");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_INCLUDE:
+			case TZE_OPT_EXCLUDE: {
+				tze_err_set(err, 0,
+							"\"--%s\" option requires a glob pattern",
+							(optopt == TZE_OPT_INCLUDE) ?
+							"include" : "exclude");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_DUPLICATES: {
+				tze_err_set(err, 0,
+							"\"--duplicates\" option requires a policy");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_SERVE:
+			case TZE_OPT_CLIENT: {
+				tze_err_set(err, 0,
+							"\"--%s\" option requires a socket name",
+							(optopt == TZE_OPT_SERVE) ? "serve" : "client");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_PUBLISH:
+			case TZE_OPT_LOOKUP: {
+				tze_err_set(err, 0,
+							"\"--%s\" option requires a segment name",
+							(optopt == TZE_OPT_PUBLISH) ? "publish" : "lookup");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_EXPAND: {
+				tze_err_set(err, 0,
+							"\"--expand\" option requires a table file name");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_REGROUP: {
+				tze_err_set(err, 0,
+							"\"--regroup\" option requires "
+							"a stream file name");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_SLIM: {
+				tze_err_set(err, 0,
+							"\"--slim\" option requires a directory name");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_WINDOW: {
+				tze_err_set(err, 0,
+							"\"--window\" option requires a year range");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_SINCE: {
+				tze_err_set(err, 0,
+							"\"--since\" option requires a time");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_COUNT: {
+				tze_err_set(err, 0,
+							"\"--count\" option requires a number");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_READAHEAD: {
+				tze_err_set(err, 0,
+							"\"--readahead\" option requires a number");
+				goto wrong_args;
+			}
+
+			case TZE_OPT_JOBS: {
+				tze_err_set(err, 0,
+							"\"--jobs\" option requires a number");
+				goto wrong_args;
+			}
+
+			default:
+				tze_err_set(err, 0, "unknown option \"-%c\"", (int) optopt);
+				goto wrong_args;
+			}
+		}
+
+		default:
+			if (optopt == 0) {
+				tze_err_set(err, 0, "unknown option \"%s\"",
+							argv[optind - 1]);
+			} else {
+				tze_err_set(err, 0, "unknown option \"-%c\"",
+							(int) optopt);
+			}
+
+			goto wrong_args;
+		}
+	}
+
+	if (args->mode == TZE_MODE_CLIENT) {
+		if (argc - optind != 2) {
+			tze_err_set(err, 0,
+						"\"--client\" requires a query type and a name");
+			goto wrong_args;
+		}
+
+		for (size_t i = 0; i < sizeof(QUERY_OPS) / sizeof(QUERY_OPS[0]); i++) {
+			if (strcmp(argv[optind], QUERY_OPS[i].name) == 0) {
+				args->query_op = QUERY_OPS[i].op;
+				break;
+			}
+		}
+
+		if (args->query_op == '\0') {
+			tze_err_set(err, 0, "\"%s\" is an unknown query type",
+						argv[optind]);
+			goto wrong_args;
+		}
+
+		args->query = argv[optind + 1];
+		optind += 2;
+	} else if (args->mode == TZE_MODE_LOOKUP) {
+		if (argc - optind != 1) {
+			tze_err_set(err, 0, "\"--lookup\" requires a name");
+			goto wrong_args;
+		}
+
+		args->query = argv[optind++];
+	} else if (args->mode == TZE_MODE_DIFF || args->mode == TZE_MODE_APPLY) {
+		if (args->root_count > 0) {
+			tze_err_set(err, 0,
+						"\"-d\" option can not be used with \"--%s\"",
+						(args->mode == TZE_MODE_DIFF) ? "diff" : "apply");
+			goto wrong_args;
+		}
+
+		if (argc - optind != 2) {
+			tze_err_set(err, 0, "\"--%s\" requires two arguments",
+						(args->mode == TZE_MODE_DIFF) ? "diff" : "apply");
+			goto wrong_args;
+		}
+
+		if (args->mode == TZE_MODE_DIFF) {
+			args->roots[args->root_count++] = argv[optind++];
+			args->roots[args->root_count++] = argv[optind++];
+		} else {
+			args->patch = argv[optind++];
+			args->table = argv[optind++];
+		}
+	}
+
+	if (args->root_count == 0 &&
+		args->mode != TZE_MODE_APPLY && args->mode != TZE_MODE_CLIENT &&
+		args->mode != TZE_MODE_LOOKUP && args->mode != TZE_MODE_EXPAND &&
+		args->mode != TZE_MODE_REGROUP) {
+		tze_err_set(err, 0, "no root directory specified");
+		goto wrong_args;
+	}
+
+	if (format_set && args->mode != TZE_MODE_TABLE) {
+		tze_err_set(err, 0, "an output format applies to a table only");
+		goto wrong_args;
+	}
+
+	if (args->trie && args->format != TZE_FORMAT_COMPACT) {
+		tze_err_set(err, 0, "\"--trie\" applies to a compact table only");
+		goto wrong_args;
 	}
 
+	if (args->fold &&
+		(args->mode == TZE_MODE_DIFF || args->mode == TZE_MODE_APPLY ||
+		 args->mode == TZE_MODE_CLIENT || args->mode == TZE_MODE_LOOKUP ||
+		 args->mode == TZE_MODE_EXPAND || args->mode == TZE_MODE_QUERY ||
+		 args->mode == TZE_MODE_STREAM || args->mode == TZE_MODE_REGROUP)) {
+		tze_err_set(err, 0,
+					"\"--fold-equal\" applies to a scanned table only");
+		goto wrong_args;
+	}
+
+	if (args->out != NULL &&
+		args->mode != TZE_MODE_TABLE && args->mode != TZE_MODE_QUERY &&
+		args->mode != TZE_MODE_DIFF && args->mode != TZE_MODE_EXPAND &&
+		args->mode != TZE_MODE_REGROUP) {
+		tze_err_set(err, 0,
+					"\"-o\" applies to a table, \"-q\", \"--diff\", "
+					"\"--expand\" and \"--regroup\" only");
+		goto wrong_args;
+	}
+
+	if (args->mode == TZE_MODE_STREAM) {
+		/* a stream is printed as a single root is traversed */
+		if (args->root_count > 1) {
+			tze_err_set(err, 0,
+						"\"--stream\" applies to a single root only");
+			goto wrong_args;
+		}
+
+		if (args->conf.dup != TZE_DUP_PARSE) {
+			tze_err_set(err, 0, "\"--duplicates\" can not be used "
+						"with \"--stream\"");
+			goto wrong_args;
+		}
+
+		if (args->conf.jobs > 1) {
+			tze_err_set(err, 0,
+						"\"--jobs\" can not be used with \"--stream\"");
+			goto wrong_args;
+		}
+	}
+
+	if (args->mode == TZE_MODE_REGROUP && args->root_count > 0) {
+		tze_err_set(err, 0,
+					"\"-d\" option can not be used with \"--regroup\"");
+		goto wrong_args;
+	}
+
+	if (args->index != NULL && args->mode != TZE_MODE_QUERY) {
+		tze_err_set(err, 0, "\"--index\" applies to \"-q\" only");
+		goto wrong_args;
+	}
+
+	if (next_set && args->format != TZE_FORMAT_NEXT) {
+		tze_err_set(err, 0,
+					"\"--since\" and \"--count\" apply to \"-f next\" only");
+		goto wrong_args;
+	}
+
+	if (window_set && args->mode != TZE_MODE_SLIM) {
+		tze_err_set(err, 0, "\"--window\" applies to \"--slim\" only");
+		goto wrong_args;
+	}
+
+	/* zone files are read again past a scan of a zic source */
+	const char *const zone_files =
+		(args->mode == TZE_MODE_SLIM) ? "\"--slim\"" :
+		(args->mode == TZE_MODE_QUERY) ? "\"-q\"" :
+		(args->format == TZE_FORMAT_NEXT) ? "\"-f next\"" :
+		(args->format == TZE_FORMAT_TRANSITIONS) ? "\"-f transitions\"" :
+		args->fold ? "\"--fold-equal\"" : NULL;
+
+	for (size_t i = 0; zone_files != NULL && i < args->root_count; i++) {
+		struct stat st;
+
+		if (stat(args->roots[i], &st) == 0 && S_ISREG(st.st_mode)) {
+			tze_err_set(err, 0,
+						"%s: %s requires a zoneinfo directory root",
+						args->roots[i], zone_files);
+			goto wrong_args;
+		}
+	}
+
+	if (optind != argc) {
+		tze_err_set(err, 0, "unknown trailing arguments specified");
+		goto wrong_args;
+	}
+
+	return 0;
+
+wrong_args:
+	return -1;
+}
+
+static int tze_show_usage()
+{
+	printf("Timezone extractor utility, v%s.\n"
+		   "\n"
+		   "  -d {root directory} (repeatable, "
+		   "later roots override earlier ones)\n"
+		   "  -d {zic source file} (e.g. tzdata.zi, read in place of\n"
+		   "                       a compiled root directory, not for\n"
+		   "                       modes which read zone files)\n"
+		   "  -s {description separator} (default is \"%c\")\n"
+		   "  -q {locality} (print a single locality without a scan)\n"
+		   "  -o {output file} (replaced atomically and only when changed,\n"
+		   "                   exit code is %i when it is replaced)\n"
+		   "  --index {table file} (links of \"-q\" from a text table\n"
+		   "                       printed earlier, a scan otherwise)\n"
+		   "  -f {text|c|compact|reverse|transitions|next} (an output format,\n"
+		   "                                               "
+		   "default is \"text\")\n"
+		   "  --trie (add a name trie section to a compact table)\n"
+		   "  --since {seconds since the epoch} (a \"next\" reference time,\n"
+		   "                                    default is now)\n"
+		   "  --count {number} (transitions per locality for \"next\",\n"
+		   "                   default is %i)\n"
+		   "  --include {glob} (repeatable, keep matching localities only)\n"
+		   "  --exclude {glob} (repeatable, \"dir/\" skips a subtree)\n"
+		   "  --duplicates {link|skip} (already visited directories and\n"
+		   "                           hardlinked files)\n"
+		   "  --canonical-rules (emit rules in a canonical form)\n"
+		   "  --fold-equal (report localities with equal zone data\n"
+		   "                as links of a first one)\n"
+		   "  --readahead {number} (files prefetched ahead of a parsed\n"
+		   "                       one, 0 disables, default is %i)\n"
+		   "  --jobs {number} (threads traversing a root directory,\n"
+		   "                  default is %i)\n"
+		   "  --trace {file} (write a Chrome trace event timeline)\n"
+		   "  --stream (print records while scanning a single root,\n"
+		   "            symlinks as {link}{sep}{target}{sep}{rule})\n"
+		   "\n"
+		   "  --diff {old root directory} {new root directory}\n"
+		   "  --apply {patch file} {table file}\n"
+		   "  --serve {socket name}\n"
+		   "  --client {socket name} {record|canonical|list|complete}\n"
+		   "           {name}\n"
+		   "  --publish {shared memory name}\n"
+		   "  --lookup {shared memory name} {name}\n"
+		   "  --expand {compact table file}\n"
+		   "  --regroup {stream file} (group records of \"--stream\"\n"
+		   "                          into a table, \"-\" is stdin)\n"
+		   "  --slim {output directory} (rewrite zone files into slim\n"
+		   "                            ones, links become hardlinks)\n"
+		   "  --window {from year}:{until year} (transitions to keep\n"
+		   "                                    with \"--slim\", "
+		   "default is %i:%i)\n",
+		   TZE_VERSION,
+		   TZE_DEF_SEP,
+		   TZE_EXIT_CHANGED,
+		   TZE_NEXT_DEF_COUNT,
+		   TZE_SCAN_DEF_READAHEAD,
+		   TZE_SCAN_DEF_JOBS,
+		   TZE_SLIM_DEF_FROM,
+		   TZE_SLIM_DEF_UNTIL);
+
+	return EXIT_FAILURE;
+}
+
+static void tze_loc_list_print(FILE					*out,
+							   const struct tze_list_t *loc_list,
+							   const char				sep)
+{
+	struct tze_locality_t *loc;
+
+	tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
+		if (loc->links == NULL) {
+			fprintf(out, "%s%c%s\n", loc->name, sep, loc->rule);
+		} else {
+			fprintf(out, "%s%c%s%c%s\n",
+					loc->name, sep, loc->links, sep, loc->rule);
+		}
+	}
+}
+
+static void tze_loc_list_free(struct tze_list_t *loc_list)
+{
+	while (!tze_list_is_empty(loc_list)) {
+		struct tze_locality_t *loc = tze_list_entry(loc_list->next,
+													struct tze_locality_t,
+													list);
+		tze_list_del(&loc->list);
+		tze_locality_free(loc);
+	}
+}
+
+static int tze_table_build(const struct tze_args_t *args,
+						   struct tze_list_t	   *loc_list,
+						   struct tze_err_t		   *err)
+{
+	struct tze_root_t roots[TZE_ROOT_MAX];
+
+	for (size_t i = 0; i < args->root_count; i++) {
+		tze_root_init(&roots[i], args->roots[i], &args->conf);
+	}
+
+	int ret = tze_roots_scan(roots, args->root_count, err);
+	const int64_t span = tze_trace_begin();
+
+	if (ret >= 0) {
+		ret = tze_roots_merge(roots, args->root_count,
+							  &args->conf, loc_list, err);
+	}
+
+	tze_trace_end("merge", NULL, span);
+
+	if (ret >= 0 && tze_list_is_empty(loc_list)) {
+		tze_err_set(err, 0, "no timezone files found");
+		ret = -1;
+	}
+
+	if (ret >= 0 && args->fold) {
+		struct tze_equiv_t equiv;
+
+		ret = tze_equiv_build(&equiv, args->roots, args->root_count,
+							  loc_list, err);
+
+		if (ret >= 0) {
+			ret = tze_equiv_fold(&equiv, args->conf.sep, err);
+		}
+	}
+
+	for (size_t i = 0; i < args->root_count; i++) {
+		tze_root_free(&roots[i]);
+	}
+
+	return ret;
+}
+
+static int tze_table_run(const struct tze_args_t *args,
+						 FILE					 *out,
+						 struct tze_err_t		 *err)
+{
+	TZE_LIST_HEAD(loc_list);
+	struct tze_index_t index = TZE_INDEX_INIT;
+	struct tze_reverse_t rev = TZE_REVERSE_INIT;
+	int ret = tze_table_build(args, &loc_list, err);
+	const int64_t span = tze_trace_begin();
+
+	if (ret >= 0) {
+		switch (args->format) {
+		case TZE_FORMAT_TEXT:
+			tze_loc_list_print(out, &loc_list, args->conf.sep);
+			break;
+
+		case TZE_FORMAT_C:
+		case TZE_FORMAT_COMPACT:
+			ret = tze_index_build(&index, &loc_list, args->conf.sep);
+
+			if (ret < 0) {
+				tze_err_set(err, errno, "unable to build a lookup index");
+				break;
+			}
+
+			ret = (args->format == TZE_FORMAT_C) ?
+				tze_csrc_print(out, &index, err) :
+				tze_compact_print(out, &index, args->conf.sep,
+								  args->trie, err);
+			tze_index_free(&index);
+			break;
+
+		case TZE_FORMAT_REVERSE:
+			ret = tze_reverse_build(&rev, &loc_list, err);
+
+			if (ret >= 0) {
+				ret = tze_reverse_print(out, &rev, args->conf.sep);
+				tze_reverse_free(&rev);
+			}
+
+			break;
+
+		case TZE_FORMAT_TRANSITIONS:
+			ret = tze_trans_print_list(out, args->roots, args->root_count,
+									   &loc_list, args->conf.sep, err);
+			break;
+
+		case TZE_FORMAT_NEXT:
+			ret = tze_next_print_list(out, args->roots, args->root_count,
+									  &loc_list, args->conf.sep,
+									  args->since, args->count, err);
+			break;
+		}
+	}
+
+	tze_trace_end("print", NULL, span);
+	tze_loc_list_free(&loc_list);
+
+	return ret;
+}
+
+static int tze_serve_run(const struct tze_args_t *args,
+						 struct tze_err_t		 *err)
+{
+	TZE_LIST_HEAD(loc_list);
+	struct tze_index_t index = TZE_INDEX_INIT;
+	int ret = tze_table_build(args, &loc_list, err);
+
+	if (ret >= 0) {
+		ret = tze_index_build(&index, &loc_list, args->conf.sep);
+
+		if (ret < 0) {
+			tze_err_set(err, errno, "unable to build a lookup index");
+		} else {
+			ret = tze_serve(args->socket, &index, args->conf.sep, err);
+			tze_index_free(&index);
+		}
+	}
+
+	tze_loc_list_free(&loc_list);
+
+	return ret;
+}
+
+static int tze_publish_run(const struct tze_args_t *args,
+						   struct tze_err_t		   *err)
+{
+	TZE_LIST_HEAD(loc_list);
+	struct tze_index_t index = TZE_INDEX_INIT;
+	int ret = tze_table_build(args, &loc_list, err);
+
+	if (ret >= 0) {
+		ret = tze_index_build(&index, &loc_list, args->conf.sep);
+
+		if (ret < 0) {
+			tze_err_set(err, errno, "unable to build a lookup index");
+		} else {
+			ret = tze_shm_publish(args->shm, &index, args->conf.sep, err);
+			tze_index_free(&index);
+		}
+	}
+
+	tze_loc_list_free(&loc_list);
+
+	return ret;
+}
+
+static int tze_lookup_run(const struct tze_args_t *args,
+						  struct tze_err_t		  *err)
+{
+	struct tze_shm_reader_t reader;
+
+	if (tze_shm_open(&reader, args->shm, err) < 0) {
+		return -1;
+	}
+
+	size_t size = TZE_LINE_MIN;
+	char *line = NULL;
+	long ret;
+
+	while (1) {
+		char *grown = realloc(line, size);
+
+		if (grown == NULL) {
+			tze_err_set(err, ENOMEM, "unable to allocate a line buffer");
+			ret = -1;
+			break;
+		}
+
+		line = grown;
+		ret = tze_shm_lookup(&reader, args->query, line, size, err);
+
+		if (ret < 0 || (size_t) ret < size) {
+			break;
+		}
+
+		size = (size_t) ret + 1;
+	}
+
+	if (ret > 0) {
+		printf("%s\n", line);
+	}
+
+	if (ret == 0) {
+		tze_err_set(err, 0, "%s: not found", args->query);
+	}
+
+	free(line);
+	tze_shm_close(&reader);
+
+	return (ret < 0) ? -1 : (ret == 0) ? 1 : 0;
+}
+
+static int tze_expand_run(const struct tze_args_t *args,
+						  FILE					  *out,
+						  struct tze_err_t		  *err)
+{
+	TZE_LIST_HEAD(loc_list);
+	struct tze_compact_t compact;
+
+	if (tze_compact_load(&compact, args->table, err) < 0) {
+		return -1;
+	}
+
+	const int ret = tze_compact_expand(&compact, &loc_list, err);
+
+	if (ret >= 0) {
+		tze_loc_list_print(out, &loc_list, compact.sep);
+	}
+
+	tze_loc_list_free(&loc_list);
+	tze_compact_close(&compact);
+
+	return ret;
+}
+
+static int tze_slim_run(const struct tze_args_t *args,
+						struct tze_err_t		*err)
+{
+	TZE_LIST_HEAD(loc_list);
+	int ret = tze_table_build(args, &loc_list, err);
+
+	if (ret >= 0) {
+		/* the until year is inclusive */
+		ret = tze_slim_tree(args->roots, args->root_count, &loc_list,
+							args->conf.sep, args->out_dir,
+							tze_rule_year_start(args->from_year),
+							tze_rule_year_start(args->until_year + 1),
+							err);
+	}
+
+	tze_loc_list_free(&loc_list);
+
+	return ret;
+}
+
+/**
+ * Finds links of a locality with a full scan, when no table is given.
+ **/
+
+static int tze_query_scan_links(const struct tze_args_t *args,
+								const char				*const locality,
+								char				   **links,
+								struct tze_err_t		*err)
+{
+	TZE_LIST_HEAD(loc_list);
+	struct tze_locality_t *loc;
+	int ret = tze_table_build(args, &loc_list, err);
+
+	*links = NULL;
+
+	if (ret >= 0) {
+		tze_list_foreach_entry(loc, struct tze_locality_t, list, &loc_list) {
+			if (strcmp(loc->name, locality) == 0) {
+				/* taken over */
+				*links = loc->links;
+				loc->links = NULL;
+				break;
+			}
+		}
+	}
+
+	tze_loc_list_free(&loc_list);
+
+	return ret;
+}
+
+static int tze_query_run(const struct tze_args_t *args,
+						 FILE					 *out,
+						 struct tze_err_t		 *err)
+{
+	char file_name[PATH_MAX];
+	char locality[PATH_MAX];
+	size_t root_index;
+
+	if (tze_query_resolve(args->roots, args->root_count, args->query,
+						  file_name, locality, &root_index, err) < 0) {
+		return -1;
+	}
+
+	struct tze_root_t root;
+	char *rule = NULL;
+	bool v3 = false;
+
+	/* validates and formats a rule as a scan does */
+	tze_root_init(&root, args->roots[root_index], &args->conf);
+
+	int ret = tze_tz_read(file_name, locality, &rule, &v3, err);
+
+	if (ret > 0) {
+		tze_err_set(err, 0, "%s: not a timezone file", locality);
+		ret = -1;
+	}
+
+	if (ret >= 0) {
+		ret = tze_root_add(&root, locality, NULL, rule, v3, err);
+	}
+
+	free(rule);
+
+	if (ret >= 0) {
+		struct tze_locality_t *loc = tze_list_entry(root.loc_list.next,
+													struct tze_locality_t,
+													list);
+
+		if (args->index == NULL) {
+			ret = tze_query_scan_links(args, locality, &loc->links, err);
+		} else {
+			ret = tze_query_links(args->index, locality, args->conf.sep,
+								  &loc->links, err);
+
+			if (ret == 0) {
+				tze_err_set(err, 0, "%s: not found in \"%s\" table",
+							locality, args->index);
+				ret = -1;
+			}
+		}
+	}
+
+	if (ret >= 0) {
+		const int64_t span = tze_trace_begin();
+
+		tze_loc_list_print(out, &root.loc_list, args->conf.sep);
+		tze_trace_end("print", NULL, span);
+	}
+
+	tze_root_free(&root);
+
+	return ret;
+}
+
+static int tze_stream_run(const struct tze_args_t *args,
+						  FILE					  *out,
+						  struct tze_err_t		  *err)
+{
+	struct tze_root_t root;
+
+	tze_root_init(&root, args->roots[0], &args->conf);
+
+	int ret = tze_roots_scan(&root, 1, err);
+
+	tze_root_free(&root);
+
+	if (ret >= 0 && (fflush(out) != 0 || ferror(out))) {
+		tze_err_set(err, errno, "unable to write a stream");
+		ret = -1;
+	}
+
+	return ret;
+}
+
+static int tze_regroup_run(const struct tze_args_t *args,
+						   FILE					   *out,
+						   struct tze_err_t		   *err)
+{
+	TZE_LIST_HEAD(loc_list);
+	int64_t span = tze_trace_begin();
+	int ret = tze_stream_regroup(args->table, args->conf.sep,
+								 &loc_list, err);
+
+	tze_trace_end("merge", NULL, span);
+
+	if (ret >= 0) {
+		span = tze_trace_begin();
+		tze_loc_list_print(out, &loc_list, args->conf.sep);
+		tze_trace_end("print", NULL, span);
+	}
+
+	tze_loc_list_free(&loc_list);
+
+	return ret;
+}
+
+static int tze_diff_run(const struct tze_args_t *args,
+						FILE					*out,
+						struct tze_err_t		*err)
+{
+	TZE_LIST_HEAD(old_list);
+	TZE_LIST_HEAD(new_list);
+	struct tze_list_t *lists[] = { &old_list, &new_list };
+	struct tze_root_t roots[2];
+
+	for (size_t i = 0; i < 2; i++) {
+		tze_root_init(&roots[i], args->roots[i], &args->conf);
+	}
+
+	/* both trees are scanned concurrently, but merged separately */
+	int ret = tze_roots_scan(roots, 2, err);
+
+	for (size_t i = 0; i < 2 && ret >= 0; i++) {
+		ret = tze_roots_merge(&roots[i], 1, &args->conf, lists[i], err);
+
+		if (ret >= 0 && tze_list_is_empty(lists[i])) {
+			tze_err_set(err, 0, "%s: no timezone files found",
+						roots[i].dir);
+			ret = -1;
+		}
+	}
+
+	if (ret >= 0 &&
+		tze_diff_print(out, &old_list, &new_list,
+					   args->conf.sep, err) < 0) {
+		ret = -1;
+	}
+
+	for (size_t i = 0; i < 2; i++) {
+		tze_root_free(&roots[i]);
+		tze_loc_list_free(lists[i]);
+	}
+
+	return ret;
+}
+
+int main(int    argc,
+		 char **argv)
+{
+	if (argc <= 1) {
+		return tze_show_usage();
+	}
+
+	int ret = -1;
+	int changed = 0;
+	struct tze_args_t args;
+	struct tze_out_t file_out = TZE_OUT_INIT;
+	struct tze_err_t err = TZE_ERR_INIT;
+
+	if (tze_get_args(argc, argv, &args, &err) >= 0 &&
+		(args.out == NULL || tze_out_open(&file_out, args.out, &err) >= 0) &&
+		(args.trace == NULL || tze_trace_start(&err) >= 0)) {
+		FILE *out = (args.out == NULL) ? stdout : file_out.stream;
+
+		switch (args.mode) {
+		case TZE_MODE_TABLE:
+			ret = tze_table_run(&args, out, &err);
+			break;
+
+		case TZE_MODE_DIFF:
+			ret = tze_diff_run(&args, out, &err);
+			break;
+
+		case TZE_MODE_APPLY:
+			ret = tze_diff_apply(args.patch, args.table,
+								 args.conf.sep, &err);
+			break;
+
+		case TZE_MODE_SERVE:
+			ret = tze_serve_run(&args, &err);
+			break;
+
+		case TZE_MODE_CLIENT:
+			ret = tze_serve_query(args.socket, args.query_op,
+								  args.query, stdout, &err);
+
+			if (ret > 0) {
+				/* nothing found */
+				ret = -1;
+			}
+
+			break;
+
+		case TZE_MODE_PUBLISH:
+			ret = tze_publish_run(&args, &err);
+			break;
+
+		case TZE_MODE_EXPAND:
+			ret = tze_expand_run(&args, out, &err);
+			break;
+
+		case TZE_MODE_SLIM:
+			ret = tze_slim_run(&args, &err);
+			break;
+
+		case TZE_MODE_QUERY:
+			ret = tze_query_run(&args, out, &err);
+			break;
+
+		case TZE_MODE_STREAM:
+			args.conf.stream = out;
+			ret = tze_stream_run(&args, out, &err);
+			break;
+
+		case TZE_MODE_REGROUP:
+			ret = tze_regroup_run(&args, out, &err);
+			break;
+
+		case TZE_MODE_LOOKUP:
+			ret = tze_lookup_run(&args, &err);
+
+			if (ret > 0) {
+				/* nothing found */
+				ret = -1;
+			}
+
+			break;
+		}
+
+		if (ret >= 0 && args.out != NULL) {
+			const int64_t span = tze_trace_begin();
+
+			ret = tze_out_commit(&file_out, &err);
+			changed = (ret > 0);
+			tze_trace_end("write output", args.out, span);
+		}
+
+		if (args.trace != NULL) {
+			struct tze_err_t trace_err = TZE_ERR_INIT;
+
+			/* a failed run is traced too, its error goes first */
+			if (tze_trace_write(args.trace, &trace_err) < 0 && ret >= 0) {
+				err = trace_err;
+				ret = -1;
+			}
+		}
+	}
+
+	tze_out_close(&file_out);
+
 	if (ret < 0) {
 		const char *const name = strrchr(argv[0], '/');
 		const char *const ident = (name == NULL) ? argv[0] : name + 1;
@@ -499,5 +1493,5 @@ int main(int    argc,
 		return EXIT_FAILURE;
 	}
 
-	return EXIT_SUCCESS;
+	return changed ? TZE_EXIT_CHANGED : EXIT_SUCCESS;
 }
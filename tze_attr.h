@@ -8,6 +8,7 @@
 
 #define TZE_ATTR_PRINTF(m, n)			__attribute__((format(printf, m, n)))
 #define TZE_ATTR_PACKED					__attribute__((packed))
+#define TZE_ATTR_TARGET(t)				__attribute__((target(t)))
 
 #else
 #error "An unknown compiler used."
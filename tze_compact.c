@@ -0,0 +1,758 @@
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "tze_err.h"
+#include "tze_hash.h"
+#include "tze_list.h"
+#include "tze_name.h"
+#include "tze_index.h"
+#include "tze_compact.h"
+#include "tze_locality.h"
+
+static size_t tze_compact_shared(const char *l,
+								 const char *r)
+{
+	size_t i = 0;
+
+	while (l[i] != '\0' && l[i] == r[i]) {
+		i++;
+	}
+
+	return i;
+}
+
+int tze_compact_print(FILE					   *out,
+					  const struct tze_index_t *index,
+					  const char				sep,
+					  const bool				trie,
+					  struct tze_err_t		   *err)
+{
+	const size_t n = index->count;
+	const size_t restart_count =
+		(n + TZE_COMPACT_RESTART - 1) / TZE_COMPACT_RESTART;
+	int ret = -1;
+	struct tze_hash_t rules = TZE_HASH_INIT;
+	struct tze_hash_t names = TZE_HASH_INIT;
+	const char **rule_list = malloc(sizeof(*rule_list) * (n + 1));
+	size_t *restarts = malloc(sizeof(*restarts) * (restart_count + 1));
+	size_t rule_count = 0;
+	char *records = NULL;
+	size_t records_size = 0;
+	FILE *rec_out = NULL;
+
+	if (rule_list == NULL || restarts == NULL) {
+		goto no_memory;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		const struct tze_index_entry_t *e = &index->entries[i];
+
+		if (tze_hash_put(&names, e->name, (void *) (i + 1)) < 0) {
+			goto no_memory;
+		}
+
+		if (tze_hash_has(&rules, e->loc->rule)) {
+			continue;
+		}
+
+		if (tze_hash_put(&rules, e->loc->rule,
+						 (void *) (rule_count + 1)) < 0) {
+			goto no_memory;
+		}
+
+		rule_list[rule_count++] = e->loc->rule;
+	}
+
+	/* records go first to a buffer, restart offsets precede them */
+	rec_out = open_memstream(&records, &records_size);
+
+	if (rec_out == NULL) {
+		goto no_memory;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		const struct tze_index_entry_t *e = &index->entries[i];
+		const size_t rule = (size_t) tze_hash_get(&rules, e->loc->rule) - 1;
+		size_t shared = 0;
+
+		if (i % TZE_COMPACT_RESTART == 0) {
+			restarts[i / TZE_COMPACT_RESTART] = (size_t) ftell(rec_out);
+		} else {
+			shared = tze_compact_shared(index->entries[i - 1].name, e->name);
+		}
+
+		fprintf(rec_out, "%zu%c%s%c%zu",
+				shared, sep, e->name + shared, sep, rule);
+
+		if (e->name != e->loc->name) {
+			fprintf(rec_out, "%c%zu", sep,
+					(size_t) tze_hash_get(&names, e->loc->name) - 1);
+		}
+
+		fputc('\n', rec_out);
+	}
+
+	if (fclose(rec_out) != 0) {
+		rec_out = NULL;
+		goto no_memory;
+	}
+
+	rec_out = NULL;
+
+	fprintf(out, "%s%c%zu%c%zu%c%i\n", TZE_COMPACT_MAGIC,
+			sep, rule_count, sep, n, sep, TZE_COMPACT_RESTART);
+
+	for (size_t i = 0; i < rule_count; i++) {
+		fprintf(out, "%s\n", rule_list[i]);
+	}
+
+	for (size_t i = 0; i < restart_count; i++) {
+		if (i > 0) {
+			fputc(sep, out);
+		}
+
+		fprintf(out, "%zu", restarts[i]);
+	}
+
+	if (trie && index->trie.count > 0) {
+		fprintf(out, "\n%zu\n", index->trie.count - 1);
+		tze_trie_print(out, &index->trie, sep);
+	} else {
+		fputs("\n0\n", out);
+	}
+
+	fwrite(records, 1, records_size, out);
+
+	if (ferror(out)) {
+		tze_err_set(err, errno, "unable to write a compact table");
+		goto out;
+	}
+
+	ret = 0;
+	goto out;
+
+no_memory:
+	tze_err_set(err, ENOMEM, "unable to encode a compact table");
+
+out:
+	if (rec_out != NULL) {
+		fclose(rec_out);
+	}
+
+	tze_hash_free(&rules);
+	tze_hash_free(&names);
+	free(rule_list);
+	free(restarts);
+	free(records);
+
+	return ret;
+}
+
+/**
+ * Parses a decimal number terminated by a given character.
+ **/
+
+static int tze_compact_num(const struct tze_compact_t *c,
+						   size_t					  *offs,
+						   const char				   term,
+						   size_t					  *value)
+{
+	size_t i = *offs;
+	size_t v = 0;
+
+	while (i < c->size && c->data[i] >= '0' && c->data[i] <= '9') {
+		if (v > (SIZE_MAX - 9) / 10) {
+			return -1;
+		}
+
+		v = v * 10 + (size_t) (c->data[i++] - '0');
+	}
+
+	if (i == *offs || i == c->size || c->data[i] != term) {
+		return -1;
+	}
+
+	*offs = i + 1;
+	*value = v;
+
+	return 0;
+}
+
+static int tze_compact_parse_trie(struct tze_compact_t *c,
+								  size_t			   *offs)
+{
+	size_t count;
+
+	if (tze_compact_num(c, offs, '\n', &count) < 0 ||
+		count >= c->size || count >= UINT32_MAX) {
+		return -1;
+	}
+
+	/* a level stack keeps the last node of every level */
+	uint32_t *parents = malloc(sizeof(*parents) * (count + 1));
+	uint32_t *stack = malloc(sizeof(*stack) * (count + 2));
+
+	c->trie.nodes = malloc(sizeof(*c->trie.nodes) * (count + 1));
+	c->trie.count = count + 1;
+
+	if (parents == NULL || stack == NULL || c->trie.nodes == NULL) {
+		goto fail;
+	}
+
+	c->trie.nodes[0] = (struct tze_trie_node_t) {
+		.label		= "",
+		.hi			= (uint32_t) c->name_count
+	};
+	stack[0] = 0;
+
+	for (size_t i = 1, top = 0; i <= count; i++) {
+		struct tze_trie_node_t *n = &c->trie.nodes[i];
+		size_t level;
+		size_t lo;
+		size_t size;
+
+		if (tze_compact_num(c, offs, c->sep, &level) < 0 ||
+			level == 0 || level > top + 1) {
+			goto fail;
+		}
+
+		const char *const label = c->data + *offs;
+		const char *const end = memchr(label, c->sep, c->size - *offs);
+
+		if (end == NULL || end == label) {
+			goto fail;
+		}
+
+		*offs = (size_t) (end - c->data) + 1;
+
+		if (tze_compact_num(c, offs, c->sep, &lo) < 0 ||
+			tze_compact_num(c, offs, '\n', &size) < 0 ||
+			lo > c->name_count || size > c->name_count - lo) {
+			goto fail;
+		}
+
+		n->label = label;
+		n->label_size = (uint32_t) (end - label);
+		n->lo = (uint32_t) lo;
+		n->hi = (uint32_t) (lo + size);
+		parents[i] = stack[level - 1];
+		stack[level] = (uint32_t) i;
+		top = level;
+	}
+
+	if (tze_trie_link(&c->trie, parents) < 0) {
+		goto fail;
+	}
+
+	free(parents);
+	free(stack);
+
+	return 0;
+
+fail:
+	free(parents);
+	free(stack);
+	return -1;
+}
+
+static int tze_compact_parse(struct tze_compact_t *c)
+{
+	const size_t magic_size = sizeof(TZE_COMPACT_MAGIC) - 1;
+	size_t offs = magic_size + 1;
+
+	if (c->size <= magic_size ||
+		memcmp(c->data, TZE_COMPACT_MAGIC, magic_size) != 0) {
+		return -1;
+	}
+
+	c->sep = c->data[magic_size];
+
+	if (tze_compact_num(c, &offs, c->sep, &c->rule_count) < 0 ||
+		tze_compact_num(c, &offs, c->sep, &c->name_count) < 0 ||
+		tze_compact_num(c, &offs, '\n', &c->interval) < 0 ||
+		c->interval == 0 ||
+		c->rule_count > c->size || c->name_count > c->size) {
+		return -1;
+	}
+
+	c->restart_count = (c->name_count + c->interval - 1) / c->interval;
+	c->rules = malloc(sizeof(*c->rules) * (c->rule_count + 1));
+	c->restarts = malloc(sizeof(*c->restarts) * (c->restart_count + 1));
+
+	if (c->rules == NULL || c->restarts == NULL) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < c->rule_count; i++) {
+		const char *const end = memchr(c->data + offs, '\n', c->size - offs);
+
+		if (end == NULL) {
+			return -1;
+		}
+
+		c->rules[i].offs = offs;
+		c->rules[i].size = (size_t) (end - c->data) - offs;
+		offs = (size_t) (end - c->data) + 1;
+	}
+
+	for (size_t i = 0; i < c->restart_count; i++) {
+		const char term = (i + 1 == c->restart_count) ? '\n' : c->sep;
+
+		if (tze_compact_num(c, &offs, term, &c->restarts[i]) < 0) {
+			return -1;
+		}
+	}
+
+	if (c->restart_count == 0) {
+		if (offs == c->size || c->data[offs] != '\n') {
+			return -1;
+		}
+
+		offs++;
+	}
+
+	if (tze_compact_parse_trie(c, &offs) < 0) {
+		return -1;
+	}
+
+	c->records_offs = offs;
+
+	for (size_t i = 0; i < c->restart_count; i++) {
+		if (c->restarts[i] >= c->size - c->records_offs) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int tze_compact_open(struct tze_compact_t *c,
+					 const char			  *data,
+					 const size_t		   size,
+					 struct tze_err_t	  *err)
+{
+	c->data = data;
+	c->size = size;
+	c->buf = NULL;
+	c->rules = NULL;
+	c->restarts = NULL;
+	c->trie.nodes = NULL;
+	c->trie.count = 0;
+
+	if (tze_compact_parse(c) < 0) {
+		tze_err_set(err, (errno == ENOMEM) ? ENOMEM : EINVAL,
+					"malformed compact table header");
+		tze_compact_close(c);
+		return -1;
+	}
+
+	return 0;
+}
+
+int tze_compact_load(struct tze_compact_t *c,
+					 const char			  *const file_name,
+					 struct tze_err_t	  *err)
+{
+	struct stat st;
+	char *buf = NULL;
+	const int fd = open(file_name, O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0) {
+		tze_err_set(err, errno, "%s: unable to open", file_name);
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		tze_err_set(err, errno, "%s: unable to stat", file_name);
+		goto fail;
+	}
+
+	const size_t size = (size_t) st.st_size;
+
+	buf = malloc(size + 1);
+
+	if (buf == NULL) {
+		tze_err_set(err, ENOMEM, "%s: unable to allocate", file_name);
+		goto fail;
+	}
+
+	for (size_t done = 0; done < size; ) {
+		const ssize_t n = read(fd, buf + done, size - done);
+
+		if (n <= 0) {
+			tze_err_set(err, (n == 0) ? EIO : errno,
+						"%s: unable to read", file_name);
+			goto fail;
+		}
+
+		done += (size_t) n;
+	}
+
+	close(fd);
+	buf[size] = '\0';
+
+	if (tze_compact_open(c, buf, size, err) < 0) {
+		free(buf);
+		return -1;
+	}
+
+	c->buf = buf;
+
+	return 0;
+
+fail:
+	free(buf);
+	close(fd);
+	return -1;
+}
+
+void tze_compact_close(struct tze_compact_t *c)
+{
+	free(c->rules);
+	free(c->restarts);
+	free(c->buf);
+	tze_trie_free(&c->trie);
+	c->rules = NULL;
+	c->restarts = NULL;
+	c->buf = NULL;
+}
+
+void tze_compact_restart(const struct tze_compact_t  *c,
+						 struct tze_compact_cursor_t *cursor,
+						 const size_t				  restart)
+{
+	if (restart < c->restart_count) {
+		cursor->offs = c->records_offs + c->restarts[restart];
+		cursor->index = restart * c->interval;
+	} else {
+		cursor->offs = c->size;
+		cursor->index = c->name_count;
+	}
+
+	cursor->name_size = 0;
+	cursor->name[0] = '\0';
+}
+
+int tze_compact_next(const struct tze_compact_t  *c,
+					 struct tze_compact_cursor_t *cursor,
+					 struct tze_compact_rec_t	 *rec)
+{
+	if (cursor->index >= c->name_count) {
+		return 0;
+	}
+
+	size_t offs = cursor->offs;
+	size_t shared;
+	size_t rule;
+
+	if (tze_compact_num(c, &offs, c->sep, &shared) < 0 ||
+		shared > cursor->name_size) {
+		return -1;
+	}
+
+	const char *const suffix = c->data + offs;
+	const char *const end = memchr(suffix, c->sep, c->size - offs);
+
+	if (end == NULL ||
+		shared + (size_t) (end - suffix) >= TZE_COMPACT_NAME_MAX) {
+		return -1;
+	}
+
+	memcpy(cursor->name + shared, suffix, (size_t) (end - suffix));
+	cursor->name_size = shared + (size_t) (end - suffix);
+	cursor->name[cursor->name_size] = '\0';
+	offs = (size_t) (end - c->data) + 1;
+
+	/* a link has a locality index after a rule index */
+	size_t rule_end = offs;
+
+	while (rule_end < c->size &&
+		   c->data[rule_end] != c->sep && c->data[rule_end] != '\n') {
+		rule_end++;
+	}
+
+	const char term = (rule_end < c->size) ? c->data[rule_end] : '\n';
+
+	if (tze_compact_num(c, &offs, term, &rule) < 0 ||
+		rule >= c->rule_count) {
+		return -1;
+	}
+
+	rec->loc_index = cursor->index;
+
+	if (term == c->sep &&
+		(tze_compact_num(c, &offs, '\n', &rec->loc_index) < 0 ||
+		 rec->loc_index >= c->name_count)) {
+		return -1;
+	}
+
+	rec->name = cursor->name;
+	rec->index = cursor->index;
+	rec->rule = c->data + c->rules[rule].offs;
+	rec->rule_size = c->rules[rule].size;
+	cursor->offs = offs;
+	cursor->index++;
+
+	return 1;
+}
+
+static int tze_compact_restart_compar(const struct tze_compact_t *c,
+									  const size_t				  restart,
+									  const char				 *const name)
+{
+	/* a restart record starts with a zero shared prefix */
+	const char *const p = c->data + c->records_offs + c->restarts[restart];
+	const size_t avail = c->size - c->records_offs - c->restarts[restart];
+	const char *const end = (avail > 2) ?
+		memchr(p + 2, c->sep, avail - 2) : NULL;
+
+	if (end == NULL || p[0] != '0' || p[1] != c->sep) {
+		return 0;
+	}
+
+	const size_t size = (size_t) (end - p) - 2;
+	const size_t name_size = strlen(name);
+	const int r = memcmp(p + 2, name, (size < name_size) ? size : name_size);
+
+	if (r != 0) {
+		return r;
+	}
+
+	return (size < name_size) ? -1 : (size > name_size) ? 1 : 0;
+}
+
+int tze_compact_find(const struct tze_compact_t  *c,
+					 const char					 *const name,
+					 struct tze_compact_cursor_t *cursor,
+					 struct tze_compact_rec_t	 *rec)
+{
+	size_t lo = 0;
+	size_t hi = c->restart_count;
+
+	/* the last restart record not greater than a name */
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+
+		if (tze_compact_restart_compar(c, mid, name) <= 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (lo == 0) {
+		return 0;
+	}
+
+	tze_compact_restart(c, cursor, lo - 1);
+
+	for (size_t i = 0; i < c->interval; i++) {
+		const int ret = tze_compact_next(c, cursor, rec);
+
+		if (ret <= 0) {
+			return ret;
+		}
+
+		const int r = strcmp(rec->name, name);
+
+		if (r >= 0) {
+			return (r == 0) ? 1 : 0;
+		}
+	}
+
+	return 0;
+}
+
+int tze_compact_seek(const struct tze_compact_t  *c,
+					 const size_t				  index,
+					 struct tze_compact_cursor_t *cursor,
+					 struct tze_compact_rec_t	 *rec)
+{
+	if (index >= c->name_count) {
+		return 0;
+	}
+
+	tze_compact_restart(c, cursor, index / c->interval);
+
+	while (1) {
+		const int ret = tze_compact_next(c, cursor, rec);
+
+		if (ret <= 0 || rec->index == index) {
+			return ret;
+		}
+	}
+}
+
+long tze_compact_prefix(const struct tze_compact_t *c,
+						const char				   *const prefix,
+						size_t					   *count)
+{
+	if (c->trie.count > 1) {
+		return (long) tze_trie_prefix(&c->trie, prefix, count);
+	}
+
+	struct tze_compact_cursor_t cursor;
+	struct tze_compact_rec_t rec;
+	const size_t prefix_size = strlen(prefix);
+	size_t lo = 0;
+	size_t hi = c->restart_count;
+	int ret;
+
+	/* a lower bound scan from the last restart record before a prefix */
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+
+		if (tze_compact_restart_compar(c, mid, prefix) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	tze_compact_restart(c, &cursor, (lo == 0) ? 0 : lo - 1);
+	*count = 0;
+
+	do {
+		ret = tze_compact_next(c, &cursor, &rec);
+	} while (ret > 0 && strcmp(rec.name, prefix) < 0);
+
+	const size_t first = (ret > 0) ? rec.index : c->name_count;
+
+	while (ret > 0 && strncmp(rec.name, prefix, prefix_size) == 0) {
+		(*count)++;
+		ret = tze_compact_next(c, &cursor, &rec);
+	}
+
+	return (ret < 0) ? -1 : (long) first;
+}
+
+struct tze_compact_link_t {
+	char   *name;
+	size_t	loc_index;
+};
+
+static int tze_compact_loc_compar(const void *l,
+								  const void *r)
+{
+	const struct tze_locality_t *const *ll = l;
+	const struct tze_locality_t *const *rl = r;
+
+	return tze_name_compar((*ll)->name, (*rl)->name);
+}
+
+static int tze_compact_link_compar(const void *l,
+								   const void *r)
+{
+	const struct tze_compact_link_t *ll = l;
+	const struct tze_compact_link_t *rl = r;
+
+	return tze_name_compar(ll->name, rl->name);
+}
+
+int tze_compact_expand(const struct tze_compact_t *c,
+					   struct tze_list_t		  *loc_list,
+					   struct tze_err_t			  *err)
+{
+	int ret = -1;
+	size_t link_count = 0;
+	size_t loc_count = 0;
+	struct tze_locality_t **locs = calloc(c->name_count + 1, sizeof(*locs));
+	struct tze_locality_t **sorted = malloc(sizeof(*sorted) *
+											(c->name_count + 1));
+	struct tze_compact_link_t *links = malloc(sizeof(*links) *
+											  (c->name_count + 1));
+	struct tze_compact_cursor_t *cursor = malloc(sizeof(*cursor));
+	struct tze_compact_rec_t rec;
+
+	if (locs == NULL || sorted == NULL || links == NULL || cursor == NULL) {
+		tze_err_set(err, ENOMEM, "unable to expand a compact table");
+		goto out;
+	}
+
+	tze_compact_restart(c, cursor, 0);
+
+	while (1) {
+		const int n = tze_compact_next(c, cursor, &rec);
+
+		if (n < 0) {
+			tze_err_set(err, EINVAL, "malformed record %zu", cursor->index);
+			goto out;
+		}
+
+		if (n == 0) {
+			break;
+		}
+
+		if (rec.loc_index != rec.index) {
+			links[link_count].name = strdup(rec.name);
+			links[link_count].loc_index = rec.loc_index;
+
+			if (links[link_count++].name == NULL) {
+				tze_err_set(err, ENOMEM, "unable to expand a compact table");
+				goto out;
+			}
+
+			continue;
+		}
+
+		char *const rule = strndup(rec.rule, rec.rule_size);
+
+		locs[rec.index] = (rule == NULL) ?
+			NULL : tze_locality_alloc(rec.name, rule);
+		free(rule);
+
+		if (locs[rec.index] == NULL) {
+			tze_err_set(err, ENOMEM, "unable to expand a compact table");
+			goto out;
+		}
+
+		sorted[loc_count++] = locs[rec.index];
+	}
+
+	qsort(links, link_count, sizeof(*links), tze_compact_link_compar);
+
+	for (size_t i = 0; i < link_count; i++) {
+		struct tze_locality_t *loc = locs[links[i].loc_index];
+
+		if (loc == NULL) {
+			tze_err_set(err, EINVAL, "%s: a link to a link", links[i].name);
+			goto out;
+		}
+
+		if (tze_locality_add_link(loc, c->sep, links[i].name) != 0) {
+			tze_err_set(err, errno, "unable to add \"%s\" link",
+						links[i].name);
+			goto out;
+		}
+	}
+
+	qsort(sorted, loc_count, sizeof(*sorted), tze_compact_loc_compar);
+
+	for (size_t i = 0; i < loc_count; i++) {
+		tze_list_add_tail(loc_list, &sorted[i]->list);
+	}
+
+	loc_count = 0;
+	ret = 0;
+
+out:
+	for (size_t i = 0; locs != NULL && i < loc_count; i++) {
+		tze_locality_free(sorted[i]);
+	}
+
+	for (size_t i = 0; i < link_count; i++) {
+		free(links[i].name);
+	}
+
+	free(locs);
+	free(sorted);
+	free(links);
+	free(cursor);
+
+	return ret;
+}
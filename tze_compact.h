@@ -0,0 +1,148 @@
+#ifndef TZE_COMPACT_H
+#define TZE_COMPACT_H
+
+#include <stdio.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "tze_trie.h"
+
+/**
+ * A compact table is a text file of a header, a rule table, a restart
+ * table and front-coded name records sorted by strcmp(3):
+ *
+ *   TZC1{sep}{rule count}{sep}{name count}{sep}{restart interval}
+ *   {rule}									one per line
+ *   {offset}[{sep}{offset}...]				of every restart record
+ *   {node count}
+ *   {level}{sep}{label}{sep}{first record}{sep}{record count}	trie nodes
+ *   {shared}{sep}{suffix}{sep}{rule index}	a locality
+ *   {shared}{sep}{suffix}{sep}{rule index}{sep}{locality index}	a link
+ *
+ * A name is a {shared} prefix of a previous name followed by a suffix,
+ * every restart record holds a full name. Restart offsets are relative
+ * to a first record and allow a binary search over restart names.
+ * Trie nodes are in a preorder, see tze_trie_print(), without them
+ * a prefix lookup falls back to a binary search.
+ **/
+
+#define TZE_COMPACT_MAGIC				"TZC1"
+#define TZE_COMPACT_RESTART				(16)
+#define TZE_COMPACT_NAME_MAX			PATH_MAX
+
+struct tze_err_t;
+struct tze_list_t;
+struct tze_index_t;
+
+struct tze_compact_str_t {
+	size_t offs;
+	size_t size;
+};
+
+struct tze_compact_t {
+	const char				 *data;
+	size_t					  size;
+	char					 *buf;		/* owned data of a loaded file	 */
+	char					  sep;
+	size_t					  rule_count;
+	size_t					  name_count;
+	size_t					  interval;
+	struct tze_compact_str_t *rules;
+	size_t					 *restarts;
+	size_t					  restart_count;
+	size_t					  records_offs;
+	struct tze_trie_t		  trie;
+};
+
+struct tze_compact_cursor_t {
+	size_t offs;						/* of a next record				 */
+	size_t index;						/* of a next record				 */
+	size_t name_size;
+	char   name[TZE_COMPACT_NAME_MAX];
+};
+
+struct tze_compact_rec_t {
+	const char *name;					/* valid until a cursor moves	 */
+	size_t		index;
+	const char *rule;					/* not NUL terminated			 */
+	size_t		rule_size;
+	size_t		loc_index;				/* equals index for a locality	 */
+};
+
+/**
+ * The trie section is optional and has no nodes unless requested.
+ **/
+
+int tze_compact_print(FILE					   *out,
+					  const struct tze_index_t *index,
+					  const char				sep,
+					  const bool				trie,
+					  struct tze_err_t		   *err);
+
+/**
+ * Opens a compact table in memory, the data should outlive it.
+ **/
+
+int tze_compact_open(struct tze_compact_t *c,
+					 const char			  *data,
+					 const size_t		   size,
+					 struct tze_err_t	  *err);
+
+int tze_compact_load(struct tze_compact_t *c,
+					 const char			  *const file_name,
+					 struct tze_err_t	  *err);
+
+void tze_compact_close(struct tze_compact_t *c);
+
+/**
+ * Positions a cursor at a restart record.
+ **/
+
+void tze_compact_restart(const struct tze_compact_t  *c,
+						 struct tze_compact_cursor_t *cursor,
+						 const size_t				  restart);
+
+/**
+ * Decodes a next record, returns 0 at the end and -1 on malformed data.
+ **/
+
+int tze_compact_next(const struct tze_compact_t  *c,
+					 struct tze_compact_cursor_t *cursor,
+					 struct tze_compact_rec_t	 *rec);
+
+/**
+ * Finds a record by a name or by an index, a binary search over restart
+ * records is followed by a scan of at most one restart interval.
+ * Return 1 when found, 0 when not and -1 on malformed data.
+ **/
+
+int tze_compact_find(const struct tze_compact_t  *c,
+					 const char					 *const name,
+					 struct tze_compact_cursor_t *cursor,
+					 struct tze_compact_rec_t	 *rec);
+
+int tze_compact_seek(const struct tze_compact_t  *c,
+					 const size_t				  index,
+					 struct tze_compact_cursor_t *cursor,
+					 struct tze_compact_rec_t	 *rec);
+
+/**
+ * Finds a record range of names starting with a prefix,
+ * returns a first record index and sets a number of records.
+ * Returns -1 on malformed data.
+ **/
+
+long tze_compact_prefix(const struct tze_compact_t *c,
+						const char				   *const prefix,
+						size_t					   *count);
+
+/**
+ * Decodes a whole table back to a locality list
+ * sorted by tze_name_compar().
+ **/
+
+int tze_compact_expand(const struct tze_compact_t *c,
+					   struct tze_list_t		  *loc_list,
+					   struct tze_err_t			  *err);
+
+#endif /* TZE_COMPACT_H */
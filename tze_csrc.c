@@ -0,0 +1,357 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdbool.h>
+#include "tze_err.h"
+#include "tze_csrc.h"
+#include "tze_hash.h"
+#include "tze_index.h"
+#include "tze_version.h"
+#include "tze_locality.h"
+
+#define TZE_CSRC_SEED_MAX				(1u << 24)
+#define TZE_CSRC_ITEMS_PER_LINE			(8)
+
+struct tze_csrc_bucket_t {
+	uint32_t id;
+	uint32_t size;
+	uint32_t start;						/* in a bucketed key array		 */
+};
+
+/**
+ * Hash and displace: names are spread over n buckets with a zero seed,
+ * then starting from the largest bucket a seed placing all of its names
+ * to free slots is searched for. Single name buckets take the remaining
+ * free slots directly and store them as negative displacements.
+ **/
+
+static int tze_csrc_mph(const struct tze_index_t *index,
+						int32_t					 *disp,
+						uint32_t				 *slots)
+{
+	const uint32_t n = (uint32_t) index->count;
+	int ret = -1;
+	struct tze_csrc_bucket_t *buckets = calloc(n, sizeof(*buckets));
+	uint32_t *keys = malloc(sizeof(*keys) * n);
+	uint32_t *cand = malloc(sizeof(*cand) * n);
+	bool *used = calloc(n, sizeof(*used));
+
+	if (buckets == NULL || keys == NULL || cand == NULL || used == NULL) {
+		errno = ENOMEM;
+		goto out;
+	}
+
+	for (uint32_t i = 0; i < n; i++) {
+		buckets[i].id = i;
+	}
+
+	for (uint32_t i = 0; i < n; i++) {
+		buckets[tze_csrc_hash(0, index->entries[i].name) % n].size++;
+	}
+
+	for (uint32_t i = 0, start = 0; i < n; i++) {
+		buckets[i].start = start;
+		start += buckets[i].size;
+		buckets[i].size = 0;
+	}
+
+	for (uint32_t i = 0; i < n; i++) {
+		struct tze_csrc_bucket_t *b =
+			&buckets[tze_csrc_hash(0, index->entries[i].name) % n];
+
+		keys[b->start + b->size++] = i;
+	}
+
+	/* largest buckets first, a counting sort keeps it linear */
+	struct tze_csrc_bucket_t *sorted = malloc(sizeof(*sorted) * n);
+	uint32_t *counts = calloc(n + 1, sizeof(*counts));
+
+	if (sorted == NULL || counts == NULL) {
+		free(sorted);
+		free(counts);
+		errno = ENOMEM;
+		goto out;
+	}
+
+	for (uint32_t i = 0; i < n; i++) {
+		counts[buckets[i].size]++;
+	}
+
+	for (uint32_t size = n, start = 0; size != UINT32_MAX; size--) {
+		const uint32_t count = counts[size];
+
+		counts[size] = start;
+		start += count;
+	}
+
+	for (uint32_t i = 0; i < n; i++) {
+		sorted[counts[buckets[i].size]++] = buckets[i];
+	}
+
+	free(counts);
+
+	uint32_t b = 0;
+
+	for (; b < n && sorted[b].size > 1; b++) {
+		const struct tze_csrc_bucket_t *bucket = &sorted[b];
+		uint32_t seed = 1;
+
+		for (; seed < TZE_CSRC_SEED_MAX; seed++) {
+			uint32_t k = 0;
+
+			for (; k < bucket->size; k++) {
+				const uint32_t key = keys[bucket->start + k];
+				const uint32_t slot =
+					tze_csrc_hash(seed, index->entries[key].name) % n;
+				bool taken = used[slot];
+
+				for (uint32_t j = 0; j < k && !taken; j++) {
+					taken = (cand[j] == slot);
+				}
+
+				if (taken) {
+					break;
+				}
+
+				cand[k] = slot;
+			}
+
+			if (k == bucket->size) {
+				break;
+			}
+		}
+
+		if (seed == TZE_CSRC_SEED_MAX) {
+			free(sorted);
+			errno = EAGAIN;
+			goto out;
+		}
+
+		for (uint32_t k = 0; k < bucket->size; k++) {
+			used[cand[k]] = true;
+			slots[cand[k]] = keys[bucket->start + k];
+		}
+
+		disp[bucket->id] = (int32_t) seed;
+	}
+
+	for (uint32_t slot = 0; b < n && sorted[b].size == 1; b++) {
+		while (used[slot]) {
+			slot++;
+		}
+
+		used[slot] = true;
+		slots[slot] = keys[sorted[b].start];
+		disp[sorted[b].id] = -(int32_t) slot - 1;
+	}
+
+	for (; b < n; b++) {
+		disp[sorted[b].id] = 0;
+	}
+
+	free(sorted);
+	ret = 0;
+
+out:
+	free(buckets);
+	free(keys);
+	free(cand);
+	free(used);
+
+	return ret;
+}
+
+static void tze_csrc_print_str(FILE		  *out,
+							   const char *const str)
+{
+	fputs("\t\"", out);
+
+	for (const unsigned char *p = (const unsigned char *) str; *p; p++) {
+		if (*p == '"' || *p == '\\' || *p == '?') {
+			/* "?" breaks trigraphs */
+			fprintf(out, "\\%c", *p);
+		} else if (*p < 0x20 || *p > 0x7e) {
+			fprintf(out, "\\%03o", *p);
+		} else {
+			fputc(*p, out);
+		}
+	}
+
+	fputs("\\0\"\n", out);
+}
+
+static const char TZE_CSRC_PROLOGUE[] =
+	"#include <stddef.h>\n"
+	"#include <stdint.h>\n"
+	"#include <string.h>\n"
+	"\n"
+	"struct tze_zone_slot_t {\n"
+	"\tuint32_t name;\n"
+	"\tuint32_t canonical;\n"
+	"\tuint32_t rule;\n"
+	"};\n"
+	"\n"
+	"const char *tze_zone_rule(const char *name);\n"
+	"const char *tze_zone_canonical(const char *name);\n";
+
+static const char TZE_CSRC_LOOKUP[] =
+	"static uint32_t tze_zone_hash(const uint32_t  seed,\n"
+	"\t\t\t\t\t\t\t  const char\t\t*const str)\n"
+	"{\n"
+	"\tconst unsigned char *p = (const unsigned char *) str;\n"
+	"\tuint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);\n"
+	"\n"
+	"\twhile (*p != '\\0') {\n"
+	"\t\thash ^= *p++;\n"
+	"\t\thash *= 16777619u;\n"
+	"\t}\n"
+	"\n"
+	"\treturn hash;\n"
+	"}\n"
+	"\n"
+	"static const struct tze_zone_slot_t *tze_zone_find(const char *name)\n"
+	"{\n"
+	"\tconst int32_t disp =\n"
+	"\t\ttze_zone_disp[tze_zone_hash(0, name) % TZE_ZONE_COUNT];\n"
+	"\tconst uint32_t i = (disp < 0) ? (uint32_t) (-disp - 1) :\n"
+	"\t\ttze_zone_hash((uint32_t) disp, name) % TZE_ZONE_COUNT;\n"
+	"\tconst struct tze_zone_slot_t *slot = &tze_zone_slots[i];\n"
+	"\n"
+	"\treturn (strcmp(tze_zone_strings + slot->name, name) == 0) ?\n"
+	"\t\tslot : NULL;\n"
+	"}\n"
+	"\n"
+	"const char *tze_zone_rule(const char *name)\n"
+	"{\n"
+	"\tconst struct tze_zone_slot_t *slot = tze_zone_find(name);\n"
+	"\n"
+	"\treturn (slot == NULL) ? NULL :\n"
+	"\t\ttze_zone_strings + tze_zone_rules[slot->rule];\n"
+	"}\n"
+	"\n"
+	"const char *tze_zone_canonical(const char *name)\n"
+	"{\n"
+	"\tconst struct tze_zone_slot_t *slot = tze_zone_find(name);\n"
+	"\n"
+	"\treturn (slot == NULL) ? NULL : tze_zone_strings + slot->canonical;\n"
+	"}\n";
+
+int tze_csrc_print(FILE						*out,
+				   const struct tze_index_t *index,
+				   struct tze_err_t			*err)
+{
+	const size_t n = index->count;
+	int ret = -1;
+	struct tze_hash_t offsets = TZE_HASH_INIT;
+	struct tze_hash_t rules = TZE_HASH_INIT;
+	int32_t *disp = calloc(n, sizeof(*disp));
+	uint32_t *slots = calloc(n, sizeof(*slots));
+	uint32_t *rule_offsets = malloc(sizeof(*rule_offsets) * n);
+	size_t rule_count = 0;
+	size_t offs = 0;
+
+	if (disp == NULL || slots == NULL || rule_offsets == NULL) {
+		tze_err_set(err, ENOMEM, "unable to allocate a perfect hash");
+		goto out;
+	}
+
+	if (n == 0 || n > INT32_MAX || tze_csrc_mph(index, disp, slots) < 0) {
+		tze_err_set(err, (n == 0) ? EINVAL : errno,
+					"unable to build a perfect hash");
+		goto out;
+	}
+
+	fprintf(out, "/* Generated by tze v%s, do not edit. */\n\n%s\n",
+			TZE_VERSION, TZE_CSRC_PROLOGUE);
+	fprintf(out, "#define TZE_ZONE_COUNT\t\t\t\t\t(%zuu)\n\n", n);
+
+	/* names first, then every distinct rule once */
+	fputs("static const char tze_zone_strings[] =\n", out);
+
+	for (size_t i = 0; i < n; i++) {
+		const char *const name = index->entries[i].name;
+
+		if (tze_hash_put(&offsets, name, (void *) (offs + 1)) < 0) {
+			goto no_memory;
+		}
+
+		tze_csrc_print_str(out, name);
+		offs += strlen(name) + 1;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		const char *const rule = index->entries[i].loc->rule;
+
+		if (tze_hash_has(&rules, rule)) {
+			continue;
+		}
+
+		if (tze_hash_put(&rules, rule, (void *) (rule_count + 1)) < 0) {
+			goto no_memory;
+		}
+
+		rule_offsets[rule_count++] = (uint32_t) offs;
+		tze_csrc_print_str(out, rule);
+		offs += strlen(rule) + 1;
+	}
+
+	if (offs > UINT32_MAX) {
+		tze_err_set(err, EFBIG, "too large a string table");
+		goto out;
+	}
+
+	fputs(";\n\nstatic const uint32_t tze_zone_rules[] = {", out);
+
+	for (size_t i = 0; i < rule_count; i++) {
+		fprintf(out, "%s%" PRIu32 "%s",
+				(i % TZE_CSRC_ITEMS_PER_LINE == 0) ? "\n\t" : " ",
+				rule_offsets[i], (i + 1 < rule_count) ? "," : "");
+	}
+
+	fputs("\n};\n\nstatic const int32_t tze_zone_disp[TZE_ZONE_COUNT] = {",
+		  out);
+
+	for (size_t i = 0; i < n; i++) {
+		fprintf(out, "%s%" PRId32 "%s",
+				(i % TZE_CSRC_ITEMS_PER_LINE == 0) ? "\n\t" : " ",
+				disp[i], (i + 1 < n) ? "," : "");
+	}
+
+	fputs("\n};\n\nstatic const struct tze_zone_slot_t "
+		  "tze_zone_slots[TZE_ZONE_COUNT] = {\n", out);
+
+	for (size_t i = 0; i < n; i++) {
+		const struct tze_index_entry_t *e = &index->entries[slots[i]];
+
+		fprintf(out, "\t{ %zu, %zu, %zu }%s\n",
+				(size_t) tze_hash_get(&offsets, e->name) - 1,
+				(size_t) tze_hash_get(&offsets, e->loc->name) - 1,
+				(size_t) tze_hash_get(&rules, e->loc->rule) - 1,
+				(i + 1 < n) ? "," : "");
+	}
+
+	fprintf(out, "};\n\n%s", TZE_CSRC_LOOKUP);
+
+	if (ferror(out)) {
+		tze_err_set(err, errno, "unable to write a C source");
+		goto out;
+	}
+
+	ret = 0;
+	goto out;
+
+no_memory:
+	tze_err_set(err, ENOMEM, "unable to intern names");
+
+out:
+	tze_hash_free(&offsets);
+	tze_hash_free(&rules);
+	free(disp);
+	free(slots);
+	free(rule_offsets);
+
+	return ret;
+}
@@ -0,0 +1,43 @@
+#ifndef TZE_CSRC_H
+#define TZE_CSRC_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * Emits a C translation unit of a locality table: interned rules,
+ * a name table and a minimal perfect hash over locality and link names.
+ * The generated unit exports:
+ *
+ *   const char *tze_zone_rule(const char *name);
+ *   const char *tze_zone_canonical(const char *name);
+ *
+ * both return NULL for unknown names. All generated data is constant.
+ **/
+
+struct tze_err_t;
+struct tze_index_t;
+
+/**
+ * A seeded FNV-1a, the generated lookup function repeats it verbatim.
+ **/
+
+static inline uint32_t tze_csrc_hash(const uint32_t  seed,
+									 const char		*const str)
+{
+	const unsigned char *p = (const unsigned char *) str;
+	uint32_t hash = 2166136261u ^ (seed * 0x9e3779b9u);
+
+	while (*p != '\0') {
+		hash ^= *p++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+int tze_csrc_print(FILE						*out,
+				   const struct tze_index_t *index,
+				   struct tze_err_t			*err);
+
+#endif /* TZE_CSRC_H */
@@ -0,0 +1,117 @@
+#ifndef TZE_DEQUE_H
+#define TZE_DEQUE_H
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/**
+ * A work-stealing deque of tasks. An owner pushes and pops tasks
+ * at the bottom, depth first, while thieves steal the oldest ones
+ * from the top, i.e. the biggest subtrees of a traversal.
+ * Every operation takes a deque lock, tasks are few and coarse.
+ **/
+
+#define TZE_DEQUE_MIN_CAPACITY			(16)
+
+struct tze_deque_t {
+	void			**tasks;
+	size_t			  capacity;
+	size_t			  top;
+	size_t			  bottom;
+	pthread_mutex_t	  lock;
+};
+
+static inline int tze_deque_init(struct tze_deque_t *deque)
+{
+	deque->tasks = NULL;
+	deque->capacity = 0;
+	deque->top = 0;
+	deque->bottom = 0;
+
+	return pthread_mutex_init(&deque->lock, NULL);
+}
+
+static inline int tze_deque_push(struct tze_deque_t *deque,
+								 void				*task)
+{
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->bottom == deque->capacity) {
+		/* compact first, grow when still full */
+		const size_t count = deque->bottom - deque->top;
+		size_t capacity = deque->capacity;
+
+		if (count * 2 > capacity || capacity == 0) {
+			capacity = (capacity == 0) ? TZE_DEQUE_MIN_CAPACITY : capacity * 2;
+		}
+
+		void **tasks = (capacity == deque->capacity) ? deque->tasks :
+			realloc(deque->tasks, sizeof(*tasks) * capacity);
+
+		if (tasks == NULL) {
+			pthread_mutex_unlock(&deque->lock);
+			errno = ENOMEM;
+			return -1;
+		}
+
+		memmove(tasks, tasks + deque->top, sizeof(*tasks) * count);
+		deque->tasks = tasks;
+		deque->capacity = capacity;
+		deque->top = 0;
+		deque->bottom = count;
+	}
+
+	deque->tasks[deque->bottom++] = task;
+	pthread_mutex_unlock(&deque->lock);
+
+	return 0;
+}
+
+static inline void *tze_deque_pop(struct tze_deque_t *deque)
+{
+	void *task = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->bottom > deque->top) {
+		task = deque->tasks[--deque->bottom];
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+
+	return task;
+}
+
+static inline void *tze_deque_steal(struct tze_deque_t *deque)
+{
+	void *task = NULL;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->bottom > deque->top) {
+		task = deque->tasks[deque->top++];
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+
+	return task;
+}
+
+/**
+ * Tasks left are not released.
+ **/
+
+static inline void tze_deque_free(struct tze_deque_t *deque)
+{
+	free(deque->tasks);
+	deque->tasks = NULL;
+	deque->capacity = 0;
+	deque->top = 0;
+	deque->bottom = 0;
+	pthread_mutex_destroy(&deque->lock);
+}
+
+#endif /* TZE_DEQUE_H */
@@ -0,0 +1,331 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "tze_err.h"
+#include "tze_diff.h"
+#include "tze_list.h"
+#include "tze_name.h"
+#include "tze_locality.h"
+
+#define TZE_DIFF_TMP_SUFFIX				".XXXXXX"
+
+static int tze_diff_print_loc(FILE						  *out,
+							  const char				   op,
+							  const struct tze_locality_t *loc,
+							  const char				   sep)
+{
+	if (loc->links == NULL) {
+		return fprintf(out, "%c%s%c%s\n", op, loc->name, sep, loc->rule);
+	}
+
+	return fprintf(out, "%c%s%c%s%c%s\n",
+				   op, loc->name, sep, loc->links, sep, loc->rule);
+}
+
+static bool tze_diff_loc_changed(const struct tze_locality_t *old_loc,
+								 const struct tze_locality_t *new_loc)
+{
+	if (strcmp(old_loc->rule, new_loc->rule) != 0) {
+		return true;
+	}
+
+	if (old_loc->links == NULL || new_loc->links == NULL) {
+		return (old_loc->links != new_loc->links) ? true : false;
+	}
+
+	return (strcmp(old_loc->links, new_loc->links) != 0) ? true : false;
+}
+
+long tze_diff_print(FILE					*out,
+					const struct tze_list_t *old_list,
+					const struct tze_list_t *new_list,
+					const char				 sep,
+					struct tze_err_t		*err)
+{
+	const struct tze_list_t *o = old_list->next;
+	const struct tze_list_t *n = new_list->next;
+	long count = 0;
+
+	while (o != old_list || n != new_list) {
+		const struct tze_locality_t *old_loc = (o == old_list) ? NULL :
+			tze_list_entry(o, struct tze_locality_t, list);
+		const struct tze_locality_t *new_loc = (n == new_list) ? NULL :
+			tze_list_entry(n, struct tze_locality_t, list);
+		int cmp = 0;
+		int ret = 0;
+
+		if (old_loc == NULL) {
+			cmp = 1;
+		} else if (new_loc == NULL) {
+			cmp = -1;
+		} else {
+			cmp = tze_name_compar(old_loc->name, new_loc->name);
+		}
+
+		if (cmp < 0) {
+			ret = fprintf(out, "%c%s\n", TZE_DIFF_REMOVE, old_loc->name);
+			o = o->next;
+			count++;
+		} else if (cmp > 0) {
+			ret = tze_diff_print_loc(out, TZE_DIFF_ADD, new_loc, sep);
+			n = n->next;
+			count++;
+		} else {
+			if (tze_diff_loc_changed(old_loc, new_loc)) {
+				ret = tze_diff_print_loc(out, TZE_DIFF_CHANGE, new_loc, sep);
+				count++;
+			}
+
+			o = o->next;
+			n = n->next;
+		}
+
+		if (ret < 0) {
+			tze_err_set(err, errno, "unable to write a patch");
+			return -1;
+		}
+	}
+
+	return count;
+}
+
+struct tze_diff_line_t {
+	char	*line;
+	size_t	 capacity;
+	ssize_t	 size;
+	size_t	 number;
+	char	*name;			/* a NUL terminated name copy */
+	size_t	 name_capacity;
+};
+
+static int tze_diff_line_read(FILE					 *fp,
+							  const char			  *const file_name,
+							  const bool			   patch,
+							  const char			   sep,
+							  struct tze_diff_line_t *l,
+							  struct tze_err_t		 *err)
+{
+	errno = 0;
+	l->size = getline(&l->line, &l->capacity, fp);
+
+	if (l->size < 0) {
+		if (errno != 0) {
+			tze_err_set(err, errno, "%s: unable to read", file_name);
+			return -1;
+		}
+
+		/* end of file */
+		return 0;
+	}
+
+	l->number++;
+
+	const char *name = l->line;
+
+	if (patch) {
+		if (*name != TZE_DIFF_ADD &&
+			*name != TZE_DIFF_CHANGE &&
+			*name != TZE_DIFF_REMOVE) {
+			tze_err_set(err, 0, "%s:%zu: unknown patch record",
+						file_name, l->number);
+			return -1;
+		}
+
+		name++;
+	}
+
+	const char *end = name;
+
+	while (*end != '\0' && *end != '\n' && *end != sep) {
+		end++;
+	}
+
+	const size_t name_size = (size_t) (end - name);
+
+	if (name_size == 0 ||
+		(*end != sep && !(patch && *l->line == TZE_DIFF_REMOVE))) {
+		tze_err_set(err, 0, "%s:%zu: malformed record",
+					file_name, l->number);
+		return -1;
+	}
+
+	if (name_size >= l->name_capacity) {
+		char *p = realloc(l->name, name_size + 1);
+
+		if (p == NULL) {
+			tze_err_set(err, errno, "%s: unable to allocate a name",
+						file_name);
+			return -1;
+		}
+
+		l->name = p;
+		l->name_capacity = name_size + 1;
+	}
+
+	memcpy(l->name, name, name_size);
+	l->name[name_size] = '\0';
+
+	return 1;
+}
+
+/**
+ * Writes a record as a complete line, a last line of a file
+ * may have no trailing newline.
+ **/
+
+static int tze_diff_line_write(FILE		  *out,
+							   const char *const line,
+							   const size_t size)
+{
+	if (fwrite(line, 1, size, out) != size) {
+		return -1;
+	}
+
+	if ((size == 0 || line[size - 1] != '\n') && fputc('\n', out) == EOF) {
+		return -1;
+	}
+
+	return 0;
+}
+
+int tze_diff_apply(const char		*const patch_name,
+				   const char		*const table_name,
+				   const char		 sep,
+				   struct tze_err_t *err)
+{
+	int ret = -1;
+	struct tze_diff_line_t p = { .number = 0 };
+	struct tze_diff_line_t t = { .number = 0 };
+	FILE *patch = fopen(patch_name, "r");
+	FILE *table = NULL;
+	FILE *out = NULL;
+	char *tmp_name = NULL;
+
+	if (patch == NULL) {
+		tze_err_set(err, errno, "%s: unable to open", patch_name);
+		return -1;
+	}
+
+	table = fopen(table_name, "r");
+
+	if (table == NULL) {
+		tze_err_set(err, errno, "%s: unable to open", table_name);
+		goto close_files;
+	}
+
+	tmp_name = malloc(strlen(table_name) + sizeof(TZE_DIFF_TMP_SUFFIX));
+
+	if (tmp_name == NULL) {
+		tze_err_set(err, errno, "unable to allocate a file name");
+		goto close_files;
+	}
+
+	strcpy(tmp_name, table_name);
+	strcat(tmp_name, TZE_DIFF_TMP_SUFFIX);
+
+	const int fd = mkstemp(tmp_name);
+
+	if (fd < 0 || (out = fdopen(fd, "w")) == NULL) {
+		tze_err_set(err, errno, "%s: unable to create", tmp_name);
+
+		if (fd >= 0) {
+			close(fd);
+			unlink(tmp_name);
+		}
+
+		goto close_files;
+	}
+
+	struct stat st;
+
+	if (fstat(fileno(table), &st) == 0) {
+		/* keep table file permissions */
+		fchmod(fd, st.st_mode & 07777);
+	}
+
+	int has_p = tze_diff_line_read(patch, patch_name, true, sep, &p, err);
+	int has_t = tze_diff_line_read(table, table_name, false, sep, &t, err);
+
+	while (has_p > 0 || has_t > 0) {
+		if (has_p < 0 || has_t < 0) {
+			goto remove_tmp;
+		}
+
+		const int cmp = (has_p == 0) ? 1 : (has_t == 0) ? -1 :
+			tze_name_compar(p.name, t.name);
+		const char op = (has_p > 0) ? *p.line : '\0';
+
+		if (cmp > 0) {
+			/* an untouched table line */
+			if (tze_diff_line_write(out, t.line, (size_t) t.size) < 0) {
+				goto write_error;
+			}
+
+			has_t = tze_diff_line_read(table, table_name, false, sep, &t, err);
+			continue;
+		}
+
+		if ((cmp < 0 && op != TZE_DIFF_ADD) ||
+			(cmp == 0 && op == TZE_DIFF_ADD)) {
+			tze_err_set(err, 0, "%s:%zu: \"%s\" %s in %s",
+						patch_name, p.number, p.name,
+						(cmp < 0) ? "not found" : "already exists",
+						table_name);
+			goto remove_tmp;
+		}
+
+		if (op != TZE_DIFF_REMOVE &&
+			tze_diff_line_write(out, p.line + 1, (size_t) p.size - 1) < 0) {
+			goto write_error;
+		}
+
+		if (cmp == 0) {
+			has_t = tze_diff_line_read(table, table_name, false, sep, &t, err);
+		}
+
+		has_p = tze_diff_line_read(patch, patch_name, true, sep, &p, err);
+	}
+
+	if (has_p < 0 || has_t < 0) {
+		goto remove_tmp;
+	}
+
+	if (fflush(out) != 0 || fsync(fileno(out)) != 0) {
+		goto write_error;
+	}
+
+	if (rename(tmp_name, table_name) < 0) {
+		tze_err_set(err, errno, "%s: unable to replace", table_name);
+		goto remove_tmp;
+	}
+
+	ret = 0;
+	goto close_files;
+
+write_error:
+	tze_err_set(err, errno, "%s: unable to write", tmp_name);
+
+remove_tmp:
+	unlink(tmp_name);
+
+close_files:
+	if (out != NULL) {
+		fclose(out);
+	}
+
+	if (table != NULL) {
+		fclose(table);
+	}
+
+	fclose(patch);
+	free(tmp_name);
+	free(p.line);
+	free(p.name);
+	free(t.line);
+	free(t.name);
+
+	return ret;
+}
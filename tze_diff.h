@@ -0,0 +1,45 @@
+#ifndef TZE_DIFF_H
+#define TZE_DIFF_H
+
+#include <stdio.h>
+
+/**
+ * A patch is a sorted list of records, one per line:
+ *
+ *   +{name}{sep}[{links}{sep}]{rule}	an added locality
+ *   ~{name}{sep}[{links}{sep}]{rule}	a changed locality
+ *   -{name}							a removed locality
+ *
+ * Added and changed records are the complete new table lines.
+ **/
+
+#define TZE_DIFF_ADD					'+'
+#define TZE_DIFF_CHANGE					'~'
+#define TZE_DIFF_REMOVE					'-'
+
+struct tze_err_t;
+struct tze_list_t;
+
+/**
+ * Both lists should be sorted by tze_name_compar(), localities of the
+ * same name differ when their rules or link lists are not equal strings.
+ * Returns a number of records written or -1 on error.
+ **/
+
+long tze_diff_print(FILE					*out,
+					const struct tze_list_t *old_list,
+					const struct tze_list_t *new_list,
+					const char				 sep,
+					struct tze_err_t		*err);
+
+/**
+ * Applies a patch to a table file in place, the file is rewritten
+ * to a temporary one and renamed over.
+ **/
+
+int tze_diff_apply(const char		*const patch_name,
+				   const char		*const table_name,
+				   const char		 sep,
+				   struct tze_err_t *err);
+
+#endif /* TZE_DIFF_H */
@@ -0,0 +1,295 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tze_tz.h"
+#include "tze_err.h"
+#include "tze_list.h"
+#include "tze_equiv.h"
+#include "tze_trans.h"
+#include "tze_locality.h"
+
+#define TZE_EQUIV_LEAP_SIZE				(sizeof(int64_t) + sizeof(uint32_t))
+
+static uint64_t tze_equiv_hash(const uint8_t *p,
+							   const size_t	  size)
+{
+	/* 64-bit FNV-1a */
+	uint64_t hash = 14695981039346656037u;
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= 1099511628211u;
+	}
+
+	return hash;
+}
+
+static uint8_t *tze_equiv_put_u64(uint8_t		 *p,
+								  const uint64_t  v)
+{
+	for (size_t i = 0; i < sizeof(v); i++) {
+		*p++ = (uint8_t) (v >> (56 - 8 * i));
+	}
+
+	return p;
+}
+
+/**
+ * A normalized zone is:
+ *
+ *   {type count}{offset}{dst}{abbr}\0...{transition count}{records}
+ *   {leap count}{leaps}{rule}\0
+ *
+ * with counts and offsets as big-endian 64-bit integers and records
+ * of tze_trans_build(), which deduplicates and orders types by a first
+ * use already.
+ **/
+
+static int tze_equiv_normalize(const struct tze_tz_data_t *data,
+							   uint8_t					 **zone,
+							   size_t					  *zone_size,
+							   struct tze_err_t			  *err)
+{
+	struct tze_trans_t trans;
+
+	if (tze_trans_build(&trans, data, err) < 0) {
+		return -1;
+	}
+
+	const size_t leaps_size = data->leap_count * TZE_EQUIV_LEAP_SIZE;
+	size_t size = 3 * sizeof(uint64_t) + trans.size + leaps_size +
+		data->rule_size + 1;
+
+	for (size_t i = 0; i < trans.type_count; i++) {
+		size += sizeof(uint64_t) + 1 + strlen(trans.types[i].abbr) + 1;
+	}
+
+	uint8_t *p = malloc(size);
+
+	if (p == NULL) {
+		tze_err_set(err, ENOMEM, "unable to allocate a normalized zone");
+		tze_trans_free(&trans);
+		return -1;
+	}
+
+	*zone = p;
+	*zone_size = size;
+	p = tze_equiv_put_u64(p, trans.type_count);
+
+	for (size_t i = 0; i < trans.type_count; i++) {
+		const struct tze_trans_type_t *t = &trans.types[i];
+		const size_t abbr_size = strlen(t->abbr) + 1;
+
+		p = tze_equiv_put_u64(p, (uint64_t) (int64_t) t->offset);
+		*p++ = t->dst ? 1 : 0;
+		memcpy(p, t->abbr, abbr_size);
+		p += abbr_size;
+	}
+
+	p = tze_equiv_put_u64(p, trans.count);
+	memcpy(p, trans.data, trans.size);
+	p += trans.size;
+	p = tze_equiv_put_u64(p, data->leap_count);
+	memcpy(p, data->leaps, leaps_size);
+	p += leaps_size;
+	memcpy(p, data->rule, data->rule_size + 1);
+
+	tze_trans_free(&trans);
+
+	return 0;
+}
+
+static int tze_equiv_load(const char *const	  *roots,
+						  const size_t		   root_count,
+						  const char		  *const name,
+						  uint8_t			 **zone,
+						  size_t			  *zone_size,
+						  struct tze_err_t	  *err)
+{
+	char file_name[PATH_MAX];
+	struct tze_tz_data_t data;
+
+	if (tze_tz_locate(roots, root_count, name, file_name, err) < 0) {
+		return -1;
+	}
+
+	const int ret = tze_tz_load(file_name, name, &data, err);
+
+	if (ret != 0) {
+		if (ret > 0) {
+			tze_err_set(err, 0, "%s: not a timezone file", name);
+		}
+
+		return -1;
+	}
+
+	const int norm_ret = tze_equiv_normalize(&data, zone, zone_size, err);
+
+	tze_tz_unload(&data);
+
+	return norm_ret;
+}
+
+/**
+ * Returns a class index of a normalized zone, a new class takes
+ * ownership of it.
+ **/
+
+static size_t tze_equiv_add(struct tze_equiv_t *equiv,
+							uint8_t			   *zone,
+							const size_t		zone_size)
+{
+	const uint64_t hash = tze_equiv_hash(zone, zone_size);
+	const size_t mask = equiv->slot_count - 1;
+	size_t slot = (size_t) (hash ^ (hash >> 32)) & mask;
+
+	while (equiv->slots[slot] != 0) {
+		const size_t index = equiv->slots[slot] - 1;
+		const struct tze_equiv_class_t *c = &equiv->classes[index];
+
+		if (c->hash == hash && c->zone_size == zone_size &&
+			memcmp(c->zone, zone, zone_size) == 0) {
+			free(zone);
+			return index;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+
+	struct tze_equiv_class_t *c = &equiv->classes[equiv->class_count];
+
+	c->hash = hash;
+	c->zone = zone;
+	c->zone_size = zone_size;
+	c->locs = NULL;
+	c->loc_count = 0;
+	equiv->slots[slot] = ++equiv->class_count;
+
+	return equiv->class_count - 1;
+}
+
+int tze_equiv_build(struct tze_equiv_t		*equiv,
+					const char *const		*roots,
+					const size_t			 root_count,
+					const struct tze_list_t *loc_list,
+					struct tze_err_t		*err)
+{
+	struct tze_locality_t *loc;
+	size_t *loc_classes = NULL;
+	size_t count = 0;
+	size_t n = 0;
+
+	*equiv = (struct tze_equiv_t) TZE_EQUIV_INIT;
+
+	tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
+		count++;
+	}
+
+	equiv->slot_count = 1;
+
+	while (equiv->slot_count < count * 2) {
+		equiv->slot_count *= 2;
+	}
+
+	loc_classes = malloc(sizeof(*loc_classes) * (count + 1));
+	equiv->classes = malloc(sizeof(*equiv->classes) * (count + 1));
+	equiv->locs = malloc(sizeof(*equiv->locs) * (count + 1));
+	equiv->slots = calloc(equiv->slot_count, sizeof(*equiv->slots));
+
+	if (loc_classes == NULL || equiv->classes == NULL ||
+		equiv->locs == NULL || equiv->slots == NULL) {
+		tze_err_set(err, ENOMEM, "unable to allocate equivalence classes");
+		goto fail;
+	}
+
+	tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
+		uint8_t *zone;
+		size_t zone_size;
+
+		if (tze_equiv_load(roots, root_count, loc->name,
+						   &zone, &zone_size, err) < 0) {
+			goto fail;
+		}
+
+		loc_classes[n] = tze_equiv_add(equiv, zone, zone_size);
+		equiv->classes[loc_classes[n]].loc_count++;
+		n++;
+	}
+
+	struct tze_locality_t **locs = equiv->locs;
+
+	for (size_t i = 0; i < equiv->class_count; i++) {
+		struct tze_equiv_class_t *c = &equiv->classes[i];
+
+		c->locs = locs;
+		locs += c->loc_count;
+		c->loc_count = 0;
+	}
+
+	n = 0;
+
+	tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
+		struct tze_equiv_class_t *c = &equiv->classes[loc_classes[n++]];
+
+		c->locs[c->loc_count++] = loc;
+	}
+
+	free(loc_classes);
+
+	return 0;
+
+fail:
+	free(loc_classes);
+	tze_equiv_free(equiv);
+	return -1;
+}
+
+int tze_equiv_fold(struct tze_equiv_t *equiv,
+				   const char		   sep,
+				   struct tze_err_t	  *err)
+{
+	int ret = -1;
+
+	for (size_t i = 0; i < equiv->class_count; i++) {
+		const struct tze_equiv_class_t *c = &equiv->classes[i];
+		struct tze_locality_t *first = c->locs[0];
+
+		for (size_t j = 1; j < c->loc_count; j++) {
+			struct tze_locality_t *loc = c->locs[j];
+
+			/* links are joined with a separator already */
+			if (tze_locality_add_link(first, sep, loc->name) < 0 ||
+				(loc->links != NULL &&
+				 tze_locality_add_link(first, sep, loc->links) < 0)) {
+				tze_err_set(err, errno,
+							"%s: unable to add a link for \"%s\" target",
+							loc->name, first->name);
+				goto free_classes;
+			}
+
+			tze_list_del(&loc->list);
+			tze_locality_free(loc);
+			c->locs[j] = NULL;
+		}
+	}
+
+	ret = 0;
+
+free_classes:
+	tze_equiv_free(equiv);
+	return ret;
+}
+
+void tze_equiv_free(struct tze_equiv_t *equiv)
+{
+	for (size_t i = 0; i < equiv->class_count; i++) {
+		free(equiv->classes[i].zone);
+	}
+
+	free(equiv->classes);
+	free(equiv->locs);
+	free(equiv->slots);
+	*equiv = (struct tze_equiv_t) TZE_EQUIV_INIT;
+}
@@ -0,0 +1,73 @@
+#ifndef TZE_EQUIV_H
+#define TZE_EQUIV_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Equivalence classes of localities with equal zone data. A zone is
+ * normalized to its local time types in a first use order, transitions,
+ * leap seconds and a footer rule of a 64-bit block, so a v1 block,
+ * a type order, an abbreviation layout and isstd/isut indicators do not
+ * matter. Zones are hashed and compared in a normalized form, only a
+ * first zone of every class is kept in memory.
+ **/
+
+#define TZE_EQUIV_INIT					\
+	{									\
+		.classes		= 0,			\
+		.class_count	= 0,			\
+		.locs			= 0,			\
+		.slots			= 0,			\
+		.slot_count		= 0				\
+	}
+
+struct tze_err_t;
+struct tze_list_t;
+struct tze_locality_t;
+
+struct tze_equiv_class_t {
+	uint64_t				 hash;
+	uint8_t					*zone;		/* normalized zone data			 */
+	size_t					 zone_size;
+	struct tze_locality_t  **locs;		/* in a locality list order		 */
+	size_t					 loc_count;
+};
+
+struct tze_equiv_t {
+	struct tze_equiv_class_t *classes;
+	size_t					  class_count;
+	struct tze_locality_t	**locs;		/* of all classes				 */
+	size_t					 *slots;	/* class indexes + 1, 0 if empty */
+	size_t					  slot_count;
+};
+
+/**
+ * Zone files are read from the latest root having them,
+ * localities should outlive classes.
+ *
+ * A file is read a second time past a scan on purpose: a scan keeps
+ * a footer rule only, so keeping zone data of every locality until
+ * a merge, or trusting a hash with no data to compare, is avoided at
+ * the cost of another pass over files which are page cache hot.
+ **/
+
+int tze_equiv_build(struct tze_equiv_t		*equiv,
+					const char *const		*roots,
+					const size_t			 root_count,
+					const struct tze_list_t *loc_list,
+					struct tze_err_t		*err);
+
+/**
+ * Reports classes as links: a first locality of every class gets names
+ * and links of the others, which are removed from their locality list
+ * and freed. Classes are released.
+ **/
+
+int tze_equiv_fold(struct tze_equiv_t *equiv,
+				   const char		   sep,
+				   struct tze_err_t	  *err);
+
+void tze_equiv_free(struct tze_equiv_t *equiv);
+
+#endif /* TZE_EQUIV_H */
@@ -0,0 +1,138 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <fnmatch.h>
+#include "tze_filter.h"
+
+#define TZE_FILTER_WILDCARDS			"*?["
+
+int tze_filter_add(struct tze_filter_t *filter,
+				   const bool			include,
+				   const char		   *const pattern)
+{
+	const char **patterns = include ? filter->include : filter->exclude;
+	size_t *count = include ? &filter->include_count : &filter->exclude_count;
+
+	if (*pattern == '\0') {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (*count == TZE_FILTER_PATTERN_MAX) {
+		errno = E2BIG;
+		return -1;
+	}
+
+	patterns[(*count)++] = pattern;
+
+	return 0;
+}
+
+static bool tze_filter_may_match_below(const char *const pattern,
+									   const char *const dir,
+									   const size_t		 dir_size)
+{
+	/**
+	 * A name below "dir/" can match a pattern only when a literal pattern
+	 * prefix (up to the first wildcard) and "dir/" do not diverge.
+	 **/
+
+	const size_t literal_size = strcspn(pattern, TZE_FILTER_WILDCARDS);
+	const size_t size = (literal_size < dir_size) ? literal_size : dir_size;
+
+	if (memcmp(pattern, dir, size) != 0) {
+		return false;
+	}
+
+	if (literal_size <= dir_size) {
+		return true;
+	}
+
+	return (pattern[dir_size] == '/') ? true : false;
+}
+
+bool tze_filter_dir(const struct tze_filter_t *filter,
+					const char				  *const dir)
+{
+	char dir_slash[PATH_MAX + 2];
+	const size_t dir_size = strlen(dir);
+
+	if (dir_size > PATH_MAX) {
+		/* will be reported by a traversal */
+		return true;
+	}
+
+	memcpy(dir_slash, dir, dir_size);
+	dir_slash[dir_size] = '/';
+	dir_slash[dir_size + 1] = '\0';
+
+	for (size_t i = 0; i < filter->exclude_count; i++) {
+		const char *const pattern = filter->exclude[i];
+
+		if (fnmatch(pattern, dir, 0) == 0 ||
+			fnmatch(pattern, dir_slash, 0) == 0) {
+			return false;
+		}
+	}
+
+	if (filter->include_count == 0) {
+		return true;
+	}
+
+	for (size_t i = 0; i < filter->include_count; i++) {
+		if (tze_filter_may_match_below(filter->include[i], dir, dir_size)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool tze_filter_file(const struct tze_filter_t *filter,
+					 const char				   *const name)
+{
+	for (size_t i = 0; i < filter->exclude_count; i++) {
+		if (fnmatch(filter->exclude[i], name, 0) == 0) {
+			return false;
+		}
+	}
+
+	if (filter->include_count == 0) {
+		return true;
+	}
+
+	for (size_t i = 0; i < filter->include_count; i++) {
+		if (fnmatch(filter->include[i], name, 0) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool tze_filter_path(const struct tze_filter_t *filter,
+					 const char				   *const name)
+{
+	char dir[PATH_MAX + 1];
+	const char *p = name;
+
+	while ((p = strchr(p, '/')) != NULL) {
+		const size_t dir_size = (size_t) (p - name);
+
+		if (dir_size > PATH_MAX) {
+			break;
+		}
+
+		memcpy(dir, name, dir_size);
+		dir[dir_size] = '\0';
+
+		if (!tze_filter_dir(filter, dir)) {
+			return false;
+		}
+
+		p++;
+	}
+
+	return tze_filter_file(filter, name);
+}
@@ -0,0 +1,58 @@
+#ifndef TZE_FILTER_H
+#define TZE_FILTER_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define TZE_FILTER_PATTERN_MAX			(64)
+
+#define TZE_FILTER_INIT					\
+	{									\
+		.include_count	= 0,			\
+		.exclude_count	= 0				\
+	}
+
+/**
+ * Glob patterns are matched against locality names with fnmatch(3),
+ * a "*" wildcard also matches "/". An exclude pattern with a trailing
+ * slash (e.g. "posix/") matches a whole directory only.
+ **/
+
+struct tze_filter_t {
+	const char *include[TZE_FILTER_PATTERN_MAX];
+	size_t		include_count;
+	const char *exclude[TZE_FILTER_PATTERN_MAX];
+	size_t		exclude_count;
+};
+
+static inline bool tze_filter_is_empty(const struct tze_filter_t *filter)
+{
+	return (filter->include_count == 0 && filter->exclude_count == 0) ?
+		true : false;
+}
+
+int tze_filter_add(struct tze_filter_t *filter,
+				   const bool			include,
+				   const char		   *const pattern);
+
+/**
+ * Checks whether a directory should be traversed at all:
+ * it is not excluded and some include pattern may match
+ * a name below it.
+ **/
+
+bool tze_filter_dir(const struct tze_filter_t *filter,
+					const char				  *const dir);
+
+bool tze_filter_file(const struct tze_filter_t *filter,
+					 const char				   *const name);
+
+/**
+ * Checks whether a name survives a traversal:
+ * none of its parent directories nor the name itself is filtered out.
+ **/
+
+bool tze_filter_path(const struct tze_filter_t *filter,
+					 const char				   *const name);
+
+#endif /* TZE_FILTER_H */
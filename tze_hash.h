@@ -0,0 +1,164 @@
+#ifndef TZE_HASH_H
+#define TZE_HASH_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+/**
+ * An open addressing string keyed hash table.
+ * Keys are not copied and should outlive the table.
+ **/
+
+#define TZE_HASH_MIN_CAPACITY			(64)
+
+#define TZE_HASH_INIT					\
+	{									\
+		.entries	= 0,				\
+		.capacity	= 0,				\
+		.count		= 0					\
+	}
+
+struct tze_hash_entry_t {
+	const char *key;
+	void	   *value;
+	uint32_t	hash;
+};
+
+struct tze_hash_t {
+	struct tze_hash_entry_t *entries;
+	size_t					 capacity;
+	size_t					 count;
+};
+
+static inline uint32_t tze_hash_mem(const void	 *const data,
+									const size_t  size)
+{
+	/* FNV-1a */
+	const uint8_t *p = data;
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static inline uint32_t tze_hash_str(const char *const str)
+{
+	return tze_hash_mem(str, strlen(str));
+}
+
+static inline void tze_hash_init(struct tze_hash_t *hash)
+{
+	hash->entries = NULL;
+	hash->capacity = 0;
+	hash->count = 0;
+}
+
+static inline struct tze_hash_entry_t *
+tze_hash_lookup(const struct tze_hash_t *hash,
+				const char				*const key,
+				const uint32_t			 key_hash)
+{
+	const size_t mask = hash->capacity - 1;
+	size_t i = key_hash & mask;
+
+	while (1) {
+		struct tze_hash_entry_t *e = &hash->entries[i];
+
+		if (e->key == NULL ||
+			(e->hash == key_hash && strcmp(e->key, key) == 0)) {
+			return e;
+		}
+
+		i = (i + 1) & mask;
+	}
+}
+
+static inline void *tze_hash_get(const struct tze_hash_t *hash,
+								 const char				 *const key)
+{
+	if (hash->count == 0) {
+		return NULL;
+	}
+
+	return tze_hash_lookup(hash, key, tze_hash_str(key))->value;
+}
+
+static inline int tze_hash_grow(struct tze_hash_t *hash)
+{
+	const size_t capacity = (hash->capacity == 0) ?
+		TZE_HASH_MIN_CAPACITY : hash->capacity * 2;
+	struct tze_hash_entry_t *entries = calloc(capacity, sizeof(*entries));
+
+	if (entries == NULL) {
+		return -1;
+	}
+
+	struct tze_hash_t grown = {
+		.entries	= entries,
+		.capacity	= capacity,
+		.count		= hash->count
+	};
+
+	for (size_t i = 0; i < hash->capacity; i++) {
+		const struct tze_hash_entry_t *e = &hash->entries[i];
+
+		if (e->key != NULL) {
+			*tze_hash_lookup(&grown, e->key, e->hash) = *e;
+		}
+	}
+
+	free(hash->entries);
+	*hash = grown;
+
+	return 0;
+}
+
+static inline int tze_hash_put(struct tze_hash_t *hash,
+							   const char		 *const key,
+							   void				 *value)
+{
+	if ((hash->count + 1) * 4 > hash->capacity * 3 &&
+		tze_hash_grow(hash) < 0) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	const uint32_t key_hash = tze_hash_str(key);
+	struct tze_hash_entry_t *e = tze_hash_lookup(hash, key, key_hash);
+
+	if (e->key == NULL) {
+		e->key = key;
+		e->hash = key_hash;
+		hash->count++;
+	}
+
+	e->value = value;
+
+	return 0;
+}
+
+static inline bool tze_hash_has(const struct tze_hash_t *hash,
+								const char				*const key)
+{
+	if (hash->count == 0) {
+		return false;
+	}
+
+	return (tze_hash_lookup(hash, key, tze_hash_str(key))->key != NULL) ?
+		true : false;
+}
+
+static inline void tze_hash_free(struct tze_hash_t *hash)
+{
+	free(hash->entries);
+	tze_hash_init(hash);
+}
+
+#endif /* TZE_HASH_H */
@@ -0,0 +1,125 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tze_list.h"
+#include "tze_index.h"
+#include "tze_locality.h"
+
+static int tze_index_compar(const void *l,
+							const void *r)
+{
+	const struct tze_index_entry_t *le = l;
+	const struct tze_index_entry_t *re = r;
+
+	return strcmp(le->name, re->name);
+}
+
+int tze_index_build(struct tze_index_t		*index,
+					const struct tze_list_t *loc_list,
+					const char				 sep)
+{
+	size_t count = 0;
+	size_t arena_size = 0;
+	const struct tze_locality_t *loc;
+
+	tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
+		count++;
+
+		if (loc->links != NULL) {
+			const size_t links_size = strlen(loc->links);
+
+			arena_size += links_size + 1;
+
+			for (size_t i = 0; i < links_size; i++) {
+				if (loc->links[i] == sep) {
+					count++;
+				}
+			}
+
+			count++;
+		}
+	}
+
+	index->entries = malloc(sizeof(*index->entries) * (count + 1));
+	index->arena = malloc(arena_size + 1);
+	index->count = 0;
+	index->trie.nodes = NULL;
+	index->trie.count = 0;
+	tze_hash_init(&index->names);
+
+	if (index->entries == NULL || index->arena == NULL) {
+		goto no_memory;
+	}
+
+	char *p = index->arena;
+
+	tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
+		index->entries[index->count].name = loc->name;
+		index->entries[index->count].loc = loc;
+		index->count++;
+
+		if (loc->links == NULL) {
+			continue;
+		}
+
+		/* split a link list to separate names */
+		const size_t links_size = strlen(loc->links);
+		char *name = p;
+
+		memcpy(p, loc->links, links_size + 1);
+
+		for (size_t i = 0; i <= links_size; i++) {
+			if (p[i] != sep && p[i] != '\0') {
+				continue;
+			}
+
+			p[i] = '\0';
+			index->entries[index->count].name = name;
+			index->entries[index->count].loc = loc;
+			index->count++;
+			name = p + i + 1;
+		}
+
+		p += links_size + 1;
+	}
+
+	qsort(index->entries, index->count,
+		  sizeof(*index->entries), tze_index_compar);
+
+	for (size_t i = 0; i < index->count; i++) {
+		const struct tze_index_entry_t *e = &index->entries[i];
+
+		if (tze_hash_put(&index->names, e->name, (void *) e->loc) < 0) {
+			goto no_memory;
+		}
+	}
+
+	if (tze_trie_build(&index->trie, index) < 0) {
+		goto no_memory;
+	}
+
+	return 0;
+
+no_memory:
+	tze_index_free(index);
+	errno = ENOMEM;
+	return -1;
+}
+
+size_t tze_index_prefix(const struct tze_index_t *index,
+						const char				 *const prefix,
+						size_t					 *count)
+{
+	return tze_trie_prefix(&index->trie, prefix, count);
+}
+
+void tze_index_free(struct tze_index_t *index)
+{
+	tze_hash_free(&index->names);
+	tze_trie_free(&index->trie);
+	free(index->entries);
+	free(index->arena);
+	index->entries = NULL;
+	index->arena = NULL;
+	index->count = 0;
+}
@@ -0,0 +1,61 @@
+#ifndef TZE_INDEX_H
+#define TZE_INDEX_H
+
+#include <stddef.h>
+#include "tze_hash.h"
+#include "tze_trie.h"
+
+/**
+ * An in-memory lookup index of a locality list: every locality and link
+ * name is mapped to its locality, and all names are kept sorted
+ * for prefix queries.
+ **/
+
+#define TZE_INDEX_INIT					\
+	{									\
+		.names		= TZE_HASH_INIT,	\
+		.entries	= 0,				\
+		.count		= 0,				\
+		.arena		= 0,				\
+		.trie		= TZE_TRIE_INIT		\
+	}
+
+struct tze_list_t;
+struct tze_locality_t;
+
+struct tze_index_entry_t {
+	const char					*name;
+	const struct tze_locality_t *loc;
+};
+
+struct tze_index_t {
+	struct tze_hash_t		  names;
+	struct tze_index_entry_t *entries;	/* sorted by strcmp(3)			 */
+	size_t					  count;
+	char					 *arena;	/* NUL terminated link names	 */
+	struct tze_trie_t		  trie;		/* over sorted entries			 */
+};
+
+int tze_index_build(struct tze_index_t		*index,
+					const struct tze_list_t *loc_list,
+					const char				 sep);
+
+static inline const struct tze_locality_t *
+tze_index_find(const struct tze_index_t *index,
+			   const char				*const name)
+{
+	return tze_hash_get(&index->names, name);
+}
+
+/**
+ * Finds a range of sorted entries starting with a prefix,
+ * returns a first entry index and sets a number of entries.
+ **/
+
+size_t tze_index_prefix(const struct tze_index_t *index,
+						const char				 *const prefix,
+						size_t					 *count);
+
+void tze_index_free(struct tze_index_t *index);
+
+#endif /* TZE_INDEX_H */
@@ -0,0 +1,165 @@
+#ifndef TZE_INODE_H
+#define TZE_INODE_H
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/**
+ * A (dev, ino) keyed hash table of already visited filesystem nodes.
+ **/
+
+#define TZE_INODE_MIN_CAPACITY			(64)
+
+#define TZE_INODE_MAP_INIT				\
+	{									\
+		.entries	= 0,				\
+		.capacity	= 0,				\
+		.count		= 0					\
+	}
+
+struct tze_inode_t {
+	dev_t  dev;
+	ino_t  ino;
+	char  *name;
+	void  *value;
+};
+
+struct tze_inode_map_t {
+	struct tze_inode_t *entries;
+	size_t				capacity;
+	size_t				count;
+};
+
+static inline void tze_inode_map_init(struct tze_inode_map_t *map)
+{
+	map->entries = NULL;
+	map->capacity = 0;
+	map->count = 0;
+}
+
+static inline size_t tze_inode_slot(const dev_t dev,
+									const ino_t ino)
+{
+	uint64_t h = ((uint64_t) ino) * 0x9e3779b97f4a7c15ull;
+
+	h ^= ((uint64_t) dev) + (h >> 29);
+
+	return (size_t) (h ^ (h >> 32));
+}
+
+static inline struct tze_inode_t *
+tze_inode_lookup(const struct tze_inode_map_t *map,
+				 const dev_t				   dev,
+				 const ino_t				   ino)
+{
+	const size_t mask = map->capacity - 1;
+	size_t i = tze_inode_slot(dev, ino) & mask;
+
+	while (1) {
+		struct tze_inode_t *e = &map->entries[i];
+
+		if (e->name == NULL || (e->dev == dev && e->ino == ino)) {
+			return e;
+		}
+
+		i = (i + 1) & mask;
+	}
+}
+
+static inline const struct tze_inode_t *
+tze_inode_get(const struct tze_inode_map_t *map,
+			  const dev_t				    dev,
+			  const ino_t				    ino)
+{
+	if (map->count == 0) {
+		return NULL;
+	}
+
+	const struct tze_inode_t *e = tze_inode_lookup(map, dev, ino);
+
+	return (e->name == NULL) ? NULL : e;
+}
+
+static inline int tze_inode_grow(struct tze_inode_map_t *map)
+{
+	const size_t capacity = (map->capacity == 0) ?
+		TZE_INODE_MIN_CAPACITY : map->capacity * 2;
+	struct tze_inode_t *entries = calloc(capacity, sizeof(*entries));
+
+	if (entries == NULL) {
+		return -1;
+	}
+
+	struct tze_inode_map_t grown = {
+		.entries	= entries,
+		.capacity	= capacity,
+		.count		= map->count
+	};
+
+	for (size_t i = 0; i < map->capacity; i++) {
+		const struct tze_inode_t *e = &map->entries[i];
+
+		if (e->name != NULL) {
+			*tze_inode_lookup(&grown, e->dev, e->ino) = *e;
+		}
+	}
+
+	free(map->entries);
+	*map = grown;
+
+	return 0;
+}
+
+/**
+ * Remembers the first name a node was seen by,
+ * a name is copied.
+ **/
+
+static inline int tze_inode_put(struct tze_inode_map_t *map,
+								const dev_t				dev,
+								const ino_t				ino,
+								const char			   *const name,
+								void				   *value)
+{
+	if ((map->count + 1) * 4 > map->capacity * 3 &&
+		tze_inode_grow(map) < 0) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	struct tze_inode_t *e = tze_inode_lookup(map, dev, ino);
+
+	if (e->name != NULL) {
+		e->value = value;
+		return 0;
+	}
+
+	e->name = strdup(name);
+
+	if (e->name == NULL) {
+		return -1;
+	}
+
+	e->dev = dev;
+	e->ino = ino;
+	e->value = value;
+	map->count++;
+
+	return 0;
+}
+
+static inline void tze_inode_map_free(struct tze_inode_map_t *map)
+{
+	for (size_t i = 0; i < map->capacity; i++) {
+		free(map->entries[i].name);
+	}
+
+	free(map->entries);
+	tze_inode_map_init(map);
+}
+
+#endif /* TZE_INODE_H */
@@ -0,0 +1,63 @@
+#ifndef TZE_LINK_H
+#define TZE_LINK_H
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tze_list.h"
+
+/**
+ * A symlink or another alias of a target name, the rule is optional
+ * and is used when the target itself does not show up in a list.
+ **/
+
+struct tze_link_t {
+	char			  *name;
+	char			  *target;
+	char			  *rule;
+	struct tze_list_t  list;
+};
+
+static inline void tze_link_free(struct tze_link_t *link)
+{
+	if (link != NULL) {
+		free(link->name);
+		free(link->target);
+		free(link->rule);
+		free(link);
+	}
+}
+
+static inline struct tze_link_t *
+tze_link_alloc(const char *const name,
+			   const char *const target,
+			   const char *const rule)
+{
+	if (name == NULL || target == NULL || *name == '\0') {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	struct tze_link_t *link = malloc(sizeof(*link));
+
+	if (link == NULL) {
+		return NULL;
+	}
+
+	link->name = strdup(name);
+	link->target = strdup(target);
+	link->rule = (rule == NULL) ? NULL : strdup(rule);
+	tze_list_init(&link->list);
+
+	if (link->name == NULL || link->target == NULL ||
+		(rule != NULL && link->rule == NULL)) {
+		tze_link_free(link);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	return link;
+}
+
+#endif /* TZE_LINK_H */
@@ -44,6 +44,24 @@ static inline bool tze_list_is_empty(const struct tze_list_t *head)
 	return (head->next == head) ? true : false;
 }
 
+/**
+ * Moves all entries of a list to the tail of another one.
+ **/
+
+static inline void tze_list_splice_tail(struct tze_list_t *head,
+										struct tze_list_t *list)
+{
+	if (tze_list_is_empty(list)) {
+		return;
+	}
+
+	list->next->prev = head->prev;
+	head->prev->next = list->next;
+	list->prev->next = head;
+	head->prev = list->prev;
+	tze_list_init(list);
+}
+
 #define tze_list_entry(ptr, type, member)							\
 	((type *) (((char *) ptr) - ((char *) &((type *) 0)->member)))
 
@@ -1,6 +1,7 @@
 #ifndef TZE_LOCALITY_H
 #define TZE_LOCALITY_H
 
+#include <stdio.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
@@ -89,4 +90,22 @@ static inline int tze_locality_add_link(struct tze_locality_t *loc,
 	return 0;
 }
 
+/**
+ * Formats a table line without a trailing newline, returns
+ * a snprintf(3) compatible result.
+ **/
+
+static inline int tze_locality_format(const struct tze_locality_t *loc,
+									  const char				   sep,
+									  char						  *buf,
+									  const size_t				   size)
+{
+	if (loc->links == NULL) {
+		return snprintf(buf, size, "%s%c%s", loc->name, sep, loc->rule);
+	}
+
+	return snprintf(buf, size, "%s%c%s%c%s",
+					loc->name, sep, loc->links, sep, loc->rule);
+}
+
 #endif /* TZE_LOCALITY_H */
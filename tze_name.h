@@ -1,20 +1,122 @@
 #ifndef TZE_NAME_H
 #define TZE_NAME_H
 
+#include <limits.h>
 #include <stddef.h>
+#include <string.h>
+#include <stdint.h>
 #include <stdbool.h>
+#include "tze_simd.h"
 
 static inline bool tze_name_has_sep(const char   *const name,
 									const size_t  name_size,
 									const char	  sep)
 {
-	for (size_t i = 0; i < name_size; i++) {
-		if (name[i] == sep) {
-			return true;
+	return tze_simd_span(name, name_size, 0, UINT8_MAX,
+						 (uint8_t) sep) < name_size;
+}
+
+/**
+ * Collapses "." and ".." components and repeated slashes of a relative
+ * name in place. Fails when a name climbs above its root.
+ **/
+
+static inline int tze_name_normalize(char *const name)
+{
+	char *w = name;
+	const char *r = name;
+	bool last = (*r == '\0');
+
+	while (!last) {
+		const char *end = r;
+
+		while (*end != '\0' && *end != '/') {
+			end++;
+		}
+
+		const size_t size = (size_t) (end - r);
+
+		/* a slash written below may overwrite a terminating null */
+		last = (*end == '\0');
+
+		if (size == 0 || (size == 1 && r[0] == '.')) {
+			/* skip */
+		} else if (size == 2 && r[0] == '.' && r[1] == '.') {
+			if (w == name) {
+				return -1;
+			}
+
+			/* drop the last written component */
+			w--;
+
+			while (w > name && w[-1] != '/') {
+				w--;
+			}
+		} else {
+			memmove(w, r, size);
+			w += size;
+			*w++ = '/';
 		}
+
+		r = end + 1;
 	}
 
-	return false;
+	if (w > name) {
+		/* no trailing slash */
+		w--;
+	}
+
+	*w = '\0';
+
+	return 0;
+}
+
+static inline size_t tze_name_component(const char *const name,
+										char		*const component)
+{
+	size_t size = 0;
+
+	while (name[size] != '\0' && name[size] != '/' && size < NAME_MAX) {
+		component[size] = name[size];
+		size++;
+	}
+
+	component[size] = '\0';
+
+	return size;
+}
+
+/**
+ * Orders locality names the same way as a sorted directory tree walk does:
+ * path components are compared one by one with strcoll(3).
+ **/
+
+static inline int tze_name_compar(const char *l,
+								  const char *r)
+{
+	char lc[NAME_MAX + 1];
+	char rc[NAME_MAX + 1];
+
+	while (1) {
+		const size_t l_size = tze_name_component(l, lc);
+		const size_t r_size = tze_name_component(r, rc);
+		const int ret = strcoll(lc, rc);
+
+		if (ret != 0) {
+			return ret;
+		}
+
+		l += l_size;
+		r += r_size;
+
+		if (*l != '/' || *r != '/') {
+			/* a shorter name goes first */
+			return (*l == '/') - (*r == '/');
+		}
+
+		l++;
+		r++;
+	}
 }
 
 #endif /* TZE_NAME_H */
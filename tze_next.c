@@ -0,0 +1,158 @@
+#include <errno.h>
+#include <stdio.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "tze_tz.h"
+#include "tze_err.h"
+#include "tze_list.h"
+#include "tze_next.h"
+#include "tze_rule.h"
+#include "tze_trans.h"
+#include "tze_locality.h"
+
+static void tze_next_set(struct tze_next_t *next,
+						 const int64_t		time,
+						 const int32_t		offset,
+						 const bool			dst,
+						 const char		   *const abbr)
+{
+	next->time = time;
+	next->offset = offset;
+	next->dst = dst;
+	snprintf(next->abbr, sizeof(next->abbr), "%s", abbr);
+}
+
+size_t tze_next_eval(const struct tze_trans_t *trans,
+					 const struct tze_rule_t  *rule,
+					 const int64_t			   since,
+					 struct tze_next_t		  *next,
+					 const size_t			   count)
+{
+	struct tze_trans_cursor_t cursor;
+	size_t n = 0;
+	int64_t time;
+	uint8_t type;
+
+	tze_trans_seek(trans, since, &cursor);
+
+	uint8_t prev = cursor.type;
+
+	while (n < count && tze_trans_next(trans, &cursor, &time, &type)) {
+		const struct tze_trans_type_t *t = &trans->types[type];
+
+		/* types are unique, e.g. a fat file 2038 boundary changes nothing */
+		if (type != prev) {
+			tze_next_set(&next[n++], time, t->offset, t->dst, t->abbr);
+		}
+
+		prev = type;
+	}
+
+	if (n == count || !rule->dst) {
+		return n;
+	}
+
+	/* a footer rule applies after the last transition */
+	const int64_t after = (trans->count > 0 && cursor.time > since) ?
+		cursor.time : since;
+
+	for (int32_t year = tze_rule_year_of(after) - 1; n < count; year++) {
+		int64_t start = tze_rule_transition(rule, year, true);
+		int64_t end = tze_rule_transition(rule, year, false);
+		const bool start_first = (start < end);
+
+		for (int i = 0; i < 2 && n < count; i++) {
+			const bool is_start = (i == 0) == start_first;
+			const int64_t at = is_start ? start : end;
+
+			if (at <= after) {
+				continue;
+			}
+
+			if (is_start) {
+				tze_next_set(&next[n++], at, rule->dst_offset, true,
+							 rule->dst_abbr);
+			} else {
+				tze_next_set(&next[n++], at, rule->std_offset, false,
+							 rule->std_abbr);
+			}
+		}
+	}
+
+	return n;
+}
+
+int tze_next_print_list(FILE					*out,
+						const char *const		*roots,
+						const size_t			 root_count,
+						const struct tze_list_t *loc_list,
+						const char				 sep,
+						const int64_t			 since,
+						const size_t			 count,
+						struct tze_err_t		*err)
+{
+	const struct tze_locality_t *loc;
+	struct tze_next_t *next = malloc(sizeof(*next) * count);
+
+	if (next == NULL) {
+		tze_err_set(err, ENOMEM, "unable to allocate a transition list");
+		return -1;
+	}
+
+	tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
+		char file_name[PATH_MAX];
+		struct tze_tz_data_t data;
+		struct tze_trans_t trans;
+		struct tze_rule_t rule;
+
+		if (tze_tz_locate(roots, root_count, loc->name,
+						  file_name, err) < 0) {
+			goto fail;
+		}
+
+		const int ret = tze_tz_load(file_name, loc->name, &data, err);
+
+		if (ret != 0) {
+			if (ret > 0) {
+				tze_err_set(err, 0, "%s: not a timezone file", loc->name);
+			}
+
+			goto fail;
+		}
+
+		if (tze_rule_parse(data.rule, loc->name, data.v3, &rule, err) < 0 ||
+			tze_trans_build(&trans, &data, err) < 0) {
+			tze_tz_unload(&data);
+			goto fail;
+		}
+
+		const size_t n = tze_next_eval(&trans, &rule, since, next, count);
+
+		fprintf(out, "%s%c", loc->name, sep);
+
+		for (size_t i = 0; i < n; i++) {
+			fprintf(out, "%s%" PRId64 "/%" PRId32 "/%d/%s",
+					(i == 0) ? "" : ",", next[i].time, next[i].offset,
+					next[i].dst ? 1 : 0, next[i].abbr);
+		}
+
+		fputc('\n', out);
+		tze_trans_free(&trans);
+		tze_tz_unload(&data);
+
+		if (ferror(out)) {
+			tze_err_set(err, errno, "unable to write a transition list");
+			goto fail;
+		}
+	}
+
+	free(next);
+	return 0;
+
+fail:
+	free(next);
+	return -1;
+}
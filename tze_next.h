@@ -0,0 +1,55 @@
+#ifndef TZE_NEXT_H
+#define TZE_NEXT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "tze_rule.h"
+
+/**
+ * Upcoming transitions of a zone after a reference time, explicit
+ * TZif transitions are followed by ones of a footer rule. A printed
+ * list is a single line:
+ *
+ *   {name}{sep}[{time}/{offset}/{0|1}/{abbr}[,...]]
+ *
+ * with UTC seconds since the epoch and a new offset east of UTC,
+ * sorted by time, so a consumer can binary-search it.
+ **/
+
+#define TZE_NEXT_DEF_COUNT				(4)
+#define TZE_NEXT_COUNT_MAX				(1024)
+
+struct tze_err_t;
+struct tze_list_t;
+struct tze_trans_t;
+
+struct tze_next_t {
+	int64_t	time;
+	int32_t	offset;
+	bool	dst;
+	char	abbr[TZE_RULE_ABBR_MAX + 1];
+};
+
+/**
+ * Fills up to count transitions strictly after a time,
+ * returns a number filled.
+ **/
+
+size_t tze_next_eval(const struct tze_trans_t *trans,
+					 const struct tze_rule_t  *rule,
+					 const int64_t			   since,
+					 struct tze_next_t		  *next,
+					 const size_t			   count);
+
+int tze_next_print_list(FILE					*out,
+						const char *const		*roots,
+						const size_t			 root_count,
+						const struct tze_list_t *loc_list,
+						const char				 sep,
+						const int64_t			 since,
+						const size_t			 count,
+						struct tze_err_t		*err);
+
+#endif /* TZE_NEXT_H */
@@ -0,0 +1,237 @@
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdbool.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "tze_err.h"
+#include "tze_out.h"
+
+#define TZE_OUT_CHUNK					(65536)
+#define TZE_OUT_DEF_MODE				(0666)
+
+int tze_out_open(struct tze_out_t *out,
+				 const char		  *const file_name,
+				 struct tze_err_t *err)
+{
+	*out = (struct tze_out_t) TZE_OUT_INIT;
+	out->file_name = file_name;
+	out->stream = open_memstream(&out->buf, &out->size);
+
+	if (out->stream == NULL) {
+		tze_err_set(err, errno, "%s: unable to create an output buffer",
+					file_name);
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Returns 1 when a file holds data, 0 when it does not or is missing,
+ * and sets a mode of an existing file.
+ **/
+
+static int tze_out_same(const char		 *const file_name,
+						const char		 *data,
+						size_t			  size,
+						mode_t			 *mode,
+						struct tze_err_t *err)
+{
+	struct stat st;
+	char chunk[TZE_OUT_CHUNK];
+	int ret = -1;
+	const int fd = open(file_name, O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0) {
+		if (errno == ENOENT) {
+			return 0;
+		}
+
+		tze_err_set(err, errno, "%s: unable to open", file_name);
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		tze_err_set(err, errno, "%s: unable to stat", file_name);
+		goto close_fd;
+	}
+
+	if (!S_ISREG(st.st_mode)) {
+		tze_err_set(err, 0, "%s: not a regular file", file_name);
+		goto close_fd;
+	}
+
+	*mode = st.st_mode & 07777;
+
+	if ((size_t) st.st_size != size) {
+		ret = 0;
+		goto close_fd;
+	}
+
+	while (size > 0) {
+		const ssize_t n = read(fd, chunk,
+							   (size < sizeof(chunk)) ? size : sizeof(chunk));
+
+		if (n < 0) {
+			tze_err_set(err, errno, "%s: unable to read", file_name);
+			goto close_fd;
+		}
+
+		if (n == 0 || memcmp(chunk, data, (size_t) n) != 0) {
+			/* shrunk meanwhile or differs */
+			ret = 0;
+			goto close_fd;
+		}
+
+		data += n;
+		size -= (size_t) n;
+	}
+
+	ret = 1;
+
+close_fd:
+	close(fd);
+	return ret;
+}
+
+static int tze_out_replace(const char		*const file_name,
+						   const char		*data,
+						   size_t			 size,
+						   const mode_t		 mode,
+						   struct tze_err_t *err)
+{
+	char tmp_name[PATH_MAX];
+	const int n = snprintf(tmp_name, sizeof(tmp_name), "%s.XXXXXX",
+						   file_name);
+
+	if (n < 0 || (size_t) n >= sizeof(tmp_name)) {
+		tze_err_set(err, ENAMETOOLONG, "%s: too long file name", file_name);
+		return -1;
+	}
+
+	/* in the same directory, a rename does not cross filesystems */
+	const int fd = mkstemp(tmp_name);
+
+	if (fd < 0) {
+		tze_err_set(err, errno, "%s: unable to create a temporary file",
+					file_name);
+		return -1;
+	}
+
+	if (fchmod(fd, mode) < 0) {
+		tze_err_set(err, errno, "%s: unable to set a mode", tmp_name);
+		goto fail;
+	}
+
+	while (size > 0) {
+		const ssize_t written = write(fd, data, size);
+
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			tze_err_set(err, errno, "%s: unable to write", tmp_name);
+			goto fail;
+		}
+
+		data += written;
+		size -= (size_t) written;
+	}
+
+	if (fsync(fd) < 0) {
+		tze_err_set(err, errno, "%s: unable to sync", tmp_name);
+		goto fail;
+	}
+
+	if (close(fd) < 0) {
+		tze_err_set(err, errno, "%s: unable to write", tmp_name);
+		unlink(tmp_name);
+		return -1;
+	}
+
+	if (rename(tmp_name, file_name) < 0) {
+		tze_err_set(err, errno, "%s: unable to replace", file_name);
+		unlink(tmp_name);
+		return -1;
+	}
+
+	/* a rename survives a power loss once a directory is synced */
+	char *const slash = strrchr(tmp_name, '/');
+
+	if (slash == NULL) {
+		strcpy(tmp_name, ".");
+	} else if (slash == tmp_name) {
+		slash[1] = '\0';
+	} else {
+		*slash = '\0';
+	}
+
+	const int dir_fd = open(tmp_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	if (dir_fd >= 0) {
+		fsync(dir_fd);
+		close(dir_fd);
+	}
+
+	return 0;
+
+fail:
+	close(fd);
+	unlink(tmp_name);
+	return -1;
+}
+
+int tze_out_commit(struct tze_out_t *out,
+				   struct tze_err_t *err)
+{
+	const bool failed = (ferror(out->stream) != 0);
+	mode_t mode;
+
+	/* sets a final buffer and size */
+	if (fclose(out->stream) != 0 || failed) {
+		out->stream = NULL;
+		tze_err_set(err, ENOMEM, "%s: unable to buffer output",
+					out->file_name);
+		return -1;
+	}
+
+	out->stream = NULL;
+
+	const mode_t mask = umask(0);
+
+	umask(mask);
+	mode = TZE_OUT_DEF_MODE & ~mask;
+
+	int ret = tze_out_same(out->file_name, out->buf, out->size, &mode, err);
+
+	if (ret == 0) {
+		ret = (tze_out_replace(out->file_name, out->buf, out->size,
+							   mode, err) < 0) ? -1 : 1;
+	} else if (ret > 0) {
+		ret = 0;
+	}
+
+	free(out->buf);
+	out->buf = NULL;
+	out->size = 0;
+
+	return ret;
+}
+
+void tze_out_close(struct tze_out_t *out)
+{
+	if (out->stream != NULL) {
+		fclose(out->stream);
+		out->stream = NULL;
+	}
+
+	free(out->buf);
+	out->buf = NULL;
+	out->size = 0;
+}
@@ -0,0 +1,49 @@
+#ifndef TZE_OUT_H
+#define TZE_OUT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/**
+ * An output file replaced only when its content changes. Output goes
+ * to memory first and is compared with a current file, a size mismatch
+ * decides without reading it. A changed file is written to a temporary
+ * one in the same directory, synced and renamed over the old one, so
+ * readers see either a whole old file or a whole new one.
+ **/
+
+#define TZE_OUT_INIT					\
+	{									\
+		.file_name	= 0,				\
+		.stream		= 0,				\
+		.buf		= 0,				\
+		.size		= 0					\
+	}
+
+struct tze_err_t;
+
+struct tze_out_t {
+	const char *file_name;
+	FILE	   *stream;					/* to write output to			 */
+	char	   *buf;
+	size_t		size;
+};
+
+int tze_out_open(struct tze_out_t *out,
+				 const char		  *const file_name,
+				 struct tze_err_t *err);
+
+/**
+ * Returns 1 when a file is replaced and 0 when it is up to date.
+ **/
+
+int tze_out_commit(struct tze_out_t *out,
+				   struct tze_err_t *err);
+
+/**
+ * Discards an uncommitted output.
+ **/
+
+void tze_out_close(struct tze_out_t *out);
+
+#endif /* TZE_OUT_H */
@@ -0,0 +1,359 @@
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tze_err.h"
+#include "tze_name.h"
+#include "tze_query.h"
+
+#define TZE_QUERY_LINK_HOPS_MAX			(40)
+
+/**
+ * Finds a name in the latest root having it, a symlink is not followed.
+ * Returns 1 when found and 0 when not.
+ **/
+
+static int tze_query_find(const char *const *roots,
+						  const size_t		 root_count,
+						  const char		*const name,
+						  char				*path,
+						  size_t			*root_index,
+						  struct stat		*st,
+						  struct tze_err_t	*err)
+{
+	for (size_t i = root_count; i > 0; i--) {
+		const int n = snprintf(path, PATH_MAX, "%s/%s", roots[i - 1], name);
+
+		if (n < 0 || n >= PATH_MAX) {
+			tze_err_set(err, ENAMETOOLONG, "%s: too long file name", name);
+			return -1;
+		}
+
+		if (lstat(path, st) < 0) {
+			if (errno == ENOENT || errno == ENOTDIR) {
+				/* try an older root */
+				continue;
+			}
+
+			tze_err_set(err, errno, "%s: unable to stat", name);
+			return -1;
+		}
+
+		*root_index = i - 1;
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Replaces a name with a target of its symlink relative to a root,
+ * a link body is joined lexically as a scan does.
+ **/
+
+static int tze_query_link(const char		*const root,
+						  const char		*const path,
+						  char				*name,
+						  struct tze_err_t	*err)
+{
+	char body[PATH_MAX];
+	char target[PATH_MAX];
+	int size;
+	const ssize_t n = readlink(path, body, sizeof(body) - 1);
+
+	if (n < 0 || (size_t) n >= sizeof(body) - 1) {
+		tze_err_set(err, (n < 0) ? errno : ENAMETOOLONG,
+					"%s: unable to read a symlink target", name);
+		return -1;
+	}
+
+	body[n] = '\0';
+
+	if (body[0] == '/') {
+		char *const real_dir = realpath(root, NULL);
+		const char *const dirs[] = { real_dir, root };
+		const char *rel = NULL;
+
+		for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+			const size_t dir_size = (dirs[i] == NULL) ? 0 : strlen(dirs[i]);
+
+			if (dirs[i] != NULL && strncmp(body, dirs[i], dir_size) == 0 &&
+				(body[dir_size] == '/' || body[dir_size] == '\0')) {
+				rel = body + dir_size;
+				break;
+			}
+		}
+
+		size = (rel == NULL) ? -1 :
+			snprintf(target, sizeof(target), "%s", rel);
+		free(real_dir);
+
+		if (rel == NULL) {
+			goto out_of_root;
+		}
+	} else {
+		const char *const slash = strrchr(name, '/');
+		const int dir_size = (slash == NULL) ? 0 : (int) (slash - name);
+
+		size = snprintf(target, sizeof(target), "%.*s/%s",
+						dir_size, name, body);
+	}
+
+	if (size < 0 || (size_t) size >= sizeof(target)) {
+		tze_err_set(err, ENAMETOOLONG,
+					"%s: unable to read a symlink target", name);
+		return -1;
+	}
+
+	if (tze_name_normalize(target) < 0 || *target == '\0') {
+		goto out_of_root;
+	}
+
+	strcpy(name, target);
+
+	return 0;
+
+out_of_root:
+	tze_err_set(err, 0,
+				"%s: a symlink points out of "
+				"the timezone root directory", name);
+	return -1;
+}
+
+int tze_query_resolve(const char *const *roots,
+					  const size_t		 root_count,
+					  const char		*const name,
+					  char				*file_name,
+					  char				*locality,
+					  size_t			*root_index,
+					  struct tze_err_t	*err)
+{
+	char norm[PATH_MAX];
+	char path[PATH_MAX];
+	struct stat st;
+	const size_t name_size = strlen(name);
+
+	if (name_size == 0 || name_size >= sizeof(norm) || *name == '/') {
+		tze_err_set(err, 0, "\"%s\" is not a locality name", name);
+		return -1;
+	}
+
+	memcpy(norm, name, name_size + 1);
+
+	if (tze_name_normalize(norm) < 0 || *norm == '\0') {
+		tze_err_set(err, 0, "\"%s\" is not a locality name", name);
+		return -1;
+	}
+
+	/**
+	 * A symlink of a later root overrides a file of an earlier one and
+	 * its target is looked up across all roots, as tze_roots_merge()
+	 * resolves links, so each hop is followed here by hand.
+	 **/
+
+	for (size_t hops = 0;; hops++) {
+		const int ret = tze_query_find(roots, root_count, norm, path,
+									   root_index, &st, err);
+
+		if (ret < 0) {
+			return -1;
+		}
+
+		if (ret == 0) {
+			if (hops == 0) {
+				tze_err_set(err, ENOENT, "%s: unable to find in roots", norm);
+			} else {
+				tze_err_set(err, ENOENT,
+							"%s: no \"%s\" symlink target found in roots",
+							name, norm);
+			}
+
+			return -1;
+		}
+
+		if (!S_ISLNK(st.st_mode)) {
+			break;
+		}
+
+		if (hops == TZE_QUERY_LINK_HOPS_MAX) {
+			tze_err_set(err, ELOOP, "%s: unable to resolve a link target",
+						name);
+			return -1;
+		}
+
+		if (tze_query_link(roots[*root_index], path, norm, err) < 0) {
+			return -1;
+		}
+	}
+
+	/* directory symlinks of a name are resolved within its root */
+	if (realpath(path, file_name) == NULL) {
+		tze_err_set(err, errno, "%s: unable to resolve", norm);
+		return -1;
+	}
+
+	char *const real_dir = realpath(roots[*root_index], NULL);
+
+	if (real_dir == NULL) {
+		tze_err_set(err, errno, "%s: unable to resolve a root directory",
+					roots[*root_index]);
+		return -1;
+	}
+
+	const size_t real_dir_size = strlen(real_dir);
+	const int inside = (strncmp(file_name, real_dir, real_dir_size) == 0 &&
+						file_name[real_dir_size] == '/');
+
+	free(real_dir);
+
+	if (!inside) {
+		tze_err_set(err, 0, "%s: a target \"%s\" is out of a root",
+					norm, file_name);
+		return -1;
+	}
+
+	if (stat(file_name, &st) < 0) {
+		tze_err_set(err, errno, "%s: unable to stat", norm);
+		return -1;
+	}
+
+	if (!S_ISREG(st.st_mode)) {
+		tze_err_set(err, 0, "%s: not a timezone file", norm);
+		return -1;
+	}
+
+	memmove(locality, file_name + real_dir_size + 1,
+			strlen(file_name + real_dir_size + 1) + 1);
+
+	return 0;
+}
+
+/**
+ * Compares a name of a table line with a locality, a line has
+ * at least a name and a rule.
+ **/
+
+static int tze_query_compar(const char		  *const line,
+							const size_t	   line_size,
+							const char		  *const locality,
+							const char		   sep,
+							int				  *ret)
+{
+	char name[PATH_MAX];
+	const char *const end = memchr(line, sep, line_size);
+
+	if (end == NULL || end == line || (size_t) (end - line) >= sizeof(name)) {
+		return -1;
+	}
+
+	memcpy(name, line, (size_t) (end - line));
+	name[end - line] = '\0';
+	*ret = tze_name_compar(name, locality);
+
+	return 0;
+}
+
+int tze_query_links(const char		  *const table,
+					const char		  *const locality,
+					const char		   sep,
+					char			 **links,
+					struct tze_err_t  *err)
+{
+	struct stat st;
+	int ret = -1;
+
+	*links = NULL;
+
+	const int fd = open(table, O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0) {
+		tze_err_set(err, errno, "%s: unable to open", table);
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		tze_err_set(err, errno, "%s: unable to stat", table);
+		goto close_fd;
+	}
+
+	const size_t size = (size_t) st.st_size;
+
+	if (size == 0) {
+		ret = 0;
+		goto close_fd;
+	}
+
+	/* a search touches a few pages only */
+	const char *const data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	if (data == MAP_FAILED) {
+		tze_err_set(err, errno, "%s: unable to map", table);
+		goto close_fd;
+	}
+
+	posix_madvise((void *) data, size, POSIX_MADV_RANDOM);
+
+	size_t lo = 0;
+	size_t hi = size;
+
+	/* lo is always a line start */
+	while (lo < hi) {
+		size_t start = lo + (hi - lo) / 2;
+
+		while (start > lo && data[start - 1] != '\n') {
+			start--;
+		}
+
+		const char *const nl = memchr(data + start, '\n', size - start);
+		const size_t end = (nl == NULL) ? size : (size_t) (nl - data);
+		int cmp;
+
+		if (tze_query_compar(data + start, end - start,
+							 locality, sep, &cmp) < 0) {
+			tze_err_set(err, 0, "%s: malformed line at offset %zu",
+						table, start);
+			goto unmap;
+		}
+
+		if (cmp < 0) {
+			lo = end + 1;
+		} else if (cmp > 0) {
+			hi = start;
+		} else {
+			/* links are between a name and a rule */
+			const char *const first = memchr(data + start, sep, end - start);
+			const char *last = data + end - 1;
+
+			while (*last != sep) {
+				last--;
+			}
+
+			if (last > first) {
+				*links = strndup(first + 1, (size_t) (last - first - 1));
+
+				if (*links == NULL) {
+					tze_err_set(err, ENOMEM, "%s: unable to allocate links",
+								locality);
+					goto unmap;
+				}
+			}
+
+			ret = 1;
+			goto unmap;
+		}
+	}
+
+	ret = 0;
+
+unmap:
+	munmap((void *) data, size);
+
+close_fd:
+	close(fd);
+	return ret;
+}
@@ -0,0 +1,43 @@
+#ifndef TZE_QUERY_H
+#define TZE_QUERY_H
+
+#include <stddef.h>
+
+/**
+ * A single locality query without a tree scan. A zone file is opened
+ * directly and a symlink is followed to its canonical target, so only
+ * a path lookup depends on a tree. Links of a target come from a text
+ * table printed earlier, e.g. by "tze -d {root} > {table}", which is
+ * searched in place with a binary search over its sorted lines.
+ **/
+
+struct tze_err_t;
+
+/**
+ * Finds a locality in the latest root having it, sets a real zone file
+ * name and a canonical locality name, both buffers should have PATH_MAX
+ * bytes, and a root index. A symlink target is looked up in all roots
+ * again, a dangling one is an error. A target should stay in its root.
+ **/
+
+int tze_query_resolve(const char *const *roots,
+					  const size_t		 root_count,
+					  const char		*const name,
+					  char				*file_name,
+					  char				*locality,
+					  size_t			*root_index,
+					  struct tze_err_t	*err);
+
+/**
+ * Finds links of a locality in a table sorted by tze_name_compar(),
+ * returns 1 when found and 0 when not. Links stay NULL for a locality
+ * without them and are joined with a separator otherwise.
+ **/
+
+int tze_query_links(const char		  *const table,
+					const char		  *const locality,
+					const char		   sep,
+					char			 **links,
+					struct tze_err_t  *err);
+
+#endif /* TZE_QUERY_H */
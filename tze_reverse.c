@@ -0,0 +1,347 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "tze_err.h"
+#include "tze_list.h"
+#include "tze_rule.h"
+#include "tze_reverse.h"
+#include "tze_locality.h"
+
+#define TZE_REVERSE_OFFSET_MAX			(16)	/* "-167:59:59"		 */
+#define TZE_REVERSE_KEY_MAX				\
+	(2 * (TZE_REVERSE_OFFSET_MAX + TZE_RULE_ABBR_MAX + TZE_RULE_DATE_MAX) + 8)
+
+struct tze_reverse_entry_t {
+	struct tze_rule_t			 rule;
+	const struct tze_locality_t *loc;
+	size_t						 order;	/* in a locality list			 */
+	char						 key[TZE_REVERSE_KEY_MAX];
+};
+
+struct tze_reverse_cand_t {
+	int32_t	offset;
+	bool	dst;
+	size_t	group;
+};
+
+static int tze_reverse_format_offset(const int32_t	offset,
+									 char		   *buf,
+									 const size_t	size)
+{
+	const int32_t t = (offset < 0) ? -offset : offset;
+	const char sign = (offset < 0) ? '-' : '+';
+
+	if (t % 60 != 0) {
+		return snprintf(buf, size, "%c%02" PRId32 ":%02" PRId32 ":%02" PRId32,
+						sign, t / 3600, t / 60 % 60, t % 60);
+	}
+
+	return snprintf(buf, size, "%c%02" PRId32 ":%02" PRId32,
+					sign, t / 3600, t / 60 % 60);
+}
+
+/**
+ * Formats rule fields, all of them are empty for DST
+ * of a rule without DST.
+ **/
+
+static void tze_reverse_fields(const struct tze_rule_t *rule,
+							   char					   *std_offset,
+							   char					   *dst_offset,
+							   char					   *dates)
+{
+	tze_reverse_format_offset(rule->std_offset, std_offset,
+							  TZE_REVERSE_OFFSET_MAX);
+	*dst_offset = '\0';
+	*dates = '\0';
+
+	if (rule->dst) {
+		char start[TZE_RULE_DATE_MAX];
+		char end[TZE_RULE_DATE_MAX];
+
+		tze_reverse_format_offset(rule->dst_offset, dst_offset,
+								  TZE_REVERSE_OFFSET_MAX);
+		tze_rule_format_date(&rule->start, start, sizeof(start));
+		tze_rule_format_date(&rule->end, end, sizeof(end));
+		snprintf(dates, 2 * TZE_RULE_DATE_MAX, "%s,%s", start, end);
+	}
+}
+
+static int tze_reverse_entry_compar(const void *l,
+									const void *r)
+{
+	const struct tze_reverse_entry_t *le = l;
+	const struct tze_reverse_entry_t *re = r;
+
+	if (le->rule.std_offset != re->rule.std_offset) {
+		return (le->rule.std_offset < re->rule.std_offset) ? -1 : 1;
+	}
+
+	if (le->rule.dst != re->rule.dst) {
+		return le->rule.dst ? 1 : -1;
+	}
+
+	if (le->rule.dst_offset != re->rule.dst_offset) {
+		return (le->rule.dst_offset < re->rule.dst_offset) ? -1 : 1;
+	}
+
+	const int ret = strcmp(le->key, re->key);
+
+	if (ret != 0) {
+		return ret;
+	}
+
+	return (le->order < re->order) ? -1 : (le->order > re->order) ? 1 : 0;
+}
+
+static int tze_reverse_cand_compar(const void *l,
+								   const void *r)
+{
+	const struct tze_reverse_cand_t *lc = l;
+	const struct tze_reverse_cand_t *rc = r;
+
+	if (lc->offset != rc->offset) {
+		return (lc->offset < rc->offset) ? -1 : 1;
+	}
+
+	if (lc->dst != rc->dst) {
+		return lc->dst ? 1 : -1;
+	}
+
+	return (lc->group < rc->group) ? -1 : (lc->group > rc->group) ? 1 : 0;
+}
+
+static size_t tze_reverse_slot(const int32_t offset,
+							   const bool	 dst)
+{
+	const uint32_t h = ((uint32_t) offset * 2u + (dst ? 1u : 0u)) *
+		2654435761u;
+
+	return (size_t) (h ^ (h >> 16));
+}
+
+static int tze_reverse_index(struct tze_reverse_t *rev)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < rev->group_count; i++) {
+		count += rev->groups[i].rule.dst ? 2 : 1;
+	}
+
+	struct tze_reverse_cand_t *cands = malloc(sizeof(*cands) * (count + 1));
+
+	rev->slot_count = 1;
+
+	while (rev->slot_count < count * 2) {
+		rev->slot_count *= 2;
+	}
+
+	rev->candidates = malloc(sizeof(*rev->candidates) * (count + 1));
+	rev->slots = calloc(rev->slot_count, sizeof(*rev->slots));
+
+	if (cands == NULL || rev->candidates == NULL || rev->slots == NULL) {
+		free(cands);
+		return -1;
+	}
+
+	size_t n = 0;
+
+	for (size_t i = 0; i < rev->group_count; i++) {
+		const struct tze_rule_t *rule = &rev->groups[i].rule;
+
+		cands[n++] = (struct tze_reverse_cand_t) {
+			.offset = rule->std_offset, .dst = false, .group = i
+		};
+
+		if (rule->dst) {
+			cands[n++] = (struct tze_reverse_cand_t) {
+				.offset = rule->dst_offset, .dst = true, .group = i
+			};
+		}
+	}
+
+	qsort(cands, n, sizeof(*cands), tze_reverse_cand_compar);
+
+	const size_t mask = rev->slot_count - 1;
+
+	for (size_t i = 0; i < n; ) {
+		size_t j = i;
+		size_t slot = tze_reverse_slot(cands[i].offset, cands[i].dst) & mask;
+
+		for (; j < n && cands[j].offset == cands[i].offset &&
+			 cands[j].dst == cands[i].dst; j++) {
+			rev->candidates[j] = &rev->groups[cands[j].group];
+		}
+
+		while (rev->slots[slot].count != 0) {
+			slot = (slot + 1) & mask;
+		}
+
+		rev->slots[slot] = (struct tze_reverse_slot_t) {
+			.offset	= cands[i].offset,
+			.dst	= cands[i].dst,
+			.first	= (uint32_t) i,
+			.count	= (uint32_t) (j - i)
+		};
+		i = j;
+	}
+
+	free(cands);
+
+	return 0;
+}
+
+int tze_reverse_build(struct tze_reverse_t	  *rev,
+					  const struct tze_list_t *loc_list,
+					  struct tze_err_t		  *err)
+{
+	const struct tze_locality_t *loc;
+	size_t count = 0;
+	size_t n = 0;
+
+	rev->groups = NULL;
+	rev->group_count = 0;
+	rev->locs = NULL;
+	rev->candidates = NULL;
+	rev->slots = NULL;
+	rev->slot_count = 0;
+
+	tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
+		count++;
+	}
+
+	struct tze_reverse_entry_t *entries = malloc(sizeof(*entries) *
+												 (count + 1));
+
+	rev->locs = malloc(sizeof(*rev->locs) * (count + 1));
+	rev->groups = malloc(sizeof(*rev->groups) * (count + 1));
+
+	if (entries == NULL || rev->locs == NULL || rev->groups == NULL) {
+		tze_err_set(err, ENOMEM, "unable to allocate a reverse index");
+		goto fail;
+	}
+
+	tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
+		struct tze_reverse_entry_t *e = &entries[n];
+		char std_offset[TZE_REVERSE_OFFSET_MAX];
+		char dst_offset[TZE_REVERSE_OFFSET_MAX];
+		char dates[2 * TZE_RULE_DATE_MAX];
+
+		/* rules were checked during extraction already */
+		if (tze_rule_parse(loc->rule, loc->name, true, &e->rule, err) < 0) {
+			goto fail;
+		}
+
+		if (e->rule.std_abbr[0] == '\0') {
+			continue;
+		}
+
+		tze_reverse_fields(&e->rule, std_offset, dst_offset, dates);
+		snprintf(e->key, sizeof(e->key), "%s %s %s %s %s",
+				 std_offset, dst_offset,
+				 e->rule.std_abbr, e->rule.dst_abbr, dates);
+		e->loc = loc;
+		e->order = n++;
+	}
+
+	/* equal rules end up adjacent, in a locality list order */
+	qsort(entries, n, sizeof(*entries), tze_reverse_entry_compar);
+
+	for (size_t i = 0; i < n; i++) {
+		if (i == 0 || strcmp(entries[i].key, entries[i - 1].key) != 0) {
+			struct tze_reverse_group_t *g = &rev->groups[rev->group_count++];
+
+			g->rule = entries[i].rule;
+			g->locs = &rev->locs[i];
+			g->loc_count = 0;
+		}
+
+		rev->locs[i] = entries[i].loc;
+		rev->groups[rev->group_count - 1].loc_count++;
+	}
+
+	if (tze_reverse_index(rev) < 0) {
+		tze_err_set(err, ENOMEM, "unable to allocate a reverse index");
+		goto fail;
+	}
+
+	free(entries);
+
+	return 0;
+
+fail:
+	free(entries);
+	tze_reverse_free(rev);
+	return -1;
+}
+
+const struct tze_reverse_group_t *const *
+tze_reverse_find(const struct tze_reverse_t *rev,
+				 const int32_t				 offset,
+				 const bool					 dst,
+				 size_t						*count)
+{
+	*count = 0;
+
+	if (rev->slot_count == 0) {
+		return NULL;
+	}
+
+	const size_t mask = rev->slot_count - 1;
+	size_t slot = tze_reverse_slot(offset, dst) & mask;
+
+	while (rev->slots[slot].count != 0) {
+		const struct tze_reverse_slot_t *s = &rev->slots[slot];
+
+		if (s->offset == offset && s->dst == dst) {
+			*count = s->count;
+			return &rev->candidates[s->first];
+		}
+
+		slot = (slot + 1) & mask;
+	}
+
+	return NULL;
+}
+
+int tze_reverse_print(FILE						 *out,
+					  const struct tze_reverse_t *rev,
+					  const char				  sep)
+{
+	for (size_t i = 0; i < rev->group_count; i++) {
+		const struct tze_reverse_group_t *g = &rev->groups[i];
+		char std_offset[TZE_REVERSE_OFFSET_MAX];
+		char dst_offset[TZE_REVERSE_OFFSET_MAX];
+		char dates[2 * TZE_RULE_DATE_MAX];
+
+		tze_reverse_fields(&g->rule, std_offset, dst_offset, dates);
+		fprintf(out, "%s%c%s%c%s%c%s%c%s",
+				std_offset, sep, dst_offset, sep,
+				g->rule.std_abbr, sep, g->rule.dst_abbr, sep, dates);
+
+		for (size_t j = 0; j < g->loc_count; j++) {
+			fprintf(out, "%c%s", sep, g->locs[j]->name);
+		}
+
+		fputc('\n', out);
+	}
+
+	return ferror(out) ? -1 : 0;
+}
+
+void tze_reverse_free(struct tze_reverse_t *rev)
+{
+	free(rev->groups);
+	free(rev->locs);
+	free(rev->candidates);
+	free(rev->slots);
+	rev->groups = NULL;
+	rev->group_count = 0;
+	rev->locs = NULL;
+	rev->candidates = NULL;
+	rev->slots = NULL;
+	rev->slot_count = 0;
+}
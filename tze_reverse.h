@@ -0,0 +1,86 @@
+#ifndef TZE_REVERSE_H
+#define TZE_REVERSE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "tze_rule.h"
+
+/**
+ * A reverse index of localities by their parsed rules. Localities with
+ * equal offsets, abbreviations and transition dates share a group,
+ * every group is reachable in O(1) by an observed UTC offset
+ * and a DST state.
+ *
+ * A printed group is a single line:
+ *
+ *   {std offset}{sep}{dst offset}{sep}{std abbr}{sep}{dst abbr}{sep}
+ *   {start date},{end date}{sep}{locality}[{sep}{locality}...]
+ *
+ * with offsets as "+hh:mm[:ss]" east of UTC and DST fields empty
+ * for rules without DST.
+ **/
+
+#define TZE_REVERSE_INIT				\
+	{									\
+		.groups			= 0,			\
+		.group_count	= 0,			\
+		.locs			= 0,			\
+		.candidates		= 0,			\
+		.slots			= 0,			\
+		.slot_count		= 0				\
+	}
+
+struct tze_err_t;
+struct tze_list_t;
+struct tze_locality_t;
+
+struct tze_reverse_group_t {
+	struct tze_rule_t			  rule;
+	const struct tze_locality_t **locs;
+	size_t						  loc_count;
+};
+
+struct tze_reverse_slot_t {
+	int32_t	 offset;
+	bool	 dst;
+	uint32_t first;						/* in a candidate array			 */
+	uint32_t count;						/* 0 for an empty slot			 */
+};
+
+struct tze_reverse_t {
+	struct tze_reverse_group_t		  *groups;
+	size_t							   group_count;
+	const struct tze_locality_t		 **locs;		/* of all groups	 */
+	const struct tze_reverse_group_t **candidates;
+	struct tze_reverse_slot_t		  *slots;
+	size_t							   slot_count;
+};
+
+/**
+ * Localities should outlive an index.
+ **/
+
+int tze_reverse_build(struct tze_reverse_t	  *rev,
+					  const struct tze_list_t *loc_list,
+					  struct tze_err_t		  *err);
+
+/**
+ * Returns groups observing a UTC offset (seconds east) with or without
+ * DST, ordered by offsets and abbreviations, and sets a group count.
+ **/
+
+const struct tze_reverse_group_t *const *
+tze_reverse_find(const struct tze_reverse_t *rev,
+				 const int32_t				 offset,
+				 const bool					 dst,
+				 size_t						*count);
+
+int tze_reverse_print(FILE						 *out,
+					  const struct tze_reverse_t *rev,
+					  const char				  sep);
+
+void tze_reverse_free(struct tze_reverse_t *rev);
+
+#endif /* TZE_REVERSE_H */
@@ -1,5 +1,7 @@
 #include <errno.h>
 #include <ctype.h>
+#include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <inttypes.h>
 #include "tze_err.h"
@@ -39,6 +41,9 @@
 #define TZE_MIN_WDAY					(0)
 #define TZE_MAX_WDAY					(6)
 
+#define TZE_DEF_TIME					(2 * TZE_M_IN_H * TZE_S_IN_M)
+#define TZE_DEF_DST_SHIFT				(TZE_M_IN_H * TZE_S_IN_M)
+
 static size_t tze_rule_max_name_length()
 {
 	long max_length = -1;
@@ -65,7 +70,8 @@ static size_t tze_rule_max_name_length()
 }
 
 static int
-tze_rule_check_name(const char **rule)
+tze_rule_check_name(const char **rule,
+					char		*abbr)
 {
 	/**
 	 * The name string specifies the name of the time zone.
@@ -74,6 +80,7 @@ tze_rule_check_name(const char **rule)
 	 **/
 
 	const char *p = *rule;
+	const char *start = p;
 	size_t length = 0;
 
 	if (*p == ':') {
@@ -83,8 +90,7 @@ tze_rule_check_name(const char **rule)
 	if (*p == '<') {
 		/* quoted name: "<+04>..." */
 		p++;
-
-		const char *const start = p;
+		start = p;
 
 		if (*p != '+' && *p != '-') {
 			goto wrong_name;
@@ -104,8 +110,6 @@ tze_rule_check_name(const char **rule)
 		p++;
 	} else {
 		/* unquoted name: "CET..." */
-		const char *const start = p;
-
 		while (isalpha(*p)) {
 			p++;
 		}
@@ -114,10 +118,14 @@ tze_rule_check_name(const char **rule)
 	}
 
 	if (length < TZE_MIN_NAME ||
-		length > tze_rule_max_name_length()) {
+		length > tze_rule_max_name_length() ||
+		length > TZE_RULE_ABBR_MAX) {
 		goto wrong_name;
 	}
 
+	memcpy(abbr, start, length);
+	abbr[length] = '\0';
+
 	*rule = p;
 	return 0;
 
@@ -166,9 +174,11 @@ tze_rule_check_int(const char	 **rule,
 }
 
 static int tze_rule_check_offset(const char **rule,
-								 const bool	  v3)
+								 const bool	  v3,
+								 int32_t	 *value)
 {
 	const char *p = *rule;
+	const bool negative = (*p == '-');
 
 	if (*p != '+' && *p != '-' && !isdigit(*p)) {
 		return -1;
@@ -220,6 +230,7 @@ static int tze_rule_check_offset(const char **rule,
 		goto wrong_offset;
 	}
 
+	*value = negative ? -offset : offset;
 	*rule = p;
 	return 0;
 
@@ -228,13 +239,16 @@ wrong_offset:
 	return -1;
 }
 
-static int tze_rule_check_date(const char **rule,
-							   const bool	v3)
+static int tze_rule_check_date(const char			  **rule,
+							   const bool			   v3,
+							   struct tze_rule_date_t *date)
 {
 	const char *p = *rule;
-	int32_t n = 0;
 	int ret = -1;
 
+	memset(date, 0, sizeof(*date));
+	date->time = TZE_DEF_TIME;
+
 	if (*p == ',') {
 		p++;
 
@@ -246,7 +260,9 @@ static int tze_rule_check_date(const char **rule,
 			 **/
 
 			p++;
-			ret = tze_rule_check_int(&p, TZE_MIN_DAY, TZE_MAX_DAY, &n);
+			date->type = TZE_RULE_DATE_JULIAN;
+			ret = tze_rule_check_int(&p, TZE_MIN_DAY, TZE_MAX_DAY,
+									 &date->day);
 		} else if (*p == 'M') {
 			/**
 			 * "Mm.w.d" format.
@@ -259,16 +275,19 @@ static int tze_rule_check_date(const char **rule,
 			 **/
 
 			p++;
-			ret = tze_rule_check_int(&p, TZE_MIN_MONTH, TZE_MAX_MONTH, &n);
+			date->type = TZE_RULE_DATE_MONTH;
+			ret = tze_rule_check_int(&p, TZE_MIN_MONTH, TZE_MAX_MONTH,
+									 &date->month);
 
 			if (ret == 0 && *p == '.') {
 				p++;
-				ret = tze_rule_check_int(&p, TZE_MIN_WEEK, TZE_MAX_WEEK, &n);
+				ret = tze_rule_check_int(&p, TZE_MIN_WEEK, TZE_MAX_WEEK,
+										 &date->week);
 
 				if (ret == 0 && *p == '.') {
 					p++;
 					ret = tze_rule_check_int(&p, TZE_MIN_WDAY,
-											 TZE_MAX_WDAY, &n);
+											 TZE_MAX_WDAY, &date->wday);
 				}
 			}
 		} else if (isdigit(*p)) {
@@ -278,7 +297,9 @@ static int tze_rule_check_date(const char **rule,
 			 * February 29 is counted in leap years.
 			 **/
 
-			ret = tze_rule_check_int(&p, TZE_MIN_DAY, TZE_MAX_DAY, &n);
+			date->type = TZE_RULE_DATE_DAY;
+			ret = tze_rule_check_int(&p, TZE_MIN_DAY, TZE_MAX_DAY,
+									 &date->day);
 		} else {
 			/**
 			 * Syntax error.
@@ -293,7 +314,7 @@ static int tze_rule_check_date(const char **rule,
 
 	if (*p == '/') {
 		p++;
-		ret = tze_rule_check_offset(&p, v3);
+		ret = tze_rule_check_offset(&p, v3, &date->time);
 
 		if (ret < 0) {
 			*rule = p;
@@ -305,59 +326,70 @@ static int tze_rule_check_date(const char **rule,
 	return 0;
 }
 
-int tze_rule_check(const char		*const rule,
-				   const char		*const locality,
-				   const bool		 v3,
-				   struct tze_err_t *err)
+int tze_rule_parse(const char		 *const rule,
+				   const char		 *const locality,
+				   const bool		  v3,
+				   struct tze_rule_t *parsed,
+				   struct tze_err_t	 *err)
 {
 	const char *p = rule;
 
+	memset(parsed, 0, sizeof(*parsed));
+
 	if (*p == '\0') {
 		return 0;
 	}
 
-	if (tze_rule_check_name(&p) < 0) {
+	if (tze_rule_check_name(&p, parsed->std_abbr) < 0) {
 		tze_err_set(err, 0,
 					"%s: \"%s\" rule has a wrong STD timezone name",
 					locality, rule);
 		return -1;
 	}
 
-	if (tze_rule_check_offset(&p, v3) < 0) {
+	/* POSIX offsets are positive west of Greenwich */
+	if (tze_rule_check_offset(&p, v3, &parsed->std_offset) < 0) {
 		tze_err_set(err, 0,
 					"%s: \"%s\" rule has a wrong STD time offset",
 					locality, rule);
 		return -1;
 	}
 
+	parsed->std_offset = -parsed->std_offset;
+
 	if (*p == '\0') {
 		return 0;
 	}
 
-	if (tze_rule_check_name(&p) < 0) {
+	if (tze_rule_check_name(&p, parsed->dst_abbr) < 0) {
 		tze_err_set(err, 0,
 					"%s: \"%s\" rule has a wrong DST timezone name",
 					locality, rule);
 		return -1;
 	}
 
+	parsed->dst = true;
+	parsed->dst_offset = parsed->std_offset + TZE_DEF_DST_SHIFT;
+
 	if (*p == '+' || *p == '-' || isdigit(*p)) {
-		if (tze_rule_check_offset(&p, v3) < 0) {
+		if (tze_rule_check_offset(&p, v3, &parsed->dst_offset) < 0) {
 			tze_err_set(err, 0,
 						"%s: \"%s\" rule has a wrong DST time offset",
 						locality, rule);
 			return -1;
 		}
+
+		parsed->dst_offset = -parsed->dst_offset;
 	}
 
-	if (tze_rule_check_date(&p, v3) < 0) {
+	if (tze_rule_check_date(&p, v3, &parsed->start) < 0) {
 		tze_err_set(err, 0,
 					"%s: \"%s\" rule has a wrong DST time transition date",
 					locality, rule);
 		return -1;
 	}
 
-	if (tze_rule_check_date(&p, v3) < 0) {
+	if (tze_rule_check_date(&p, v3, &parsed->end) < 0) {
 		tze_err_set(err, 0,
 					"%s: \"%s\" rule has a wrong STD time transition date",
 					locality, rule);
@@ -373,3 +405,210 @@ int tze_rule_check(const char		*const rule,
 
 	return 0;
 }
+
+int tze_rule_format_time(const int32_t	time,
+						 char		   *buf,
+						 const size_t	size)
+{
+	const int32_t t = (time < 0) ? -time : time;
+	const int32_t h = t / (TZE_M_IN_H * TZE_S_IN_M);
+	const int32_t m = t / TZE_S_IN_M % TZE_M_IN_H;
+	const int32_t s = t % TZE_S_IN_M;
+	const char *const sign = (time < 0) ? "-" : "";
+
+	if (s != 0) {
+		return snprintf(buf, size, "%s%" PRId32 ":%02" PRId32 ":%02" PRId32,
+						sign, h, m, s);
+	}
+
+	if (m != 0) {
+		return snprintf(buf, size, "%s%" PRId32 ":%02" PRId32, sign, h, m);
+	}
+
+	return snprintf(buf, size, "%s%" PRId32, sign, h);
+}
+
+int tze_rule_format_date(const struct tze_rule_date_t *date,
+						 char						  *buf,
+						 const size_t				   size)
+{
+	char time[TZE_RULE_TIME_MAX];
+	int n = -1;
+
+	tze_rule_format_time(date->time, time, sizeof(time));
+
+	switch (date->type) {
+	case TZE_RULE_DATE_JULIAN:
+		n = snprintf(buf, size, "J%" PRId32 "/%s", date->day, time);
+		break;
+
+	case TZE_RULE_DATE_DAY:
+		n = snprintf(buf, size, "%" PRId32 "/%s", date->day, time);
+		break;
+
+	case TZE_RULE_DATE_MONTH:
+		n = snprintf(buf, size, "M%" PRId32 ".%" PRId32 ".%" PRId32 "/%s",
+					 date->month, date->week, date->wday, time);
+		break;
+	}
+
+	return n;
+}
+
+static int tze_rule_format_name(const char	*const abbr,
+								char		*buf,
+								const size_t size)
+{
+	for (const char *p = abbr; *p != '\0'; p++) {
+		if (!isalpha(*p)) {
+			return snprintf(buf, size, "<%s>", abbr);
+		}
+	}
+
+	return snprintf(buf, size, "%s", abbr);
+}
+
+int tze_rule_format(const struct tze_rule_t *rule,
+					char					*buf,
+					const size_t			 size)
+{
+	char std_abbr[TZE_RULE_ABBR_MAX + 3];
+	char std_offset[TZE_RULE_TIME_MAX];
+
+	if (rule->std_abbr[0] == '\0') {
+		return snprintf(buf, size, "%s", "");
+	}
+
+	/* POSIX offsets are positive west of Greenwich */
+	tze_rule_format_name(rule->std_abbr, std_abbr, sizeof(std_abbr));
+	tze_rule_format_time(-rule->std_offset, std_offset, sizeof(std_offset));
+
+	if (!rule->dst) {
+		return snprintf(buf, size, "%s%s", std_abbr, std_offset);
+	}
+
+	char dst_abbr[TZE_RULE_ABBR_MAX + 3];
+	char dst_offset[TZE_RULE_TIME_MAX] = "";
+	const struct tze_rule_date_t *dates[] = { &rule->start, &rule->end };
+	char date_bufs[2][TZE_RULE_DATE_MAX];
+
+	tze_rule_format_name(rule->dst_abbr, dst_abbr, sizeof(dst_abbr));
+
+	if (rule->dst_offset != rule->std_offset + TZE_DEF_DST_SHIFT) {
+		tze_rule_format_time(-rule->dst_offset, dst_offset,
+							 sizeof(dst_offset));
+	}
+
+	for (size_t i = 0; i < 2; i++) {
+		char *const date = date_bufs[i];
+		const int n = tze_rule_format_date(dates[i], date, TZE_RULE_DATE_MAX);
+
+		/* drop a default "/2" time */
+		if (n > 0 && dates[i]->time == TZE_DEF_TIME) {
+			*strrchr(date, '/') = '\0';
+		}
+	}
+
+	return snprintf(buf, size, "%s%s%s%s,%s,%s",
+					std_abbr, std_offset, dst_abbr, dst_offset,
+					date_bufs[0], date_bufs[1]);
+}
+
+#define TZE_S_IN_D						(86400)
+#define TZE_D_IN_W						(7)
+
+static inline bool tze_rule_is_leap(const int64_t year)
+{
+	return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+/**
+ * Days since the epoch of a civil date, March based years make
+ * February 29 the last day of a year.
+ **/
+
+static int64_t tze_rule_days(int64_t		  year,
+							 const int32_t month,
+							 const int32_t mday)
+{
+	year -= (month <= 2);
+
+	const int64_t era = ((year >= 0) ? year : year - 399) / 400;
+	const int64_t yoe = year - era * 400;
+	const int64_t doy = (153 * (month + ((month > 2) ? -3 : 9)) + 2) / 5 +
+		mday - 1;
+	const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+	return era * 146097 + doe - 719468;
+}
+
+int64_t tze_rule_year_start(const int32_t year)
+{
+	return tze_rule_days(year, 1, 1) * TZE_S_IN_D;
+}
+
+int32_t tze_rule_year_of(const int64_t time)
+{
+	/* an average Gregorian year estimate is off by one at most */
+	const int64_t days = (time >= 0) ?
+		time / TZE_S_IN_D : (time - TZE_S_IN_D + 1) / TZE_S_IN_D;
+	int64_t year = 1970 + days * 400 / 146097;
+
+	while (tze_rule_days(year + 1, 1, 1) <= days) {
+		year++;
+	}
+
+	while (tze_rule_days(year, 1, 1) > days) {
+		year--;
+	}
+
+	return (int32_t) year;
+}
+
+int64_t tze_rule_transition(const struct tze_rule_t *rule,
+							const int32_t			 year,
+							const bool				 start)
+{
+	const struct tze_rule_date_t *date = start ? &rule->start : &rule->end;
+	int64_t day = tze_rule_days(year, 1, 1);
+
+	switch (date->type) {
+	case TZE_RULE_DATE_JULIAN:
+		day += date->day - 1;
+
+		if (tze_rule_is_leap(year) && date->day >= 60) {
+			day++;
+		}
+
+		break;
+
+	case TZE_RULE_DATE_DAY:
+		day += date->day;
+		break;
+
+	case TZE_RULE_DATE_MONTH: {
+		static const int32_t MDAYS[] = {
+			31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+		};
+		const int64_t first = tze_rule_days(year, date->month, 1);
+		/* January 1, 1970 is a Thursday */
+		const int32_t first_wday = (int32_t) (((first % TZE_D_IN_W) +
+											   TZE_D_IN_W + 4) % TZE_D_IN_W);
+		const int32_t mdays = MDAYS[date->month - 1] +
+			((date->month == 2 && tze_rule_is_leap(year)) ? 1 : 0);
+		int32_t mday = (date->wday - first_wday + TZE_D_IN_W) % TZE_D_IN_W +
+			(date->week - 1) * TZE_D_IN_W;
+
+		while (mday >= mdays) {
+			mday -= TZE_D_IN_W;
+		}
+
+		day = first + mday;
+		break;
+	}
+	}
+
+	/* a start is in standard time, an end is in daylight saving time */
+	return day * TZE_S_IN_D + date->time -
+		(start ? rule->std_offset : rule->dst_offset);
+}
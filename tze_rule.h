@@ -1,13 +1,102 @@
 #ifndef TZE_RULE_H
 #define TZE_RULE_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
+#define TZE_RULE_ABBR_MAX				(32)
+#define TZE_RULE_TIME_MAX				(16)	/* "-167:59:59"		 */
+#define TZE_RULE_DATE_MAX				(32)
+#define TZE_RULE_MAX					\
+	(2 * (TZE_RULE_ABBR_MAX + TZE_RULE_TIME_MAX + TZE_RULE_DATE_MAX) + 8)
+
 struct tze_err_t;
 
-int tze_rule_check(const char		*const rule,
-				   const char		*const locality,
-				   const bool		 v3,
-				   struct tze_err_t *err);
+enum tze_rule_date_type_t {
+	TZE_RULE_DATE_JULIAN,				/* "Jn", no February 29			 */
+	TZE_RULE_DATE_DAY,					/* "n", zero based				 */
+	TZE_RULE_DATE_MONTH					/* "Mm.w.d"						 */
+};
+
+struct tze_rule_date_t {
+	enum tze_rule_date_type_t type;
+	int32_t					  day;
+	int32_t					  month;
+	int32_t					  week;
+	int32_t					  wday;
+	int32_t					  time;		/* seconds of a local day		 */
+};
+
+/**
+ * A parsed POSIX TZ rule, offsets are seconds east of UTC.
+ * An empty rule leaves std_abbr empty.
+ **/
+
+struct tze_rule_t {
+	char				   std_abbr[TZE_RULE_ABBR_MAX + 1];
+	char				   dst_abbr[TZE_RULE_ABBR_MAX + 1];
+	int32_t				   std_offset;
+	int32_t				   dst_offset;
+	bool				   dst;
+	struct tze_rule_date_t start;
+	struct tze_rule_date_t end;
+};
+
+int tze_rule_parse(const char		 *const rule,
+				   const char		 *const locality,
+				   const bool		  v3,
+				   struct tze_rule_t *parsed,
+				   struct tze_err_t	 *err);
+
+/**
+ * Format a time of a day as "[-]h[:mm[:ss]]" and a transition date
+ * with an explicit time, both return a snprintf(3) compatible result.
+ **/
+
+int tze_rule_format_time(const int32_t	time,
+						 char		   *buf,
+						 const size_t	size);
+
+int tze_rule_format_date(const struct tze_rule_date_t *date,
+						 char						  *buf,
+						 const size_t				   size);
+
+/**
+ * Formats a parsed rule canonically, so equal rules format equally:
+ * default DST offsets and transition times are omitted, offsets are
+ * in a shortest form and only non-alphabetic names are quoted.
+ **/
+
+int tze_rule_format(const struct tze_rule_t *rule,
+					char					*buf,
+					const size_t			 size);
+
+/**
+ * Converts between years and seconds since the epoch, UTC.
+ **/
+
+int64_t tze_rule_year_start(const int32_t year);
+
+int32_t tze_rule_year_of(const int64_t time);
+
+/**
+ * Returns a UTC moment DST starts or ends at in a year, the year is
+ * the one of a local date of a transition. A rule should have DST.
+ **/
+
+int64_t tze_rule_transition(const struct tze_rule_t *rule,
+							const int32_t			 year,
+							const bool				 start);
+
+static inline int tze_rule_check(const char		  *const rule,
+								 const char		  *const locality,
+								 const bool		   v3,
+								 struct tze_err_t *err)
+{
+	struct tze_rule_t parsed;
+
+	return tze_rule_parse(rule, locality, v3, &parsed, err);
+}
 
 #endif /* TZE_RULE_H */
@@ -0,0 +1,1688 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "tze_tz.h"
+#include "tze_err.h"
+#include "tze_hash.h"
+#include "tze_deque.h"
+#include "tze_trace.h"
+#include "tze_link.h"
+#include "tze_list.h"
+#include "tze_name.h"
+#include "tze_rule.h"
+#include "tze_scan.h"
+#include "tze_zi.h"
+#include "tze_dentry.h"
+#include "tze_filter.h"
+#include "tze_locality.h"
+
+#define TZE_LOCALITY_MAX				PATH_MAX
+#define TZE_LINK_HOPS_MAX				(40)
+
+/**
+ * Checks a rule of a locality and sets a rule to emit, the rule itself
+ * or its canonical form put to a buffer of TZE_RULE_MAX bytes.
+ **/
+
+static int tze_root_rule(const struct tze_scan_conf_t *conf,
+						 const char				   *const locality,
+						 const char				   *const rule,
+						 const bool					v3,
+						 char						   *canon,
+						 const char				  **out_rule,
+						 struct tze_err_t			   *err)
+{
+	struct tze_rule_t parsed;
+	size_t out_rule_size;
+
+	if (tze_rule_parse(rule, locality, v3, &parsed, err) < 0) {
+		return -1;
+	}
+
+	*out_rule = rule;
+
+	if (!conf->canon) {
+		out_rule_size = strlen(rule);
+	} else {
+		const int n = tze_rule_format(&parsed, canon, TZE_RULE_MAX);
+
+		if (n < 0 || n >= TZE_RULE_MAX) {
+			tze_err_set(err, 0, "%s: unable to canonicalize \"%s\" rule",
+						locality, rule);
+			return -1;
+		}
+
+		*out_rule = canon;
+		out_rule_size = (size_t) n;
+	}
+
+	if (tze_name_has_sep(*out_rule, out_rule_size, conf->sep)) {
+		tze_err_set(err, 0,
+					"%s: a timezone rule \"%s\" contains \"%c\" separator",
+					locality, *out_rule, conf->sep);
+		return -1;
+	}
+
+	return 0;
+}
+
+int tze_root_add(struct tze_root_t *root,
+				 const char		   *const locality,
+				 const char		   *const target,
+				 const char		   *const rule,
+				 const bool			v3,
+				 struct tze_err_t  *err)
+{
+	const char sep = root->conf->sep;
+	const char *out_rule = NULL;
+	char canon[TZE_RULE_MAX];
+
+	if (rule != NULL &&
+		tze_root_rule(root->conf, locality, rule, v3,
+					  canon, &out_rule, err) < 0) {
+		return -1;
+	}
+
+	if (tze_name_has_sep(locality, strlen(locality), sep)) {
+		tze_err_set(err, 0,
+					"%s: a timezone locality contains \"%c\" separator",
+					locality, sep);
+		return -1;
+	}
+
+	if (root->conf->stream != NULL) {
+		/* nothing is kept, links are grouped by tze_stream_regroup() */
+		if (target == NULL) {
+			fprintf(root->conf->stream, "%s%c%s\n", locality, sep, out_rule);
+		} else {
+			if (tze_name_has_sep(target, strlen(target), sep)) {
+				tze_err_set(err, 0,
+							"%s: a link target \"%s\" contains "
+							"\"%c\" separator", locality, target, sep);
+				return -1;
+			}
+
+			fprintf(root->conf->stream, "%s%c%s%c%s\n",
+					locality, sep, target, sep, out_rule);
+		}
+
+		return 0;
+	}
+
+	if (target == NULL) {
+		struct tze_locality_t *loc = tze_locality_alloc(locality, out_rule);
+
+		if (loc == NULL) {
+			tze_err_set(err, errno,
+						"%s: unable to allocate a locality", locality);
+			return -1;
+		}
+
+		tze_list_add_tail(&root->loc_list, &loc->list);
+	} else {
+		struct tze_link_t *link = tze_link_alloc(locality, target, out_rule);
+
+		if (link == NULL) {
+			tze_err_set(err, errno,
+						"%s: unable to allocate a link for \"%s\" target",
+						locality, target);
+			return -1;
+		}
+
+		/* resolved later against the merged locality list */
+		tze_list_add_tail(&root->link_list, &link->list);
+	}
+
+	return 0;
+}
+
+/**
+ * Remembers a file left out of a scan, so that symlinks to it are left
+ * out as well. A target is a first seen name of a skipped duplicate.
+ **/
+
+static int tze_root_skip(struct tze_root_t *root,
+						 const char		   *const locality,
+						 const char		   *const target,
+						 struct tze_err_t  *err)
+{
+	if (root->conf->stream != NULL) {
+		/* links are read through, nothing to check later */
+		return 0;
+	}
+
+	struct tze_link_t *skip = tze_link_alloc(locality, target, NULL);
+
+	if (skip == NULL) {
+		tze_err_set(err, errno, "%s: unable to remember a file", locality);
+		return -1;
+	}
+
+	tze_list_add_tail(&root->skip_list, &skip->list);
+
+	return 0;
+}
+
+static int tze_extract(const char		 *const file_name,
+					   const char		 *const locality,
+					   const char		 *const target,
+					   struct tze_root_t *root,
+					   struct tze_err_t	 *err)
+{
+	char *rule = NULL;
+	bool v3 = false;
+	int64_t span = tze_trace_begin();
+	int ret = tze_tz_read(file_name, locality, &rule, &v3, err);
+
+	tze_trace_end("read file", locality, span);
+
+	if (ret != 0) {
+		if (ret < 0) {
+			return -1;
+		}
+		/* unknown file format, skip an entry */
+		return tze_root_skip(root, locality, locality, err);
+	}
+
+	span = tze_trace_begin();
+	ret = tze_root_add(root, locality, target, rule, v3, err);
+	tze_trace_end("check rule", locality, span);
+	free(rule);
+
+	return ret;
+}
+
+/**
+ * Resolves a symlink without realpath(3): a link body is read once
+ * relative to a directory descriptor and joined with a link directory
+ * name lexically. Link chains and intermediate directory symlinks are
+ * followed later with already collected names.
+ **/
+
+static int tze_link_target(struct tze_root_t *root,
+						   const int		  dir_fd,
+						   const char		 *const d_name,
+						   const char		 *const locality,
+						   char				 *target,
+						   struct tze_err_t	 *err)
+{
+	char body[TZE_LOCALITY_MAX + 1];
+	const int64_t span = tze_trace_begin();
+	const ssize_t n = readlinkat(dir_fd, d_name, body, sizeof(body) - 1);
+
+	tze_trace_end("read link", locality, span);
+
+	if (n < 0) {
+		tze_err_set(err, errno,
+					"%s: unable to read a symlink target", locality);
+		return -1;
+	}
+
+	if ((size_t) n >= sizeof(body) - 1) {
+		tze_err_set(err, ENAMETOOLONG,
+					"%s: unable to read a symlink target", locality);
+		return -1;
+	}
+
+	body[n] = '\0';
+
+	int size = 0;
+
+	if (body[0] == '/') {
+		const char *const dirs[] = { root->real_dir, root->dir };
+		const char *rel = NULL;
+
+		for (size_t i = 0; i < sizeof(dirs) / sizeof(dirs[0]); i++) {
+			const size_t dir_size = strlen(dirs[i]);
+
+			if (strncmp(body, dirs[i], dir_size) == 0 &&
+				(body[dir_size] == '/' || body[dir_size] == '\0')) {
+				rel = body + dir_size;
+				break;
+			}
+		}
+
+		if (rel == NULL) {
+			goto out_of_root;
+		}
+
+		size = snprintf(target, TZE_LOCALITY_MAX + 1, "%s", rel);
+	} else {
+		const char *const slash = strrchr(locality, '/');
+		const int dir_size = (slash == NULL) ? 0 : (int) (slash - locality);
+
+		size = snprintf(target, TZE_LOCALITY_MAX + 1, "%.*s/%s",
+						dir_size, locality, body);
+	}
+
+	if (size < 0 || size > TZE_LOCALITY_MAX) {
+		tze_err_set(err, ENAMETOOLONG,
+					"%s: unable to read a symlink target", locality);
+		return -1;
+	}
+
+	if (tze_name_normalize(target) < 0) {
+		goto out_of_root;
+	}
+
+	return 0;
+
+out_of_root:
+	tze_err_set(err, 0,
+				"%s: a symlink points out of "
+				"the timezone root directory", locality);
+	return -1;
+}
+
+/**
+ * Resolves a symlink of a root with realpath(3), returns a target name
+ * relative to the root to free(3).
+ **/
+
+static char *tze_root_realpath(const struct tze_root_t *root,
+							   const char			   *const locality,
+							   struct tze_err_t		   *err)
+{
+	char file_name[TZE_LOCALITY_MAX * 2 + 2];
+	const size_t real_dir_size = strlen(root->real_dir);
+
+	snprintf(file_name, sizeof(file_name), "%s/%s", root->dir, locality);
+
+	char *const target_file = realpath(file_name, NULL);
+
+	if (target_file == NULL) {
+		tze_err_set(err, errno,
+					"%s: unable to read a symlink target", locality);
+		return NULL;
+	}
+
+	if (strncmp(target_file, root->real_dir, real_dir_size) != 0 ||
+		target_file[real_dir_size] != '/') {
+		tze_err_set(err, 0,
+					"%s: a symlink points out of "
+					"the timezone root directory", locality);
+		free(target_file);
+		return NULL;
+	}
+
+	char *const target = strdup(target_file + real_dir_size + 1);
+
+	free(target_file);
+
+	if (target == NULL) {
+		tze_err_set(err, ENOMEM,
+					"%s: unable to allocate a symlink target", locality);
+	}
+
+	return target;
+}
+
+/**
+ * A stream has no collected names to check a lexical target against
+ * later, so it is checked on a disk: a target should be a file or
+ * a symlink with no symlinks among its parent directories. Otherwise
+ * a target is resolved with realpath(3) as tze_root_check_links() does.
+ **/
+
+static int tze_stream_target(const struct tze_root_t *root,
+							 const char				 *const locality,
+							 char					 *target,
+							 struct tze_err_t		 *err)
+{
+	if (!tze_filter_path(&root->conf->filter, target)) {
+		/* grouped under a first link when regrouped */
+		return 0;
+	}
+
+	char file_name[TZE_LOCALITY_MAX * 2 + 2];
+	struct stat st;
+	const size_t root_size = strlen(root->dir);
+
+	snprintf(file_name, sizeof(file_name), "%s/%s", root->dir, target);
+
+	if (fstatat(AT_FDCWD, file_name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+		(S_ISREG(st.st_mode) || S_ISLNK(st.st_mode))) {
+		const char *const slash = strrchr(target, '/');
+
+		if (slash == NULL) {
+			return 0;
+		}
+
+		const size_t dir_size = (size_t) (slash - target);
+		const size_t real_dir_size = strlen(root->real_dir);
+
+		file_name[root_size + 1 + dir_size] = '\0';
+
+		char *const dir = realpath(file_name, NULL);
+		const bool lexical = (dir != NULL &&
+			strncmp(dir, root->real_dir, real_dir_size) == 0 &&
+			dir[real_dir_size] == '/' &&
+			strncmp(dir + real_dir_size + 1, target, dir_size) == 0 &&
+			dir[real_dir_size + 1 + dir_size] == '\0');
+
+		free(dir);
+
+		if (lexical) {
+			return 0;
+		}
+	}
+
+	char *const real_target = tze_root_realpath(root, locality, err);
+
+	if (real_target == NULL) {
+		return -1;
+	}
+
+	snprintf(target, TZE_LOCALITY_MAX + 1, "%s", real_target);
+	free(real_target);
+
+	return 0;
+}
+
+static int tze_filter(const struct dirent *const e)
+{
+	if (e->d_name[0] == '.') {
+		if (e->d_name[1] == '\0') {
+			return 0;
+		}
+
+		if (e->d_name[1] == '.' && e->d_name[2] == '\0') {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int tze_compar(const struct dirent **l,
+					  const struct dirent **r)
+{
+	return strcoll((*l)->d_name, (*r)->d_name);
+}
+
+static int tze_scan_alias(const int			dir_fd,
+						  const char	   *const d_name,
+						  const char	   *const locality,
+						  const struct stat *st,
+						  struct tze_root_t *root,
+						  struct tze_err_t	*err)
+{
+	/**
+	 * A directory already visited by another name,
+	 * its subtree is aliased once the whole root is scanned.
+	 **/
+
+	if (root->conf->dup == TZE_DUP_SKIP) {
+		return 0;
+	}
+
+	const struct tze_inode_t *seen = tze_inode_get(&root->inodes,
+												   st->st_dev, st->st_ino);
+	char target[TZE_LOCALITY_MAX + 1];
+
+	if (seen != NULL) {
+		snprintf(target, sizeof(target), "%s", seen->name);
+	} else if (tze_link_target(root, dir_fd, d_name,
+							   locality, target, err) < 0) {
+		return -1;
+	}
+
+	struct tze_link_t *alias = tze_link_alloc(locality, target, NULL);
+
+	if (alias == NULL) {
+		tze_err_set(err, errno,
+					"%s: unable to allocate a directory alias", locality);
+		return -1;
+	}
+
+	tze_list_add_tail(&root->alias_list, &alias->list);
+
+	return 0;
+}
+
+static int tze_scan_file(const char		   *const file_name,
+						 const char		   *const locality,
+						 const struct stat *st,
+						 struct tze_root_t *root,
+						 struct tze_err_t  *err)
+{
+	if (root->conf->dup == TZE_DUP_PARSE || st->st_nlink <= 1) {
+		return tze_extract(file_name, locality, NULL, root, err);
+	}
+
+	const struct tze_inode_t *seen = tze_inode_get(&root->inodes,
+												   st->st_dev, st->st_ino);
+
+	if (seen != NULL) {
+		const struct tze_locality_t *seen_loc = seen->value;
+
+		if (root->conf->dup == TZE_DUP_SKIP || seen_loc == NULL) {
+			/* skipped or the first file was not a timezone one */
+			return tze_root_skip(root, locality, seen->name, err);
+		}
+
+		struct tze_link_t *link =
+			tze_link_alloc(locality, seen_loc->name, seen_loc->rule);
+
+		if (link == NULL) {
+			tze_err_set(err, errno,
+						"%s: unable to allocate a link for \"%s\" target",
+						locality, seen_loc->name);
+			return -1;
+		}
+
+		tze_list_add_tail(&root->link_list, &link->list);
+
+		return 0;
+	}
+
+	const struct tze_list_t *tail = root->loc_list.prev;
+
+	if (tze_extract(file_name, locality, NULL, root, err) < 0) {
+		return -1;
+	}
+
+	struct tze_locality_t *loc = (root->loc_list.prev == tail) ? NULL :
+		tze_list_entry(root->loc_list.prev, struct tze_locality_t, list);
+
+	if (tze_inode_put(&root->inodes, st->st_dev, st->st_ino,
+					  locality, loc) < 0) {
+		tze_err_set(err, errno, "%s: unable to remember a file", locality);
+		return -1;
+	}
+
+	return 0;
+}
+
+struct tze_scan_pool_t;
+
+struct tze_scan_worker_t {
+	struct tze_root_t		root;		/* results of a worker			 */
+	struct tze_deque_t		deque;		/* of directory names			 */
+	struct tze_scan_pool_t *pool;
+	size_t					index;
+	pthread_t				thread;
+};
+
+struct tze_scan_pool_t {
+	struct tze_scan_worker_t *workers;
+	size_t					  worker_count;
+	size_t					  root_size;
+	pthread_mutex_t			  lock;
+	pthread_cond_t			  cond;
+	size_t					  pending;	/* queued and running tasks		 */
+	unsigned long			  pushes;	/* wakes up idle workers		 */
+	bool					  failed;
+};
+
+/**
+ * Queues a directory to a worker's own deque.
+ **/
+
+static int tze_scan_push(struct tze_scan_worker_t *w,
+						 const char				  *const dir_name,
+						 struct tze_err_t		  *err)
+{
+	struct tze_scan_pool_t *pool = w->pool;
+	char *const task = strdup(dir_name);
+	int ret = -1;
+
+	if (task == NULL) {
+		tze_err_set(err, errno, "%s: unable to queue a directory",
+					dir_name + pool->root_size + 1);
+		return -1;
+	}
+
+	/* counted before it can be stolen and finished */
+	pthread_mutex_lock(&pool->lock);
+
+	if (tze_deque_push(&w->deque, task) < 0) {
+		tze_err_set(err, errno, "%s: unable to queue a directory",
+					dir_name + pool->root_size + 1);
+		free(task);
+	} else {
+		pool->pending++;
+		pool->pushes++;
+		pthread_cond_signal(&pool->cond);
+		ret = 0;
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	return ret;
+}
+
+/**
+ * Asks the kernel to start reading a regular file in the background,
+ * so a storage queue stays full while earlier files are parsed.
+ * Files a scan is not going to read, filtered out or duplicates,
+ * are not prefetched. A prefetch is a hint only, failures are ignored.
+ **/
+
+static void tze_prefetch(const struct tze_root_t *root,
+						 const int				  dir_fd,
+						 const char				 *const dir,
+						 const struct dirent	 *const e)
+{
+	const struct tze_filter_t *filter = &root->conf->filter;
+	const enum tze_dup_t dup = root->conf->dup;
+	struct stat st;
+
+	if (e->d_type != DT_REG && e->d_type != DT_UNKNOWN) {
+		return;
+	}
+
+	if (!tze_filter_is_empty(filter)) {
+		char locality[TZE_LOCALITY_MAX + 1];
+		const int n = (dir == NULL) ?
+			snprintf(locality, sizeof(locality), "%s", e->d_name) :
+			snprintf(locality, sizeof(locality), "%s/%s", dir, e->d_name);
+
+		if (n < 0 || (size_t) n >= sizeof(locality) ||
+			!tze_filter_file(filter, locality)) {
+			return;
+		}
+	}
+
+	if (e->d_type == DT_UNKNOWN || dup != TZE_DUP_PARSE) {
+		if (fstatat(dir_fd, e->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0 ||
+			!S_ISREG(st.st_mode)) {
+			return;
+		}
+
+		if (dup != TZE_DUP_PARSE && st.st_nlink > 1 &&
+			tze_inode_get(&root->inodes, st.st_dev, st.st_ino) != NULL) {
+			/* a hardlink already seen is linked or skipped, not read */
+			return;
+		}
+	}
+
+	const int fd = openat(dir_fd, e->d_name,
+						  O_RDONLY | O_CLOEXEC | O_NOFOLLOW | O_NONBLOCK);
+
+	if (fd >= 0) {
+		posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		close(fd);
+	}
+}
+
+static int tze_scan_dir(const char			*const dir_name,
+						const size_t		 root_size,
+						struct tze_dentry_t	*dentry,
+						struct tze_root_t	*root,
+						struct tze_err_t	*err)
+{
+	int ret = -1;
+	int is_root = (strlen(dir_name) == root_size);
+	const enum tze_dup_t dup = root->conf->dup;
+	const size_t readahead = root->conf->readahead;
+	const int64_t span = tze_trace_begin();
+	struct dirent **namelist;
+	const int n = scandir(dir_name, &namelist, tze_filter, tze_compar);
+
+	if (n < 0) {
+		tze_err_set(err, errno, "failed to list \"%s\" subdirectory",
+					is_root ? "." : (dir_name + root_size));
+		return ret;
+	}
+
+	size_t i = 0;
+	const int dir_fd = open(dir_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+	if (dir_fd < 0) {
+		tze_err_set(err, errno, "failed to open \"%s\" subdirectory",
+					is_root ? "." : (dir_name + root_size));
+		goto free_namelist;
+	}
+
+	/* a next entry not prefetched yet */
+	size_t ahead = 1;
+
+	for (; i < (size_t) n; i++) {
+		const char *const d_name = namelist[i]->d_name;
+
+		for (; readahead > 0 && ahead < (size_t) n &&
+			 ahead <= i + readahead; ahead++) {
+			tze_prefetch(root, dir_fd,
+						 is_root ? NULL : dir_name + root_size + 1,
+						 namelist[ahead]);
+		}
+
+		if (tze_dentry_set(dentry, dir_name, d_name) < 0) {
+			tze_err_set(err, errno,
+						"%s%s%s: unable to create a directory entry name",
+						is_root ? "" : dir_name + root_size,
+						is_root ? "" : "/",
+						d_name);
+			goto free_namelist;
+		}
+
+		struct stat st;
+		const char *const file_name = tze_dentry_name(dentry);
+		const char *const locality = file_name + root_size + 1;
+
+		if (fstatat(dir_fd, d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+			tze_err_set(err, errno,
+						"failed to get \"%s\" "
+						"directory entry information",
+						locality);
+			goto free_namelist;
+		}
+
+		if (S_ISLNK(st.st_mode) && dup != TZE_DUP_PARSE) {
+			struct stat target_st;
+
+			if (fstatat(dir_fd, d_name, &target_st, 0) == 0 &&
+				S_ISDIR(target_st.st_mode)) {
+				/* a symlink to a directory */
+				if (tze_filter_dir(&root->conf->filter, locality) &&
+					tze_scan_alias(dir_fd, d_name, locality,
+								   &target_st, root, err) < 0) {
+					goto free_namelist;
+				}
+
+				free(namelist[i]);
+				continue;
+			}
+		}
+
+		if (S_ISDIR(st.st_mode)) {
+			if (!tze_filter_dir(&root->conf->filter, locality)) {
+				/* a whole subtree is filtered out */
+				free(namelist[i]);
+				continue;
+			}
+
+			if (dup != TZE_DUP_PARSE) {
+				if (tze_inode_get(&root->inodes,
+								  st.st_dev, st.st_ino) != NULL) {
+					if (tze_scan_alias(dir_fd, d_name, locality,
+									   &st, root, err) < 0) {
+						goto free_namelist;
+					}
+
+					free(namelist[i]);
+					continue;
+				}
+
+				if (tze_inode_put(&root->inodes, st.st_dev, st.st_ino,
+								  locality, NULL) < 0) {
+					tze_err_set(err, errno,
+								"%s: unable to remember a directory",
+								locality);
+					goto free_namelist;
+				}
+			}
+
+			if (root->worker != NULL) {
+				/* a parallel traversal, may be stolen by another thread */
+				if (tze_scan_push(root->worker, file_name, err) < 0) {
+					goto free_namelist;
+				}
+
+				free(namelist[i]);
+				continue;
+			}
+
+			struct tze_dentry_t sub_dentry = TZE_DENTRY_INIT;
+			const int scan_ret = tze_scan_dir(file_name, root_size,
+											  &sub_dentry, root, err);
+
+			tze_dentry_free(&sub_dentry);
+
+			if (scan_ret < 0) {
+				goto free_namelist;
+			}
+		} else if (S_ISREG(st.st_mode) || S_ISLNK(st.st_mode)) {
+			if (strlen(locality) > TZE_LOCALITY_MAX) {
+				tze_err_set(err, 0, "%s: a locality name is too long",
+							locality);
+				goto free_namelist;
+			}
+
+			if (!tze_filter_file(&root->conf->filter, locality)) {
+				free(namelist[i]);
+				continue;
+			}
+
+			if (S_ISLNK(st.st_mode)) {
+				char target[TZE_LOCALITY_MAX + 1];
+
+				if (tze_link_target(root, dir_fd, d_name,
+									locality, target, err) < 0) {
+					goto free_namelist;
+				}
+
+				if (root->conf->stream == NULL) {
+					/* a rule is read at a merge if a target is missing */
+					if (tze_root_add(root, locality, target,
+									 NULL, false, err) < 0) {
+						goto free_namelist;
+					}
+				} else if (tze_stream_target(root, locality,
+											 target, err) < 0 ||
+						   tze_extract(file_name, locality,
+									   target, root, err) < 0) {
+					goto free_namelist;
+				}
+			} else if (tze_scan_file(file_name, locality,
+									 &st, root, err) < 0) {
+				goto free_namelist;
+			}
+		} else {
+			/* not a regular file, symlink or directory */
+			tze_err_set(err, 0, "%s: unsupported filesystem node type",
+						locality);
+			goto free_namelist;
+		}
+
+		free(namelist[i]);
+	}
+
+	ret = 0;
+
+free_namelist:
+	if (dir_fd >= 0) {
+		close(dir_fd);
+	}
+
+	for (; i < (size_t) n; i++) {
+		free(namelist[i]);
+	}
+
+	free(namelist);
+
+	if (root->conf->stream != NULL) {
+		/* records of a directory show up as soon as it is scanned */
+		fflush(root->conf->stream);
+	}
+
+	tze_trace_end("scan dir", is_root ? "." : dir_name + root_size + 1, span);
+
+	return ret;
+}
+
+void tze_root_init(struct tze_root_t			*root,
+				   const char					*const dir,
+				   const struct tze_scan_conf_t *conf)
+{
+	root->dir = dir;
+	root->real_dir = NULL;
+	root->conf = conf;
+	root->ret = 0;
+	root->worker = NULL;
+	tze_list_init(&root->loc_list);
+	tze_list_init(&root->link_list);
+	tze_list_init(&root->alias_list);
+	tze_list_init(&root->skip_list);
+	tze_inode_map_init(&root->inodes);
+	tze_err_clear(&root->err);
+}
+
+static void tze_link_list_free(struct tze_list_t *link_list)
+{
+	while (!tze_list_is_empty(link_list)) {
+		struct tze_link_t *link = tze_list_entry(link_list->next,
+												 struct tze_link_t,
+												 list);
+		tze_list_del(&link->list);
+		tze_link_free(link);
+	}
+}
+
+void tze_root_free(struct tze_root_t *root)
+{
+	while (!tze_list_is_empty(&root->loc_list)) {
+		struct tze_locality_t *loc = tze_list_entry(root->loc_list.next,
+													struct tze_locality_t,
+													list);
+		tze_list_del(&loc->list);
+		tze_locality_free(loc);
+	}
+
+	tze_link_list_free(&root->link_list);
+	tze_link_list_free(&root->alias_list);
+	tze_link_list_free(&root->skip_list);
+	tze_inode_map_free(&root->inodes);
+	free(root->real_dir);
+	root->real_dir = NULL;
+}
+
+static int tze_root_alias(struct tze_root_t		  *root,
+						  const struct tze_link_t *alias,
+						  const char			  *const name,
+						  const char			  *const rule)
+{
+	const size_t target_size = strlen(alias->target);
+	struct tze_err_t *err = &root->err;
+	char locality[TZE_LOCALITY_MAX + 1];
+
+	if (target_size > 0) {
+		if (strncmp(name, alias->target, target_size) != 0 ||
+			name[target_size] != '/') {
+			return 0;
+		}
+	} else if (strncmp(name, alias->name, strlen(alias->name)) == 0 &&
+			   name[strlen(alias->name)] == '/') {
+		/* an alias of the root directory itself */
+		return 0;
+	}
+
+	const int n = snprintf(locality, sizeof(locality), "%s%s%s",
+						   alias->name, (target_size > 0) ? "" : "/",
+						   name + target_size);
+
+	if (n < 0 || (size_t) n >= sizeof(locality)) {
+		tze_err_set(err, 0, "%s/%s: a locality name is too long",
+					alias->name, name + target_size);
+		return -1;
+	}
+
+	if (!tze_filter_path(&root->conf->filter, locality)) {
+		return 0;
+	}
+
+	if (tze_name_has_sep(locality, (size_t) n, root->conf->sep)) {
+		tze_err_set(err, 0,
+					"%s: a timezone locality contains \"%c\" separator",
+					locality, root->conf->sep);
+		return -1;
+	}
+
+	struct tze_link_t *link = tze_link_alloc(locality, name, rule);
+
+	if (link == NULL) {
+		tze_err_set(err, errno,
+					"%s: unable to allocate a link for \"%s\" target",
+					locality, name);
+		return -1;
+	}
+
+	tze_list_add_tail(&root->link_list, &link->list);
+
+	return 0;
+}
+
+static int tze_root_expand_aliases(struct tze_root_t *root)
+{
+	struct tze_link_t *alias;
+
+	tze_list_foreach_entry(alias, struct tze_link_t, list,
+						   &root->alias_list) {
+		struct tze_locality_t *loc;
+		const struct tze_list_t *last = root->link_list.prev;
+
+		tze_list_foreach_entry(loc, struct tze_locality_t, list,
+							   &root->loc_list) {
+			if (tze_root_alias(root, alias, loc->name, loc->rule) < 0) {
+				return -1;
+			}
+		}
+
+		if (tze_list_is_empty(&root->link_list)) {
+			continue;
+		}
+
+		/* links added above are aliases already */
+		struct tze_link_t *link =
+			tze_list_entry(root->link_list.next, struct tze_link_t, list);
+
+		while (1) {
+			if (tze_root_alias(root, alias, link->name, link->rule) < 0) {
+				return -1;
+			}
+
+			if (&link->list == last) {
+				break;
+			}
+
+			link = tze_list_entry(link->list.next, struct tze_link_t, list);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Leaves out links to files left out of a scan and links to those links,
+ * as a scan which reads a rule through a link would.
+ **/
+
+static int tze_root_skip_links(struct tze_root_t *root)
+{
+	int ret = -1;
+	struct tze_hash_t skipped = TZE_HASH_INIT;
+	struct tze_link_t *link, *link_next;
+	bool changed = true;
+
+	if (tze_list_is_empty(&root->skip_list)) {
+		return 0;
+	}
+
+	tze_list_foreach_entry(link, struct tze_link_t, list,
+						   &root->skip_list) {
+		if (tze_hash_put(&skipped, link->name, link) < 0) {
+			goto no_memory;
+		}
+	}
+
+	while (changed) {
+		changed = false;
+
+		for (link = tze_list_entry(root->link_list.next,
+								   struct tze_link_t, list);
+			 &link->list != &root->link_list; link = link_next) {
+			link_next = tze_list_entry(link->list.next,
+									   struct tze_link_t, list);
+
+			if (!tze_hash_has(&skipped, link->target)) {
+				continue;
+			}
+
+			/* a name is kept by a skip list until a root is freed */
+			tze_list_del(&link->list);
+			tze_list_add_tail(&root->skip_list, &link->list);
+
+			if (tze_hash_put(&skipped, link->name, link) < 0) {
+				goto no_memory;
+			}
+
+			changed = true;
+		}
+	}
+
+	ret = 0;
+	goto free_skipped;
+
+no_memory:
+	tze_err_set(&root->err, ENOMEM, "unable to skip symlinks");
+
+free_skipped:
+	tze_hash_free(&skipped);
+	return ret;
+}
+
+/**
+ * A lexical link target missing among the collected names is either
+ * filtered out, reached through a directory symlink which was not
+ * aliased or found in another root: only those rare links are resolved
+ * with realpath(3), a dangling one keeps its lexical target for a merge.
+ **/
+
+static int tze_root_check_links(struct tze_root_t *root)
+{
+	int ret = -1;
+	struct tze_err_t *err = &root->err;
+	struct tze_hash_t names = TZE_HASH_INIT;
+	struct tze_locality_t *loc;
+	struct tze_link_t *link;
+
+	tze_list_foreach_entry(loc, struct tze_locality_t, list,
+						   &root->loc_list) {
+		if (tze_hash_put(&names, loc->name, loc) < 0) {
+			goto no_memory;
+		}
+	}
+
+	tze_list_foreach_entry(link, struct tze_link_t, list,
+						   &root->link_list) {
+		if (tze_hash_put(&names, link->name, link) < 0) {
+			goto no_memory;
+		}
+	}
+
+	tze_list_foreach_entry(link, struct tze_link_t, list,
+						   &root->link_list) {
+		if (tze_hash_has(&names, link->target) ||
+			!tze_filter_path(&root->conf->filter, link->target)) {
+			continue;
+		}
+
+		char *const target = tze_root_realpath(root, link->name, err);
+
+		if (target == NULL) {
+			const int code = tze_err_code(err);
+
+			if (code == ENOENT || code == ENOTDIR) {
+				tze_err_clear(err);
+				continue;
+			}
+
+			goto free_names;
+		}
+
+		free(link->target);
+		link->target = target;
+	}
+
+	ret = 0;
+	goto free_names;
+
+no_memory:
+	tze_err_set(err, ENOMEM, "unable to check symlink targets");
+
+free_names:
+	tze_hash_free(&names);
+	return ret;
+}
+
+static void *tze_scan_work(void *arg)
+{
+	struct tze_scan_worker_t *w = arg;
+	struct tze_scan_pool_t *pool = w->pool;
+
+	while (1) {
+		pthread_mutex_lock(&pool->lock);
+
+		const unsigned long pushes = pool->pushes;
+		const bool failed = pool->failed;
+
+		pthread_mutex_unlock(&pool->lock);
+
+		if (failed) {
+			break;
+		}
+
+		char *task = tze_deque_pop(&w->deque);
+
+		for (size_t i = 1; task == NULL && i < pool->worker_count; i++) {
+			const size_t victim = (w->index + i) % pool->worker_count;
+
+			task = tze_deque_steal(&pool->workers[victim].deque);
+		}
+
+		if (task == NULL) {
+			bool done;
+
+			/* nothing to steal, wait for a push or the end */
+			pthread_mutex_lock(&pool->lock);
+
+			while (pool->pending > 0 && !pool->failed &&
+				   pool->pushes == pushes) {
+				pthread_cond_wait(&pool->cond, &pool->lock);
+			}
+
+			done = (pool->pending == 0 || pool->failed);
+			pthread_mutex_unlock(&pool->lock);
+
+			if (done) {
+				break;
+			}
+
+			continue;
+		}
+
+		struct tze_dentry_t dentry = TZE_DENTRY_INIT;
+		const int ret = tze_scan_dir(task, pool->root_size, &dentry,
+									 &w->root, &w->root.err);
+
+		tze_dentry_free(&dentry);
+		free(task);
+
+		pthread_mutex_lock(&pool->lock);
+		pool->pending--;
+
+		if (ret < 0) {
+			w->root.ret = -1;
+			pool->failed = true;
+		}
+
+		if (pool->pending == 0 || pool->failed) {
+			pthread_cond_broadcast(&pool->cond);
+		}
+
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return NULL;
+}
+
+/**
+ * Traverses a root with a pool of workers, worker results are moved
+ * to the root, an order is restored by tze_roots_merge().
+ **/
+
+static int tze_root_scan_parallel(struct tze_root_t *root)
+{
+	struct tze_scan_pool_t pool = {
+		.workers		= NULL,
+		.worker_count	= root->conf->jobs,
+		.root_size		= strlen(root->dir),
+		.pending		= 0,
+		.pushes			= 0,
+		.failed			= false
+	};
+	size_t ready = 0;
+	size_t started = 1;
+	int ret = -1;
+
+	pool.workers = calloc(pool.worker_count, sizeof(*pool.workers));
+
+	if (pool.workers == NULL) {
+		tze_err_set(&root->err, ENOMEM, "unable to allocate scan workers");
+		return -1;
+	}
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.cond, NULL);
+
+	for (; ready < pool.worker_count; ready++) {
+		struct tze_scan_worker_t *w = &pool.workers[ready];
+
+		if (tze_deque_init(&w->deque) != 0) {
+			tze_err_set(&root->err, 0, "unable to initialize a scan worker");
+			goto free_workers;
+		}
+
+		tze_root_init(&w->root, root->dir, root->conf);
+		w->root.real_dir = root->real_dir;
+		w->root.worker = w;
+		w->pool = &pool;
+		w->index = ready;
+	}
+
+	if (tze_scan_push(&pool.workers[0], root->dir, &root->err) < 0) {
+		goto free_workers;
+	}
+
+	/* the first worker is the calling thread */
+	for (; started < pool.worker_count; started++) {
+		struct tze_scan_worker_t *w = &pool.workers[started];
+
+		if (pthread_create(&w->thread, NULL, tze_scan_work, w) != 0) {
+			/* the rest of the pool does the work */
+			break;
+		}
+	}
+
+	tze_scan_work(&pool.workers[0]);
+
+	for (size_t i = 1; i < started; i++) {
+		pthread_join(pool.workers[i].thread, NULL);
+	}
+
+	ret = 0;
+
+	for (size_t i = 0; i < pool.worker_count; i++) {
+		const struct tze_scan_worker_t *w = &pool.workers[i];
+
+		if (w->root.ret < 0) {
+			root->err = w->root.err;
+			ret = -1;
+			break;
+		}
+	}
+
+free_workers:
+	for (size_t i = 0; i < ready; i++) {
+		struct tze_scan_worker_t *w = &pool.workers[i];
+		char *task;
+
+		/* left after a failure */
+		while ((task = tze_deque_pop(&w->deque)) != NULL) {
+			free(task);
+		}
+
+		tze_deque_free(&w->deque);
+		tze_list_splice_tail(&root->loc_list, &w->root.loc_list);
+		tze_list_splice_tail(&root->link_list, &w->root.link_list);
+		tze_list_splice_tail(&root->skip_list, &w->root.skip_list);
+	}
+
+	pthread_cond_destroy(&pool.cond);
+	pthread_mutex_destroy(&pool.lock);
+	free(pool.workers);
+
+	return ret;
+}
+
+static void *tze_root_scan(void *arg)
+{
+	struct tze_root_t *root = arg;
+	struct tze_dentry_t dentry = TZE_DENTRY_INIT;
+	const size_t root_size = strlen(root->dir);
+	int64_t span = tze_trace_begin();
+	struct stat st;
+
+	root->real_dir = realpath(root->dir, NULL);
+
+	if (root->real_dir == NULL) {
+		tze_err_set(&root->err, errno,
+					"failed to resolve \".\" directory name");
+		root->ret = -1;
+		return NULL;
+	}
+
+	if (stat(root->dir, &st) == 0 && S_ISREG(st.st_mode)) {
+		root->ret = tze_zi_scan(root, &root->err);
+		tze_trace_end("read zic source", root->dir, span);
+		return NULL;
+	}
+
+	if (root->conf->dup != TZE_DUP_PARSE) {
+		if (stat(root->dir, &st) < 0) {
+			tze_err_set(&root->err, errno,
+						"failed to get \".\" directory information");
+			root->ret = -1;
+			return NULL;
+		}
+
+		if (tze_inode_put(&root->inodes, st.st_dev, st.st_ino,
+						  "", NULL) < 0) {
+			tze_err_set(&root->err, errno,
+						"unable to remember a root directory");
+			root->ret = -1;
+			return NULL;
+		}
+	}
+
+	if (root->conf->jobs > 1 && root->conf->dup == TZE_DUP_PARSE) {
+		root->ret = tze_root_scan_parallel(root);
+	} else {
+		root->ret = tze_scan_dir(root->dir, root_size, &dentry,
+								 root, &root->err);
+		tze_dentry_free(&dentry);
+	}
+
+	tze_trace_end("scan root", root->dir, span);
+	span = tze_trace_begin();
+
+	if (root->ret >= 0) {
+		root->ret = tze_root_expand_aliases(root);
+	}
+
+	if (root->ret >= 0) {
+		root->ret = tze_root_skip_links(root);
+	}
+
+	if (root->ret >= 0) {
+		root->ret = tze_root_check_links(root);
+	}
+
+	tze_trace_end("resolve links", root->dir, span);
+
+	return NULL;
+}
+
+int tze_roots_scan(struct tze_root_t *roots,
+				   const size_t		  root_count,
+				   struct tze_err_t	 *err)
+{
+	size_t started = 1;
+
+	/* the first root is scanned by the calling thread */
+	for (; started < root_count; started++) {
+		struct tze_root_t *root = &roots[started];
+		const int ret = pthread_create(&root->thread, NULL,
+									   tze_root_scan, root);
+
+		if (ret != 0) {
+			root->ret = -1;
+			tze_err_set(&root->err, ret, "unable to start a scan thread");
+			break;
+		}
+	}
+
+	tze_root_scan(&roots[0]);
+
+	for (size_t i = 1; i < started; i++) {
+		pthread_join(roots[i].thread, NULL);
+	}
+
+	for (size_t i = 0; i < root_count; i++) {
+		const struct tze_root_t *root = &roots[i];
+
+		if (root->ret < 0) {
+			if (root_count == 1) {
+				*err = root->err;
+			} else {
+				tze_err_set(err, tze_err_code(&root->err), "%s: %s",
+							root->dir, tze_err_msg(&root->err));
+			}
+
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int tze_qsort_loc_compar(const void *l,
+								const void *r)
+{
+	const struct tze_locality_t *const *ll = l;
+	const struct tze_locality_t *const *rl = r;
+
+	return tze_name_compar((*ll)->name, (*rl)->name);
+}
+
+static int tze_qsort_link_compar(const void *l,
+								 const void *r)
+{
+	const struct tze_link_t *const *ll = l;
+	const struct tze_link_t *const *rl = r;
+
+	return tze_name_compar((*ll)->name, (*rl)->name);
+}
+
+static struct tze_locality_t *
+tze_link_resolve(const struct tze_hash_t *loc_index,
+				 const struct tze_hash_t *link_index,
+				 struct tze_hash_t		 *memo,
+				 const struct tze_link_t *link,
+				 const char				**target)
+{
+	const char *chain[TZE_LINK_HOPS_MAX];
+	struct tze_locality_t *loc = tze_hash_get(memo, link->name);
+	size_t hops = 0;
+
+	*target = link->target;
+
+	if (loc != NULL) {
+		return loc;
+	}
+
+	chain[hops++] = link->name;
+
+	while (1) {
+		loc = tze_hash_get(loc_index, *target);
+
+		if (loc == NULL) {
+			/* an intermediate link resolved before */
+			loc = tze_hash_get(memo, *target);
+		}
+
+		if (loc != NULL) {
+			break;
+		}
+
+		/* a target may be overridden by a link of a later root */
+		const struct tze_link_t *next = tze_hash_get(link_index, *target);
+
+		if (next == NULL) {
+			return NULL;
+		}
+
+		if (hops == TZE_LINK_HOPS_MAX) {
+			*target = NULL;
+			return NULL;
+		}
+
+		chain[hops++] = next->name;
+		*target = next->target;
+	}
+
+	for (size_t i = 0; i < hops; i++) {
+		/* a memo is an optimization only, ignore allocation failures */
+		tze_hash_put(memo, chain[i], loc);
+	}
+
+	return loc;
+}
+
+/**
+ * Reads a rule of a link whose target is missing from a merged list,
+ * the target file is looked up in the latest root which has it.
+ * Returns 1 if a file has an unknown format to skip a link.
+ **/
+
+static int tze_link_rule(const struct tze_root_t *roots,
+						 const size_t			  root_count,
+						 struct tze_link_t		 *link,
+						 const char				 *const target,
+						 struct tze_err_t		 *err)
+{
+	char file_name[TZE_LOCALITY_MAX * 2 + 2];
+	char canon[TZE_RULE_MAX];
+	const char *out_rule = NULL;
+	char *rule = NULL;
+	bool v3 = false;
+	int ret = -1;
+	int64_t span = tze_trace_begin();
+
+	for (size_t i = root_count; i-- > 0;) {
+		snprintf(file_name, sizeof(file_name), "%s/%s", roots[i].dir, target);
+		ret = tze_tz_read(file_name, link->name, &rule, &v3, err);
+
+		if (ret >= 0 || (tze_err_code(err) != ENOENT &&
+						 tze_err_code(err) != ENOTDIR)) {
+			break;
+		}
+	}
+
+	tze_trace_end("read file", link->name, span);
+
+	if (ret != 0) {
+		return ret;
+	}
+
+	span = tze_trace_begin();
+	ret = tze_root_rule(roots->conf, link->name, rule, v3,
+						canon, &out_rule, err);
+	tze_trace_end("check rule", link->name, span);
+
+	if (ret == 0) {
+		link->rule = strdup(out_rule);
+
+		if (link->rule == NULL) {
+			tze_err_set(err, ENOMEM,
+						"%s: unable to allocate a rule", link->name);
+			ret = -1;
+		}
+	}
+
+	free(rule);
+
+	return ret;
+}
+
+int tze_roots_merge(struct tze_root_t			 *roots,
+					const size_t				  root_count,
+					const struct tze_scan_conf_t *conf,
+					struct tze_list_t			 *loc_list,
+					struct tze_err_t			 *err)
+{
+	const char sep = conf->sep;
+	const struct tze_filter_t *filter = &conf->filter;
+	int ret = -1;
+	size_t loc_count = 0;
+	size_t link_count = 0;
+	struct tze_locality_t **locs = NULL;
+	struct tze_locality_t **targets = NULL;
+	struct tze_link_t **links = NULL;
+	struct tze_hash_t loc_index = TZE_HASH_INIT;
+	struct tze_hash_t link_index = TZE_HASH_INIT;
+	struct tze_hash_t promoted = TZE_HASH_INIT;
+	struct tze_hash_t memo = TZE_HASH_INIT;
+
+	for (size_t i = root_count; i-- > 0;) {
+		struct tze_root_t *root = &roots[i];
+		struct tze_locality_t *loc;
+		struct tze_link_t *link;
+
+		tze_list_foreach_entry(loc, struct tze_locality_t, list,
+							   &root->loc_list) {
+			if (tze_hash_has(&loc_index, loc->name) ||
+				tze_hash_has(&link_index, loc->name)) {
+				continue;
+			}
+
+			if (tze_hash_put(&loc_index, loc->name, loc) < 0) {
+				goto no_memory;
+			}
+		}
+
+		tze_list_foreach_entry(link, struct tze_link_t, list,
+							   &root->link_list) {
+			if (tze_hash_has(&loc_index, link->name) ||
+				tze_hash_has(&link_index, link->name)) {
+				continue;
+			}
+
+			if (tze_hash_put(&link_index, link->name, link) < 0) {
+				goto no_memory;
+			}
+		}
+	}
+
+	locs = malloc(sizeof(*locs) * (loc_index.count + link_index.count + 1));
+	targets = malloc(sizeof(*targets) * (link_index.count + 1));
+	links = malloc(sizeof(*links) * (link_index.count + 1));
+
+	if (locs == NULL || targets == NULL || links == NULL) {
+		goto no_memory;
+	}
+
+	for (size_t i = 0; i < root_count; i++) {
+		struct tze_root_t *root = &roots[i];
+		struct tze_locality_t *loc, *loc_next;
+		struct tze_link_t *link;
+
+		for (loc = tze_list_entry(root->loc_list.next,
+								  struct tze_locality_t, list);
+			 &loc->list != &root->loc_list; loc = loc_next) {
+			loc_next = tze_list_entry(loc->list.next,
+									  struct tze_locality_t, list);
+
+			if (tze_hash_get(&loc_index, loc->name) == loc) {
+				tze_list_del(&loc->list);
+				locs[loc_count++] = loc;
+			}
+		}
+
+		tze_list_foreach_entry(link, struct tze_link_t, list,
+							   &root->link_list) {
+			if (tze_hash_get(&link_index, link->name) == link) {
+				links[link_count++] = link;
+			}
+		}
+	}
+
+	qsort(links, link_count, sizeof(*links), tze_qsort_link_compar);
+
+	for (size_t i = 0; i < link_count; i++) {
+		struct tze_link_t *link = links[i];
+		const char *target = NULL;
+
+		targets[i] = tze_link_resolve(&loc_index, &link_index, &memo,
+									  link, &target);
+
+		if (targets[i] != NULL) {
+			continue;
+		}
+
+		if (target == NULL) {
+			tze_err_set(err, ELOOP, "%s: unable to resolve a link target",
+						link->name);
+			goto free_index;
+		}
+
+		if (tze_filter_path(filter, target)) {
+			tze_err_set(err, 0,
+						"%s: no \"%s\" target found in a timezone list",
+						link->name, target);
+			goto free_index;
+		}
+
+		if (tze_hash_has(&promoted, target)) {
+			/* grouped under the first link to the same target */
+			continue;
+		}
+
+		if (link->rule == NULL) {
+			const int n = tze_link_rule(roots, root_count,
+										link, target, err);
+
+			if (n < 0) {
+				goto free_index;
+			}
+
+			if (n > 0) {
+				/* unknown file format, skip a link */
+				continue;
+			}
+		}
+
+		struct tze_locality_t *loc = tze_locality_alloc(link->name,
+														link->rule);
+
+		if (loc == NULL) {
+			tze_err_set(err, errno,
+						"%s: unable to allocate a locality", link->name);
+			goto free_index;
+		}
+
+		locs[loc_count++] = loc;
+
+		if (tze_hash_put(&promoted, target, loc) < 0) {
+			goto no_memory;
+		}
+
+		targets[i] = loc;
+	}
+
+	qsort(locs, loc_count, sizeof(*locs), tze_qsort_loc_compar);
+
+	for (size_t i = 0; i < loc_count; i++) {
+		tze_list_add_tail(loc_list, &locs[i]->list);
+	}
+
+	loc_count = 0;
+
+	for (size_t i = 0; i < link_count; i++) {
+		const struct tze_link_t *link = links[i];
+		struct tze_locality_t *target_loc = targets[i];
+
+		if (target_loc == NULL) {
+			const char *target = NULL;
+
+			tze_link_resolve(&loc_index, &link_index, &memo, link, &target);
+			target_loc = tze_hash_get(&promoted, target);
+
+			if (target_loc == NULL) {
+				/* a target of an unknown file format */
+				continue;
+			}
+		} else if (strcmp(target_loc->name, link->name) == 0) {
+			/* a promoted link itself */
+			continue;
+		}
+
+		if (tze_locality_add_link(target_loc, sep, link->name) != 0) {
+			tze_err_set(err, errno,
+						"%s: unable to add a link for \"%s\" target",
+						link->name, target_loc->name);
+			goto free_index;
+		}
+	}
+
+	ret = 0;
+	goto free_index;
+
+no_memory:
+	tze_err_set(err, ENOMEM, "unable to merge root directories");
+
+free_index:
+	for (size_t i = 0; i < loc_count; i++) {
+		/* not yet moved to the locality list */
+		tze_locality_free(locs[i]);
+	}
+
+	free(locs);
+	free(targets);
+	free(links);
+	tze_hash_free(&loc_index);
+	tze_hash_free(&link_index);
+	tze_hash_free(&promoted);
+	tze_hash_free(&memo);
+
+	return ret;
+}
@@ -0,0 +1,116 @@
+#ifndef TZE_SCAN_H
+#define TZE_SCAN_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "tze_err.h"
+#include "tze_list.h"
+#include "tze_inode.h"
+#include "tze_filter.h"
+
+enum tze_dup_t {
+	TZE_DUP_PARSE,						/* parse every node found		 */
+	TZE_DUP_LINK,						/* emit duplicates as links		 */
+	TZE_DUP_SKIP						/* do not emit duplicates		 */
+};
+
+#define TZE_SCAN_DEF_READAHEAD			(8)
+#define TZE_SCAN_READAHEAD_MAX			(1024)
+#define TZE_SCAN_DEF_JOBS				(1)
+#define TZE_SCAN_JOBS_MAX				(64)
+
+#define TZE_SCAN_CONF_INIT(sep_)				\
+	{											\
+		.sep		= (sep_),					\
+		.dup		= TZE_DUP_PARSE,			\
+		.canon		= false,					\
+		.readahead	= TZE_SCAN_DEF_READAHEAD,	\
+		.jobs		= TZE_SCAN_DEF_JOBS,		\
+		.stream		= NULL,						\
+		.filter		= TZE_FILTER_INIT			\
+	}
+
+struct tze_scan_conf_t {
+	char				sep;
+	enum tze_dup_t		dup;
+	bool				canon;			/* canonical rules, see			 */
+										/* tze_rule_format()			 */
+	size_t				readahead;		/* files prefetched ahead of	 */
+										/* a parsed one, 0 disables		 */
+	size_t				jobs;			/* traversal threads of a root	 */
+	FILE			   *stream;			/* records printed in place		 */
+										/* of lists, see tze_stream.h	 */
+	struct tze_filter_t	filter;
+};
+
+struct tze_scan_worker_t;
+
+struct tze_root_t {
+	const char					 *dir;
+	char						 *real_dir;
+	const struct tze_scan_conf_t *conf;
+	struct tze_list_t			  loc_list;
+	struct tze_list_t			  link_list;
+	struct tze_list_t			  alias_list;	/* duplicate directories */
+	struct tze_list_t			  skip_list;	/* files left out		 */
+	struct tze_inode_map_t		  inodes;
+	struct tze_err_t			  err;
+	int							  ret;
+	pthread_t					  thread;
+	struct tze_scan_worker_t	 *worker;	/* of a parallel traversal	 */
+};
+
+void tze_root_init(struct tze_root_t			*root,
+				   const char					*const dir,
+				   const struct tze_scan_conf_t *conf);
+
+void tze_root_free(struct tze_root_t *root);
+
+/**
+ * Checks a rule of a locality and adds the locality to a root,
+ * or a link to a target when the target is not NULL. A link rule may
+ * be NULL to be read at a merge. With a stream configured a record
+ * is printed and nothing is added.
+ **/
+
+int tze_root_add(struct tze_root_t *root,
+				 const char		   *const locality,
+				 const char		   *const target,
+				 const char		   *const rule,
+				 const bool			v3,
+				 struct tze_err_t  *err);
+
+/**
+ * Scans every root directory with its own thread. A root which is
+ * a regular file is read as zic(8) source text, see tze_zi.h.
+ *
+ * With more than one job a root is traversed by a pool of threads
+ * stealing pending directories from each other, every thread keeps
+ * at most one directory open. Results are merged in a sorted order
+ * as usual, so an output does not depend on a job count. Duplicate
+ * policies other than parsing rely on a traversal order, such roots
+ * are traversed by a single thread.
+ **/
+
+int tze_roots_scan(struct tze_root_t *roots,
+				   const size_t		  root_count,
+				   struct tze_err_t	 *err);
+
+/**
+ * Merges the per-root lists into a single sorted locality list.
+ * An entry of a later root overrides any entry with the same name
+ * from earlier roots, links are resolved across the merged namespace.
+ * A link to a filtered out target becomes a locality itself with a rule
+ * read from the latest root which has the target, all other links to
+ * the same target are grouped under it.
+ **/
+
+int tze_roots_merge(struct tze_root_t			 *roots,
+					const size_t				  root_count,
+					const struct tze_scan_conf_t *conf,
+					struct tze_list_t			 *loc_list,
+					struct tze_err_t			 *err);
+
+#endif /* TZE_SCAN_H */
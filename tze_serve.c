@@ -0,0 +1,414 @@
+#include <poll.h>
+#include <errno.h>
+#include <stdio.h>
+#include <signal.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "tze_err.h"
+#include "tze_index.h"
+#include "tze_serve.h"
+#include "tze_locality.h"
+
+static volatile sig_atomic_t tze_serve_stopped = 0;
+
+static void tze_serve_stop(int signo)
+{
+	(void) signo;
+	tze_serve_stopped = 1;
+}
+
+static int tze_serve_address(const char		 *const socket_name,
+							 struct sockaddr_un *addr,
+							 struct tze_err_t	*err)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+
+	if (strlen(socket_name) >= sizeof(addr->sun_path)) {
+		tze_err_set(err, ENAMETOOLONG, "%s: invalid socket name",
+					socket_name);
+		return -1;
+	}
+
+	strcpy(addr->sun_path, socket_name);
+
+	return 0;
+}
+
+/**
+ * Removes a stale socket left by a previous instance. Anything else
+ * at a socket path is kept, and so is a socket a server still accepts
+ * connections on.
+ **/
+
+static int tze_serve_clear(const char				*const socket_name,
+						   const struct sockaddr_un *addr,
+						   struct tze_err_t			*err)
+{
+	struct stat st;
+
+	if (lstat(socket_name, &st) < 0) {
+		if (errno == ENOENT) {
+			return 0;
+		}
+
+		tze_err_set(err, errno, "%s: unable to stat", socket_name);
+		return -1;
+	}
+
+	if (!S_ISSOCK(st.st_mode)) {
+		tze_err_set(err, EEXIST, "%s: not a socket, not replaced",
+					socket_name);
+		return -1;
+	}
+
+	const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+	if (fd < 0) {
+		tze_err_set(err, errno, "unable to create a socket");
+		return -1;
+	}
+
+	const int ret = connect(fd, (const struct sockaddr *) addr,
+							sizeof(*addr));
+	const int code = errno;
+
+	close(fd);
+
+	if (ret == 0) {
+		tze_err_set(err, EADDRINUSE, "%s: a server is already running",
+					socket_name);
+		return -1;
+	}
+
+	if (code != ECONNREFUSED) {
+		tze_err_set(err, code, "%s: unable to check a socket", socket_name);
+		return -1;
+	}
+
+	if (unlink(socket_name) < 0 && errno != ENOENT) {
+		tze_err_set(err, errno, "%s: unable to remove a stale socket",
+					socket_name);
+		return -1;
+	}
+
+	return 0;
+}
+
+struct tze_serve_buf_t {
+	char	   *p;
+	const char *end;
+	bool		partial;
+};
+
+static void tze_serve_complete(const char	*const name,
+							   const size_t	 size,
+							   void			*arg)
+{
+	struct tze_serve_buf_t *buf = arg;
+
+	if (size + 1 > (size_t) (buf->end - buf->p)) {
+		buf->partial = true;
+		return;
+	}
+
+	memcpy(buf->p, name, size);
+	buf->p += size;
+	*buf->p++ = '\n';
+}
+
+static size_t tze_serve_reply(const struct tze_index_t *index,
+							  const char				sep,
+							  const char			   *const req,
+							  const size_t				req_size,
+							  char					   *reply)
+{
+	const char op = (req_size > 0) ? req[0] : '\0';
+	const char *const name = req + 1;
+	char *p = reply + 1;
+	const char *const end = reply + TZE_SERVE_MSG_MAX;
+
+	reply[0] = TZE_SERVE_OK;
+
+	switch (op) {
+	case TZE_SERVE_OP_RECORD:
+	case TZE_SERVE_OP_CANONICAL: {
+		const struct tze_locality_t *loc = tze_index_find(index, name);
+
+		if (loc == NULL) {
+			reply[0] = TZE_SERVE_NOT_FOUND;
+			break;
+		}
+
+		const int n = (op == TZE_SERVE_OP_RECORD) ?
+			tze_locality_format(loc, sep, p, (size_t) (end - p)) :
+			snprintf(p, (size_t) (end - p), "%s", loc->name);
+
+		if (n < 0 || (size_t) n + 1 >= (size_t) (end - p)) {
+			reply[0] = TZE_SERVE_PARTIAL;
+			return (size_t) (end - reply);
+		}
+
+		p += n;
+		*p++ = '\n';
+		break;
+	}
+
+	case TZE_SERVE_OP_PREFIX: {
+		size_t count = 0;
+		const size_t first = tze_index_prefix(index, name, &count);
+
+		for (size_t i = first; i < first + count; i++) {
+			const char *const entry = index->entries[i].name;
+			const size_t size = strlen(entry);
+
+			if (size + 1 > (size_t) (end - p)) {
+				reply[0] = TZE_SERVE_PARTIAL;
+				break;
+			}
+
+			memcpy(p, entry, size);
+			p += size;
+			*p++ = '\n';
+		}
+
+		if (count == 0) {
+			reply[0] = TZE_SERVE_NOT_FOUND;
+		}
+
+		break;
+	}
+
+	case TZE_SERVE_OP_COMPLETE: {
+		struct tze_serve_buf_t buf = {
+			.p			= p,
+			.end		= end,
+			.partial	= false
+		};
+
+		if (tze_trie_complete(&index->trie, index, name,
+							  tze_serve_complete, &buf) == 0) {
+			reply[0] = TZE_SERVE_NOT_FOUND;
+		} else if (buf.partial) {
+			reply[0] = TZE_SERVE_PARTIAL;
+		}
+
+		p = buf.p;
+		break;
+	}
+
+	default:
+		reply[0] = TZE_SERVE_BAD_REQUEST;
+		break;
+	}
+
+	return (size_t) (p - reply);
+}
+
+int tze_serve(const char			   *const socket_name,
+			  const struct tze_index_t *index,
+			  const char				sep,
+			  struct tze_err_t		   *err)
+{
+	/* a single serving thread, buffers are reused by every request */
+	static char req[TZE_SERVE_MSG_MAX + 1];
+	static char reply[TZE_SERVE_MSG_MAX];
+	struct pollfd fds[TZE_SERVE_CLIENT_MAX + 1];
+	nfds_t nfds = 0;
+	struct sockaddr_un addr;
+	struct stat bound;
+	int ret = -1;
+
+	if (tze_serve_address(socket_name, &addr, err) < 0 ||
+		tze_serve_clear(socket_name, &addr, err) < 0) {
+		return -1;
+	}
+
+	const int listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+	if (listen_fd < 0) {
+		tze_err_set(err, errno, "unable to create a socket");
+		return -1;
+	}
+
+	if (bind(listen_fd, (const struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		tze_err_set(err, errno, "%s: unable to bind a socket", socket_name);
+		close(listen_fd);
+		return -1;
+	}
+
+	/* a socket removed on exit should still be the bound one */
+	if (lstat(socket_name, &bound) < 0) {
+		tze_err_set(err, errno, "%s: unable to stat", socket_name);
+		close(listen_fd);
+		unlink(socket_name);
+		return -1;
+	}
+
+	if (listen(listen_fd, TZE_SERVE_CLIENT_MAX) < 0) {
+		tze_err_set(err, errno, "%s: unable to listen", socket_name);
+		goto close_sockets;
+	}
+
+	struct sigaction sa;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = tze_serve_stop;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	sa.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &sa, NULL);
+
+	fds[nfds].fd = listen_fd;
+	fds[nfds].events = POLLIN;
+	nfds++;
+
+	while (!tze_serve_stopped) {
+		if (poll(fds, nfds, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			tze_err_set(err, errno, "%s: unable to poll", socket_name);
+			goto close_sockets;
+		}
+
+		for (nfds_t i = 1; i < nfds; i++) {
+			if (fds[i].revents == 0) {
+				continue;
+			}
+
+			const ssize_t n = (fds[i].revents & POLLIN) ?
+				recv(fds[i].fd, req, TZE_SERVE_MSG_MAX, MSG_DONTWAIT) : 0;
+			ssize_t sent = -1;
+
+			if (n > 0) {
+				req[n] = '\0';
+
+				const size_t size = tze_serve_reply(index, sep, req,
+													(size_t) n, reply);
+
+				/* a client not reading its replies would stall others */
+				sent = send(fds[i].fd, reply, size,
+							MSG_NOSIGNAL | MSG_DONTWAIT);
+			}
+
+			if (sent < 0) {
+				/* a client disconnected or is too slow */
+				close(fds[i].fd);
+				fds[i--] = fds[--nfds];
+			}
+		}
+
+		if (fds[0].revents & POLLIN) {
+			const int fd = accept(listen_fd, NULL, NULL);
+
+			if (fd >= 0) {
+				if (nfds > TZE_SERVE_CLIENT_MAX) {
+					close(fd);
+				} else {
+					fds[nfds].fd = fd;
+					fds[nfds].events = POLLIN;
+					fds[nfds].revents = 0;
+					nfds++;
+				}
+			}
+		}
+	}
+
+	ret = 0;
+
+close_sockets:
+	for (nfds_t i = 1; i < nfds; i++) {
+		close(fds[i].fd);
+	}
+
+	close(listen_fd);
+
+	struct stat st;
+
+	if (lstat(socket_name, &st) == 0 &&
+		st.st_dev == bound.st_dev && st.st_ino == bound.st_ino) {
+		unlink(socket_name);
+	}
+
+	return ret;
+}
+
+int tze_serve_query(const char		 *const socket_name,
+					const char		  op,
+					const char		 *const name,
+					FILE			 *out,
+					struct tze_err_t *err)
+{
+	static char req[TZE_SERVE_MSG_MAX];
+	static char reply[TZE_SERVE_MSG_MAX];
+	struct sockaddr_un addr;
+	const size_t name_size = strlen(name);
+	int ret = -1;
+
+	if (name_size + 1 > sizeof(req)) {
+		tze_err_set(err, 0, "a query name is too long");
+		return -1;
+	}
+
+	if (tze_serve_address(socket_name, &addr, err) < 0) {
+		return -1;
+	}
+
+	const int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+
+	if (fd < 0) {
+		tze_err_set(err, errno, "unable to create a socket");
+		return -1;
+	}
+
+	if (connect(fd, (const struct sockaddr *) &addr, sizeof(addr)) < 0) {
+		tze_err_set(err, errno, "%s: unable to connect", socket_name);
+		goto close_fd;
+	}
+
+	req[0] = op;
+	memcpy(req + 1, name, name_size);
+
+	if (send(fd, req, name_size + 1, MSG_NOSIGNAL) < 0) {
+		tze_err_set(err, errno, "%s: unable to send a query", socket_name);
+		goto close_fd;
+	}
+
+	const ssize_t n = recv(fd, reply, sizeof(reply), 0);
+
+	if (n <= 0) {
+		tze_err_set(err, (n < 0) ? errno : ECONNRESET,
+					"%s: unable to receive a reply", socket_name);
+		goto close_fd;
+	}
+
+	switch (reply[0]) {
+	case TZE_SERVE_OK:
+	case TZE_SERVE_PARTIAL:
+		fwrite(reply + 1, 1, (size_t) n - 1, out);
+		ret = 0;
+		break;
+
+	case TZE_SERVE_NOT_FOUND:
+		tze_err_set(err, 0, "%s: not found", name);
+		ret = 1;
+		break;
+
+	default:
+		tze_err_set(err, 0, "%s: a query is rejected", name);
+		break;
+	}
+
+close_fd:
+	close(fd);
+	return ret;
+}
@@ -0,0 +1,53 @@
+#ifndef TZE_SERVE_H
+#define TZE_SERVE_H
+
+#include <stdio.h>
+
+/**
+ * A request is a single SOCK_SEQPACKET message of an operation code
+ * followed by a name, a reply is a single message of a status code
+ * followed by newline terminated lines:
+ *
+ *   R{name}	a table line of a locality or of a link target
+ *   C{name}	a canonical locality name of a link or a locality
+ *   P{prefix}	all locality and link names starting with a prefix
+ *   N{prefix}	distinct completions of a prefix up to a next "/"
+ **/
+
+#define TZE_SERVE_MSG_MAX				(64 * 1024)
+#define TZE_SERVE_CLIENT_MAX			(64)
+
+#define TZE_SERVE_OP_RECORD				'R'
+#define TZE_SERVE_OP_CANONICAL			'C'
+#define TZE_SERVE_OP_PREFIX				'P'
+#define TZE_SERVE_OP_COMPLETE			'N'
+
+#define TZE_SERVE_OK					'+'
+#define TZE_SERVE_PARTIAL				'*'	/* a truncated prefix list	 */
+#define TZE_SERVE_NOT_FOUND				'-'
+#define TZE_SERVE_BAD_REQUEST			'!'
+
+struct tze_err_t;
+struct tze_index_t;
+
+/**
+ * Serves an index until SIGINT or SIGTERM received.
+ **/
+
+int tze_serve(const char			   *const socket_name,
+			  const struct tze_index_t *index,
+			  const char				sep,
+			  struct tze_err_t		   *err);
+
+/**
+ * Sends a single request and writes a reply body to an output stream.
+ * Returns 1 when nothing found.
+ **/
+
+int tze_serve_query(const char		 *const socket_name,
+					const char		  op,
+					const char		 *const name,
+					FILE			 *out,
+					struct tze_err_t *err);
+
+#endif /* TZE_SERVE_H */
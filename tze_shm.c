@@ -0,0 +1,556 @@
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "tze_err.h"
+#include "tze_shm.h"
+#include "tze_hash.h"
+#include "tze_index.h"
+#include "tze_locality.h"
+
+#define TZE_SHM_ALIGN					(64)
+#define TZE_SHM_MODE					(0644)
+#define TZE_SHM_FLIP_WAIT_MS			(1000)	/* an odd sequence bound */
+
+static size_t tze_shm_align(const size_t size)
+{
+	return (size + TZE_SHM_ALIGN - 1) & ~((size_t) TZE_SHM_ALIGN - 1);
+}
+
+/**
+ * Lays out a generation: a generation header, hash buckets, sorted
+ * entries and strings. Localities are formatted once, links refer
+ * to a table line of their locality.
+ **/
+
+static void *tze_shm_gen_build(const struct tze_index_t *index,
+							   const char				 sep,
+							   size_t					*gen_size)
+{
+	size_t bucket_count = 1;
+	size_t strings_size = 0;
+
+	while (bucket_count < index->count * 2) {
+		bucket_count *= 2;
+	}
+
+	for (size_t i = 0; i < index->count; i++) {
+		const struct tze_index_entry_t *e = &index->entries[i];
+
+		strings_size += strlen(e->name) + 1;
+
+		if (e->name == e->loc->name) {
+			const int n = tze_locality_format(e->loc, sep, NULL, 0);
+
+			if (n < 0) {
+				return NULL;
+			}
+
+			strings_size += (size_t) n + 1;
+		}
+	}
+
+	struct tze_shm_gen_t gen = {
+		.count			= (uint32_t) index->count,
+		.bucket_count	= (uint32_t) bucket_count,
+		.buckets_offs	= (uint32_t) tze_shm_align(sizeof(gen))
+	};
+	const size_t entries_offs = gen.buckets_offs +
+		tze_shm_align(sizeof(uint32_t) * bucket_count);
+	const size_t strings_offs = entries_offs +
+		tze_shm_align(sizeof(struct tze_shm_entry_t) * index->count);
+	const size_t size = strings_offs + strings_size;
+
+	if (size > UINT32_MAX) {
+		errno = EFBIG;
+		return NULL;
+	}
+
+	gen.entries_offs = (uint32_t) entries_offs;
+	gen.strings_offs = (uint32_t) strings_offs;
+	gen.strings_size = (uint32_t) strings_size;
+
+	uint8_t *data = calloc(1, size);
+	struct tze_hash_t lines = TZE_HASH_INIT;
+
+	if (data == NULL) {
+		return NULL;
+	}
+
+	memcpy(data, &gen, sizeof(gen));
+
+	uint32_t *buckets = (uint32_t *) (data + gen.buckets_offs);
+	struct tze_shm_entry_t *entries =
+		(struct tze_shm_entry_t *) (data + gen.entries_offs);
+	char *const strings = (char *) (data + gen.strings_offs);
+	size_t p = 0;
+
+	/* table lines first, link entries refer to them by an offset */
+	for (size_t i = 0; i < index->count; i++) {
+		const struct tze_index_entry_t *e = &index->entries[i];
+
+		if (e->name != e->loc->name) {
+			continue;
+		}
+
+		const int n = tze_locality_format(e->loc, sep, strings + p,
+										  strings_size - p);
+
+		if (tze_hash_put(&lines, e->name, (void *) (p + 1)) < 0) {
+			goto no_memory;
+		}
+
+		p += (size_t) n + 1;
+	}
+
+	for (size_t i = 0; i < index->count; i++) {
+		const struct tze_index_entry_t *e = &index->entries[i];
+		struct tze_shm_entry_t *entry = &entries[i];
+		const size_t name_size = strlen(e->name);
+		const size_t line_offs =
+			(size_t) tze_hash_get(&lines, e->loc->name) - 1;
+
+		entry->name_offs = (uint32_t) p;
+		entry->hash = tze_hash_str(e->name);
+		entry->line_offs = (uint32_t) line_offs;
+		entry->line_size = (uint32_t) strlen(strings + line_offs);
+		memcpy(strings + p, e->name, name_size + 1);
+		p += name_size + 1;
+
+		size_t j = entry->hash & (bucket_count - 1);
+
+		while (buckets[j] != 0) {
+			j = (j + 1) & (bucket_count - 1);
+		}
+
+		buckets[j] = (uint32_t) i + 1;
+	}
+
+	tze_hash_free(&lines);
+	*gen_size = size;
+
+	return data;
+
+no_memory:
+	tze_hash_free(&lines);
+	free(data);
+	errno = ENOMEM;
+	return NULL;
+}
+
+static int tze_shm_check(const struct tze_shm_header_t *hdr,
+						 const char					   *const shm_name,
+						 struct tze_err_t			   *err)
+{
+	if (hdr->magic != TZE_SHM_MAGIC) {
+		tze_err_set(err, EINVAL, "%s: not a locality table segment",
+					shm_name);
+		return -1;
+	}
+
+	if (hdr->layout != TZE_SHM_LAYOUT) {
+		tze_err_set(err, EPROTO, "%s: unsupported segment layout %u",
+					shm_name, hdr->layout);
+		return -1;
+	}
+
+	return 0;
+}
+
+int tze_shm_publish(const char				 *const shm_name,
+					const struct tze_index_t *index,
+					const char				  sep,
+					struct tze_err_t		 *err)
+{
+	int ret = -1;
+	size_t gen_size = 0;
+	size_t segment_size = 0;
+	void *base = MAP_FAILED;
+	void *gen = tze_shm_gen_build(index, sep, &gen_size);
+
+	if (gen == NULL) {
+		tze_err_set(err, errno, "unable to lay out a table generation");
+		return -1;
+	}
+
+	const int fd = shm_open(shm_name, O_RDWR | O_CREAT | O_CLOEXEC,
+							TZE_SHM_MODE);
+
+	if (fd < 0) {
+		tze_err_set(err, errno, "%s: unable to open a segment", shm_name);
+		goto out;
+	}
+
+	/* publishers are serialized, readers never take the lock */
+	if (flock(fd, LOCK_EX) < 0) {
+		tze_err_set(err, errno, "%s: unable to lock a segment", shm_name);
+		goto out;
+	}
+
+	struct stat st;
+
+	if (fstat(fd, &st) < 0) {
+		tze_err_set(err, errno, "%s: unable to stat a segment", shm_name);
+		goto out;
+	}
+
+	const size_t header_size = tze_shm_align(sizeof(struct tze_shm_header_t));
+	const bool created = ((size_t) st.st_size < header_size);
+	uint64_t cur_offs = 0;
+	uint64_t cur_size = 0;
+
+	segment_size = created ? header_size : (size_t) st.st_size;
+
+	if (created) {
+		if (ftruncate(fd, (off_t) header_size) < 0) {
+			tze_err_set(err, errno, "%s: unable to size a segment",
+						shm_name);
+			goto out;
+		}
+	} else {
+		const struct tze_shm_header_t *hdr =
+			mmap(NULL, header_size, PROT_READ, MAP_SHARED, fd, 0);
+
+		if (hdr == MAP_FAILED) {
+			tze_err_set(err, errno, "%s: unable to map a segment",
+						shm_name);
+			goto out;
+		}
+
+		const int checked = tze_shm_check(hdr, shm_name, err);
+
+		cur_offs = hdr->gen_offs;
+		cur_size = hdr->gen_size;
+		munmap((void *) hdr, header_size);
+
+		if (checked < 0) {
+			goto out;
+		}
+	}
+
+	/*
+	 * A new generation goes in front of the current one when it fits,
+	 * otherwise right after it, the current one stays intact
+	 * for readers still looking it up.
+	 */
+	size_t gen_offs = header_size;
+
+	if (cur_size != 0 && gen_offs + gen_size > cur_offs) {
+		gen_offs = tze_shm_align((size_t) (cur_offs + cur_size));
+	}
+
+	if (gen_offs + gen_size > segment_size) {
+		segment_size = gen_offs + gen_size;
+
+		if (ftruncate(fd, (off_t) segment_size) < 0) {
+			tze_err_set(err, errno, "%s: unable to size a segment",
+						shm_name);
+			goto out;
+		}
+	}
+
+	base = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+				fd, 0);
+
+	if (base == MAP_FAILED) {
+		tze_err_set(err, errno, "%s: unable to map a segment", shm_name);
+		goto out;
+	}
+
+	struct tze_shm_header_t *hdr = base;
+
+	memcpy((uint8_t *) base + gen_offs, gen, gen_size);
+
+	if (created) {
+		hdr->magic = TZE_SHM_MAGIC;
+		hdr->layout = TZE_SHM_LAYOUT;
+	}
+
+	/**
+	 * Flip a generation under a sequence lock. An odd sequence is left
+	 * by a publisher which died while flipping, a segment lock is held,
+	 * so the flip is restarted from the next even sequence.
+	 **/
+	const uint32_t seq =
+		(__atomic_load_n(&hdr->seq, __ATOMIC_RELAXED) + 1) & ~1u;
+
+	__atomic_store_n(&hdr->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&hdr->gen_offs, (uint64_t) gen_offs, __ATOMIC_RELAXED);
+	__atomic_store_n(&hdr->gen_size, (uint64_t) gen_size, __ATOMIC_RELAXED);
+	__atomic_store_n(&hdr->segment_size, (uint64_t) segment_size,
+					 __ATOMIC_RELAXED);
+	__atomic_store_n(&hdr->generation, hdr->generation + 1,
+					 __ATOMIC_RELAXED);
+	__atomic_store_n(&hdr->seq, seq + 2, __ATOMIC_RELEASE);
+
+	ret = 0;
+
+out:
+	if (base != MAP_FAILED) {
+		munmap(base, segment_size);
+	}
+
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	free(gen);
+
+	return ret;
+}
+
+static int tze_shm_map(struct tze_shm_reader_t *reader)
+{
+	struct stat st;
+
+	if (fstat(reader->fd, &st) < 0) {
+		return -1;
+	}
+
+	if ((size_t) st.st_size < sizeof(struct tze_shm_header_t)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	void *base = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED,
+					  reader->fd, 0);
+
+	if (base == MAP_FAILED) {
+		return -1;
+	}
+
+	if (reader->base != NULL) {
+		munmap(reader->base, reader->size);
+	}
+
+	reader->base = base;
+	reader->size = (size_t) st.st_size;
+
+	return 0;
+}
+
+int tze_shm_open(struct tze_shm_reader_t *reader,
+				 const char				 *const shm_name,
+				 struct tze_err_t		 *err)
+{
+	reader->base = NULL;
+	reader->size = 0;
+	reader->fd = shm_open(shm_name, O_RDONLY | O_CLOEXEC, 0);
+
+	if (reader->fd < 0) {
+		tze_err_set(err, errno, "%s: unable to open a segment", shm_name);
+		return -1;
+	}
+
+	if (tze_shm_map(reader) < 0) {
+		tze_err_set(err, errno, "%s: unable to map a segment", shm_name);
+		goto fail;
+	}
+
+	if (tze_shm_check(reader->base, shm_name, err) < 0) {
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	tze_shm_close(reader);
+	return -1;
+}
+
+/**
+ * Looks a name up in a generation which may be overwritten meanwhile,
+ * so every offset is checked before use. Returns -1 when a generation
+ * looks malformed.
+ **/
+
+static long tze_shm_gen_find(const uint8_t	*gen,
+							 const size_t	 gen_size,
+							 const char		*const name,
+							 const uint32_t	 hash,
+							 char			*line,
+							 const size_t	 line_size)
+{
+	struct tze_shm_gen_t g;
+
+	if (gen_size < sizeof(g)) {
+		return -1;
+	}
+
+	memcpy(&g, gen, sizeof(g));
+
+	if (g.bucket_count == 0 || (g.bucket_count & (g.bucket_count - 1)) ||
+		g.buckets_offs % sizeof(uint32_t) != 0 ||
+		g.entries_offs % sizeof(uint32_t) != 0 ||
+		g.buckets_offs > gen_size ||
+		(gen_size - g.buckets_offs) / sizeof(uint32_t) < g.bucket_count ||
+		g.entries_offs > gen_size ||
+		(gen_size - g.entries_offs) / sizeof(struct tze_shm_entry_t) <
+		g.count ||
+		g.strings_offs > gen_size ||
+		gen_size - g.strings_offs < g.strings_size) {
+		return -1;
+	}
+
+	const uint32_t *buckets = (const uint32_t *) (gen + g.buckets_offs);
+	const struct tze_shm_entry_t *entries =
+		(const struct tze_shm_entry_t *) (gen + g.entries_offs);
+	const char *const strings = (const char *) (gen + g.strings_offs);
+	const uint32_t mask = g.bucket_count - 1;
+	uint32_t i = hash & mask;
+
+	for (uint32_t probe = 0; probe < g.bucket_count; probe++) {
+		const uint32_t b = buckets[i];
+
+		if (b == 0) {
+			return 0;
+		}
+
+		if (b > g.count) {
+			return -1;
+		}
+
+		const struct tze_shm_entry_t *e = &entries[b - 1];
+
+		i = (i + 1) & mask;
+
+		if (e->hash != hash) {
+			continue;
+		}
+
+		if (e->name_offs >= g.strings_size ||
+			memchr(strings + e->name_offs, '\0',
+				   g.strings_size - e->name_offs) == NULL) {
+			return -1;
+		}
+
+		if (strcmp(strings + e->name_offs, name) != 0) {
+			continue;
+		}
+
+		if (e->line_offs > g.strings_size ||
+			g.strings_size - e->line_offs < e->line_size) {
+			return -1;
+		}
+
+		if (line_size > 0) {
+			const size_t n = (e->line_size < line_size) ?
+				e->line_size : line_size - 1;
+
+			memcpy(line, strings + e->line_offs, n);
+			line[n] = '\0';
+		}
+
+		return (long) e->line_size;
+	}
+
+	return 0;
+}
+
+static int64_t tze_shm_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+long tze_shm_lookup(struct tze_shm_reader_t *reader,
+					const char				*const name,
+					char					*line,
+					const size_t			 line_size,
+					struct tze_err_t		*err)
+{
+	const uint32_t hash = tze_hash_str(name);
+	int64_t deadline = 0;
+
+	while (1) {
+		const struct tze_shm_header_t *hdr = reader->base;
+		const uint32_t seq = __atomic_load_n(&hdr->seq, __ATOMIC_ACQUIRE);
+
+		if (seq & 1) {
+			/* a publisher is in the middle of a flip or died in it */
+			const int64_t now = tze_shm_now_ms();
+
+			if (deadline == 0) {
+				deadline = now + TZE_SHM_FLIP_WAIT_MS;
+			} else if (now > deadline) {
+				tze_err_set(err, 0, "a table generation is left half flipped");
+				return -1;
+			}
+
+			sched_yield();
+			continue;
+		}
+
+		deadline = 0;
+
+		const uint64_t gen_offs =
+			__atomic_load_n(&hdr->gen_offs, __ATOMIC_RELAXED);
+		const uint64_t gen_size =
+			__atomic_load_n(&hdr->gen_size, __ATOMIC_RELAXED);
+		long ret = 0;
+		bool grown = false;
+
+		if (gen_offs > reader->size || reader->size - gen_offs < gen_size) {
+			grown = true;
+		} else if (gen_size != 0) {
+			ret = tze_shm_gen_find((const uint8_t *) reader->base + gen_offs,
+								   (size_t) gen_size, name, hash,
+								   line, line_size);
+		}
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&hdr->seq, __ATOMIC_RELAXED) != seq) {
+			/* a generation flipped under a lookup */
+			continue;
+		}
+
+		if (grown) {
+			/* a segment grew since it was mapped */
+			const size_t mapped_size = reader->size;
+
+			if (tze_shm_map(reader) < 0) {
+				tze_err_set(err, errno, "unable to remap a segment");
+				return -1;
+			}
+
+			if (reader->size > mapped_size) {
+				continue;
+			}
+
+			ret = -1;
+		}
+
+		if (ret < 0) {
+			tze_err_set(err, EBADMSG, "malformed table generation");
+		}
+
+		return ret;
+	}
+}
+
+void tze_shm_close(struct tze_shm_reader_t *reader)
+{
+	if (reader->base != NULL) {
+		munmap(reader->base, reader->size);
+		reader->base = NULL;
+	}
+
+	if (reader->fd >= 0) {
+		close(reader->fd);
+		reader->fd = -1;
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef TZE_SHM_H
+#define TZE_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A locality table published to a POSIX shared memory segment.
+ *
+ * A segment starts with a header guarded by a sequence lock, the header
+ * points to the current table generation. A publisher writes a new
+ * generation to a free area of a segment and flips the header, readers
+ * never block: a lookup is repeated when the header changed under it
+ * and fails when a flip is not finished in a second, as a publisher
+ * died in it. A next publish finishes such a flip.
+ **/
+
+#define TZE_SHM_MAGIC					(0x53455a54u)	/* "TZES"	 */
+#define TZE_SHM_LAYOUT					(1)
+
+struct tze_shm_header_t {
+	uint32_t magic;
+	uint32_t layout;
+	uint32_t seq;						/* odd while flipping			 */
+	uint32_t reserved;
+	uint64_t generation;				/* a publish counter			 */
+	uint64_t gen_offs;					/* current generation placement	 */
+	uint64_t gen_size;
+	uint64_t segment_size;
+};
+
+struct tze_shm_gen_t {
+	uint32_t count;						/* locality and link names		 */
+	uint32_t bucket_count;				/* a power of two				 */
+	uint32_t buckets_offs;				/* uint32_t[], entry index + 1	 */
+	uint32_t entries_offs;				/* sorted tze_shm_entry_t[]		 */
+	uint32_t strings_offs;
+	uint32_t strings_size;
+};
+
+struct tze_shm_entry_t {
+	uint32_t name_offs;
+	uint32_t hash;
+	uint32_t line_offs;					/* a table line of a locality	 */
+	uint32_t line_size;
+};
+
+struct tze_shm_reader_t {
+	int		 fd;
+	void	*base;
+	size_t	 size;
+};
+
+struct tze_err_t;
+struct tze_index_t;
+
+/**
+ * Publishes a new table generation, concurrent publishers are serialized
+ * with an advisory lock of a segment.
+ **/
+
+int tze_shm_publish(const char				 *const shm_name,
+					const struct tze_index_t *index,
+					const char				  sep,
+					struct tze_err_t		 *err);
+
+int tze_shm_open(struct tze_shm_reader_t *reader,
+				 const char				 *const shm_name,
+				 struct tze_err_t		 *err);
+
+/**
+ * Copies a table line of a locality or of a link target.
+ * Returns a line size, 0 when nothing found or -1 on error.
+ **/
+
+long tze_shm_lookup(struct tze_shm_reader_t *reader,
+					const char				*const name,
+					char					*line,
+					const size_t			 line_size,
+					struct tze_err_t		*err);
+
+void tze_shm_close(struct tze_shm_reader_t *reader);
+
+#endif /* TZE_SHM_H */
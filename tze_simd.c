@@ -0,0 +1,184 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "tze_attr.h"
+#include "tze_simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TZE_SIMD_X86					1
+#include <immintrin.h>
+#else
+#define TZE_SIMD_X86					0
+#endif
+
+typedef size_t (*tze_simd_span_fn_t)(const uint8_t *data,
+									 const size_t	 size,
+									 const uint8_t	 lo,
+									 const uint8_t	 hi,
+									 const uint8_t	 stop);
+
+static size_t tze_simd_span_scalar(const uint8_t *data,
+								   const size_t	  size,
+								   const uint8_t  lo,
+								   const uint8_t  hi,
+								   const uint8_t  stop)
+{
+	for (size_t i = 0; i < size; i++) {
+		if (data[i] < lo || data[i] > hi || data[i] == stop) {
+			return i;
+		}
+	}
+
+	return size;
+}
+
+#if TZE_SIMD_X86
+
+/**
+ * A byte is in a range when (byte - lo) <= (hi - lo) unsigned,
+ * i.e. max(byte - lo, hi - lo) == hi - lo.
+ **/
+
+TZE_ATTR_TARGET("sse2")
+static size_t tze_simd_span_sse2(const uint8_t *data,
+								 const size_t	size,
+								 const uint8_t	lo,
+								 const uint8_t	hi,
+								 const uint8_t	stop)
+{
+	const __m128i v_lo = _mm_set1_epi8((char) lo);
+	const __m128i v_range = _mm_set1_epi8((char) (uint8_t) (hi - lo));
+	const __m128i v_stop = _mm_set1_epi8((char) stop);
+	size_t i = 0;
+
+	for (; i + sizeof(__m128i) <= size; i += sizeof(__m128i)) {
+		const __m128i v = _mm_loadu_si128((const __m128i *) (data + i));
+		const __m128i t = _mm_sub_epi8(v, v_lo);
+		const __m128i in = _mm_cmpeq_epi8(_mm_max_epu8(t, v_range), v_range);
+		const __m128i ok = _mm_andnot_si128(_mm_cmpeq_epi8(v, v_stop), in);
+		const unsigned bad = (unsigned) _mm_movemask_epi8(ok) ^ 0xffffu;
+
+		if (bad != 0) {
+			return i + (size_t) __builtin_ctz(bad);
+		}
+	}
+
+	return i + tze_simd_span_scalar(data + i, size - i, lo, hi, stop);
+}
+
+TZE_ATTR_TARGET("avx2")
+static size_t tze_simd_span_avx2(const uint8_t *data,
+								 const size_t	size,
+								 const uint8_t	lo,
+								 const uint8_t	hi,
+								 const uint8_t	stop)
+{
+	const __m256i v_lo = _mm256_set1_epi8((char) lo);
+	const __m256i v_range = _mm256_set1_epi8((char) (uint8_t) (hi - lo));
+	const __m256i v_stop = _mm256_set1_epi8((char) stop);
+	size_t i = 0;
+
+	for (; i + sizeof(__m256i) <= size; i += sizeof(__m256i)) {
+		const __m256i v = _mm256_loadu_si256((const __m256i *) (data + i));
+		const __m256i t = _mm256_sub_epi8(v, v_lo);
+		const __m256i in = _mm256_cmpeq_epi8(_mm256_max_epu8(t, v_range),
+											 v_range);
+		const __m256i ok = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, v_stop),
+											   in);
+		const unsigned bad = ~(unsigned) _mm256_movemask_epi8(ok);
+
+		if (bad != 0) {
+			return i + (size_t) __builtin_ctz(bad);
+		}
+	}
+
+	/* VEX encoded here, calling legacy SSE code stalls on a transition */
+	if (i + sizeof(__m128i) <= size) {
+		const __m128i v = _mm_loadu_si128((const __m128i *) (data + i));
+		const __m128i t = _mm_sub_epi8(v, _mm256_castsi256_si128(v_lo));
+		const __m128i range = _mm256_castsi256_si128(v_range);
+		const __m128i in = _mm_cmpeq_epi8(_mm_max_epu8(t, range), range);
+		const __m128i ok = _mm_andnot_si128(
+			_mm_cmpeq_epi8(v, _mm256_castsi256_si128(v_stop)), in);
+		const unsigned bad = (unsigned) _mm_movemask_epi8(ok) ^ 0xffffu;
+
+		if (bad != 0) {
+			return i + (size_t) __builtin_ctz(bad);
+		}
+
+		i += sizeof(__m128i);
+	}
+
+	return i + tze_simd_span_scalar(data + i, size - i, lo, hi, stop);
+}
+
+#endif /* TZE_SIMD_X86 */
+
+static pthread_once_t tze_simd_once = PTHREAD_ONCE_INIT;
+static enum tze_simd_level_t tze_simd_supported = TZE_SIMD_SCALAR;
+static enum tze_simd_level_t tze_simd_selected = TZE_SIMD_SCALAR;
+static tze_simd_span_fn_t tze_simd_span_fn = tze_simd_span_scalar;
+
+static void tze_simd_set(const enum tze_simd_level_t level)
+{
+	switch (level) {
+#if TZE_SIMD_X86
+	case TZE_SIMD_AVX2:
+		tze_simd_span_fn = tze_simd_span_avx2;
+		break;
+
+	case TZE_SIMD_SSE2:
+		tze_simd_span_fn = tze_simd_span_sse2;
+		break;
+#else
+	case TZE_SIMD_AVX2:
+	case TZE_SIMD_SSE2:
+#endif
+	case TZE_SIMD_SCALAR:
+		tze_simd_span_fn = tze_simd_span_scalar;
+		break;
+	}
+
+	tze_simd_selected = level;
+}
+
+static void tze_simd_detect(void)
+{
+#if TZE_SIMD_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2")) {
+		tze_simd_supported = TZE_SIMD_AVX2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		tze_simd_supported = TZE_SIMD_SSE2;
+	}
+#endif
+
+	tze_simd_set(tze_simd_supported);
+}
+
+size_t tze_simd_span_vec(const uint8_t *data,
+						 const size_t	size,
+						 const uint8_t	lo,
+						 const uint8_t	hi,
+						 const uint8_t	stop)
+{
+	pthread_once(&tze_simd_once, tze_simd_detect);
+
+	return tze_simd_span_fn(data, size, lo, hi, stop);
+}
+
+enum tze_simd_level_t tze_simd_level(void)
+{
+	pthread_once(&tze_simd_once, tze_simd_detect);
+
+	return tze_simd_selected;
+}
+
+enum tze_simd_level_t tze_simd_select(const enum tze_simd_level_t level)
+{
+	pthread_once(&tze_simd_once, tze_simd_detect);
+	tze_simd_set((level > tze_simd_supported) ? tze_simd_supported : level);
+
+	return tze_simd_selected;
+}
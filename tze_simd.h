@@ -0,0 +1,65 @@
+#ifndef TZE_SIMD_H
+#define TZE_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Byte validation kernels. A span is a length of an initial part of
+ * a buffer with every byte in a [lo, hi] range and not equal to a stop
+ * byte, so a range check and a separator search take a single pass.
+ * A stop byte out of a range disables it, lo should not exceed hi.
+ * Kernels are SSE2 and AVX2 on x86 and scalar elsewhere, the best one
+ * supported by a CPU is selected at a first call.
+ **/
+
+#define TZE_SIMD_MIN					(16)
+
+enum tze_simd_level_t {
+	TZE_SIMD_SCALAR,
+	TZE_SIMD_SSE2,
+	TZE_SIMD_AVX2
+};
+
+size_t tze_simd_span_vec(const uint8_t *data,
+						 const size_t	size,
+						 const uint8_t	lo,
+						 const uint8_t	hi,
+						 const uint8_t	stop);
+
+static inline size_t tze_simd_span(const void	 *const data,
+								   const size_t	  size,
+								   const uint8_t  lo,
+								   const uint8_t  hi,
+								   const uint8_t  stop)
+{
+	const uint8_t *p = data;
+
+	if (size >= TZE_SIMD_MIN) {
+		return tze_simd_span_vec(p, size, lo, hi, stop);
+	}
+
+	/* too short for a kernel */
+	for (size_t i = 0; i < size; i++) {
+		if (p[i] < lo || p[i] > hi || p[i] == stop) {
+			return i;
+		}
+	}
+
+	return size;
+}
+
+/**
+ * Returns a selected kernel level.
+ **/
+
+enum tze_simd_level_t tze_simd_level(void);
+
+/**
+ * Selects a kernel level not above a supported one, e.g. to compare
+ * kernels, and returns a selected level.
+ **/
+
+enum tze_simd_level_t tze_simd_select(const enum tze_simd_level_t level);
+
+#endif /* TZE_SIMD_H */
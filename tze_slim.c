@@ -0,0 +1,146 @@
+#include <errno.h>
+#include <stdio.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "tze_tz.h"
+#include "tze_err.h"
+#include "tze_list.h"
+#include "tze_slim.h"
+#include "tze_locality.h"
+
+/**
+ * Creates missing parent directories of a file name.
+ **/
+
+static int tze_slim_mkdirs(char				*const file_name,
+						   const size_t		 base_size,
+						   struct tze_err_t *err)
+{
+	for (char *p = file_name + base_size + 1; *p != '\0'; p++) {
+		if (*p != '/') {
+			continue;
+		}
+
+		*p = '\0';
+
+		if (mkdir(file_name, 0755) < 0 && errno != EEXIST) {
+			tze_err_set(err, errno, "%s: unable to create a directory",
+						file_name);
+			*p = '/';
+			return -1;
+		}
+
+		*p = '/';
+	}
+
+	return 0;
+}
+
+static int tze_slim_link(const char		  *const out_dir,
+						 const char		  *const target,
+						 const char		  *const name,
+						 const size_t	   name_size,
+						 struct tze_err_t *err)
+{
+	char link_name[PATH_MAX];
+	const size_t base_size = strlen(out_dir);
+	const int n = snprintf(link_name, sizeof(link_name), "%s/%.*s",
+						   out_dir, (int) name_size, name);
+
+	if (n < 0 || n >= (int) sizeof(link_name)) {
+		tze_err_set(err, ENAMETOOLONG, "%.*s: too long file name",
+					(int) name_size, name);
+		return -1;
+	}
+
+	if (tze_slim_mkdirs(link_name, base_size, err) < 0) {
+		return -1;
+	}
+
+	if (unlink(link_name) < 0 && errno != ENOENT) {
+		tze_err_set(err, errno, "%s: unable to replace", link_name);
+		return -1;
+	}
+
+	if (link(target, link_name) < 0) {
+		tze_err_set(err, errno, "%s: unable to link", link_name);
+		return -1;
+	}
+
+	return 0;
+}
+
+int tze_slim_tree(const char *const		   *roots,
+				  const size_t				root_count,
+				  const struct tze_list_t  *loc_list,
+				  const char				sep,
+				  const char			   *const out_dir,
+				  const int64_t				from,
+				  const int64_t				until,
+				  struct tze_err_t		   *err)
+{
+	const struct tze_locality_t *loc;
+	const size_t base_size = strlen(out_dir);
+
+	if (mkdir(out_dir, 0755) < 0 && errno != EEXIST) {
+		tze_err_set(err, errno, "%s: unable to create a directory", out_dir);
+		return -1;
+	}
+
+	tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
+		char file_name[PATH_MAX];
+		char out_name[PATH_MAX];
+
+		if (tze_tz_locate(roots, root_count, loc->name,
+						  file_name, err) < 0) {
+			return -1;
+		}
+
+		const int n = snprintf(out_name, sizeof(out_name), "%s/%s",
+							   out_dir, loc->name);
+
+		if (n < 0 || n >= (int) sizeof(out_name)) {
+			tze_err_set(err, ENAMETOOLONG, "%s: too long file name",
+						loc->name);
+			return -1;
+		}
+
+		if (tze_slim_mkdirs(out_name, base_size, err) < 0) {
+			return -1;
+		}
+
+		/* do not write through an existing hardlink */
+		if (unlink(out_name) < 0 && errno != ENOENT) {
+			tze_err_set(err, errno, "%s: unable to replace", out_name);
+			return -1;
+		}
+
+		const int ret = tze_tz_slim(file_name, out_name, loc->name,
+									from, until, err);
+
+		if (ret != 0) {
+			if (ret > 0) {
+				tze_err_set(err, 0, "%s: not a timezone file", loc->name);
+			}
+
+			return -1;
+		}
+
+		for (const char *link = loc->links; link != NULL && *link != '\0'; ) {
+			const char *const end = strchr(link, sep);
+			const size_t link_size = (end == NULL) ?
+				strlen(link) : (size_t) (end - link);
+
+			if (tze_slim_link(out_dir, out_name, link, link_size, err) < 0) {
+				return -1;
+			}
+
+			link = (end == NULL) ? NULL : end + 1;
+		}
+	}
+
+	return 0;
+}
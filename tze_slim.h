@@ -0,0 +1,28 @@
+#ifndef TZE_SLIM_H
+#define TZE_SLIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Mirrors a locality list into a directory of slim TZif files,
+ * see tze_tz_slim(). Every locality is read from the latest root
+ * having it, its links become hardlinks to the rewritten file.
+ **/
+
+#define TZE_SLIM_DEF_FROM				(2000)
+#define TZE_SLIM_DEF_UNTIL				(2050)
+
+struct tze_err_t;
+struct tze_list_t;
+
+int tze_slim_tree(const char *const		   *roots,
+				  const size_t				root_count,
+				  const struct tze_list_t  *loc_list,
+				  const char				sep,
+				  const char			   *const out_dir,
+				  const int64_t				from,
+				  const int64_t				until,
+				  struct tze_err_t		   *err);
+
+#endif /* TZE_SLIM_H */
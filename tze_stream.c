@@ -0,0 +1,155 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "tze_err.h"
+#include "tze_link.h"
+#include "tze_list.h"
+#include "tze_scan.h"
+#include "tze_filter.h"
+#include "tze_stream.h"
+#include "tze_locality.h"
+
+/**
+ * Adds a record to a root as a scan does, a record line is split
+ * in place.
+ **/
+
+static int tze_stream_add(struct tze_root_t *root,
+						  char				*line,
+						  const size_t		 number,
+						  struct tze_err_t	*err)
+{
+	const char sep = root->conf->sep;
+	char *fields[3];
+	size_t count = 0;
+
+	fields[count++] = line;
+
+	for (char *p = line; *p != '\0'; p++) {
+		if (*p != sep) {
+			continue;
+		}
+
+		if (count == sizeof(fields) / sizeof(fields[0])) {
+			goto malformed;
+		}
+
+		*p = '\0';
+		fields[count++] = p + 1;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (*fields[i] == '\0') {
+			goto malformed;
+		}
+	}
+
+	if (count == 2) {
+		struct tze_locality_t *loc = tze_locality_alloc(fields[0], fields[1]);
+
+		if (loc == NULL) {
+			tze_err_set(err, errno,
+						"%s: unable to allocate a locality", fields[0]);
+			return -1;
+		}
+
+		tze_list_add_tail(&root->loc_list, &loc->list);
+	} else if (count == 3) {
+		struct tze_link_t *link = tze_link_alloc(fields[0], fields[1],
+												 fields[2]);
+
+		if (link == NULL) {
+			tze_err_set(err, errno,
+						"%s: unable to allocate a link for \"%s\" target",
+						fields[0], fields[1]);
+			return -1;
+		}
+
+		tze_list_add_tail(&root->link_list, &link->list);
+	} else {
+		goto malformed;
+	}
+
+	return 0;
+
+malformed:
+	tze_err_set(err, 0, "%s:%zu: malformed record", root->dir, number);
+	return -1;
+}
+
+int tze_stream_regroup(const char		 *const file_name,
+					   const char		  sep,
+					   struct tze_list_t *loc_list,
+					   struct tze_err_t	 *err)
+{
+	int ret = -1;
+	struct tze_scan_conf_t conf = TZE_SCAN_CONF_INIT(sep);
+	struct tze_root_t root;
+	char *line = NULL;
+	size_t capacity = 0;
+	size_t number = 0;
+
+	/**
+	 * A stream has every target which survived a scan filter, so any
+	 * missing target was filtered out: its first link becomes a locality
+	 * as a merge of a scan makes it.
+	 **/
+
+	tze_filter_add(&conf.filter, false, "*");
+	tze_root_init(&root, file_name, &conf);
+
+	const bool is_stdin = (strcmp(file_name, TZE_STREAM_STDIN) == 0);
+	FILE *in = is_stdin ? stdin : fopen(file_name, "r");
+
+	if (in == NULL) {
+		tze_err_set(err, errno, "%s: unable to open", file_name);
+		goto free_root;
+	}
+
+	while (1) {
+		errno = 0;
+
+		ssize_t size = getline(&line, &capacity, in);
+
+		if (size < 0) {
+			if (errno != 0) {
+				tze_err_set(err, errno, "%s: unable to read", file_name);
+				goto close_in;
+			}
+
+			/* end of file */
+			break;
+		}
+
+		number++;
+
+		if (size > 0 && line[size - 1] == '\n') {
+			line[--size] = '\0';
+		}
+
+		if (tze_stream_add(&root, line, number, err) < 0) {
+			goto close_in;
+		}
+	}
+
+	ret = tze_roots_merge(&root, 1, &conf, loc_list, err);
+
+	if (ret >= 0 && tze_list_is_empty(loc_list)) {
+		tze_err_set(err, 0, "%s: no records found", file_name);
+		ret = -1;
+	}
+
+close_in:
+	if (!is_stdin) {
+		fclose(in);
+	}
+
+	free(line);
+
+free_root:
+	tze_root_free(&root);
+
+	return ret;
+}
@@ -0,0 +1,31 @@
+#ifndef TZE_STREAM_H
+#define TZE_STREAM_H
+
+/**
+ * A stream is printed by a scan as files are parsed, in a traversal
+ * order, one record per line:
+ *
+ *   {name}{sep}{rule}					a locality
+ *   {name}{sep}{target}{sep}{rule}		a symlink, a rule is read through it
+ *
+ * Links are not grouped under their targets, so a scan keeps nothing
+ * but a current directory path. A target may be a link itself or
+ * a filtered out name missing from a stream.
+ **/
+
+#define TZE_STREAM_STDIN				"-"
+
+struct tze_err_t;
+struct tze_list_t;
+
+/**
+ * Reads a stream printed earlier, "-" is a standard input, and folds
+ * it into a sorted locality list as a scan merges its roots.
+ **/
+
+int tze_stream_regroup(const char		 *const file_name,
+					   const char		  sep,
+					   struct tze_list_t *loc_list,
+					   struct tze_err_t	 *err);
+
+#endif /* TZE_STREAM_H */
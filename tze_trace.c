@@ -0,0 +1,246 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include "tze_err.h"
+#include "tze_trace.h"
+
+#define TZE_TRACE_MIN_EVENTS			(256)
+
+struct tze_trace_event_t {
+	const char *name;					/* a static string				 */
+	int64_t		begin;					/* ns since a start				 */
+	int64_t		end;
+	char		detail[TZE_TRACE_DETAIL_MAX];
+};
+
+struct tze_trace_buf_t {
+	struct tze_trace_event_t *events;
+	size_t					  count;
+	size_t					  capacity;
+	unsigned				  tid;		/* in a start order				 */
+	struct tze_trace_buf_t	 *next;
+};
+
+bool tze_trace_enabled = false;
+
+static int64_t tze_trace_epoch;
+static pthread_key_t tze_trace_key;
+static pthread_mutex_t tze_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct tze_trace_buf_t *tze_trace_bufs;
+static unsigned tze_trace_tid_count;
+static size_t tze_trace_dropped;		/* spans lost to a failed alloc	 */
+
+int64_t tze_trace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec - tze_trace_epoch;
+}
+
+/**
+ * Returns a buffer of a calling thread, a first span of a thread
+ * registers one, the only locked path.
+ **/
+
+static struct tze_trace_buf_t *tze_trace_buf(void)
+{
+	struct tze_trace_buf_t *buf = pthread_getspecific(tze_trace_key);
+
+	if (buf != NULL) {
+		return buf;
+	}
+
+	buf = calloc(1, sizeof(*buf));
+
+	if (buf == NULL || pthread_setspecific(tze_trace_key, buf) != 0) {
+		free(buf);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&tze_trace_lock);
+	buf->tid = ++tze_trace_tid_count;
+	buf->next = tze_trace_bufs;
+	tze_trace_bufs = buf;
+	pthread_mutex_unlock(&tze_trace_lock);
+
+	return buf;
+}
+
+static void tze_trace_drop(void)
+{
+	pthread_mutex_lock(&tze_trace_lock);
+	tze_trace_dropped++;
+	pthread_mutex_unlock(&tze_trace_lock);
+}
+
+void tze_trace_span(const char	  *const name,
+					const char	  *const detail,
+					const int64_t  begin)
+{
+	const int64_t end = tze_trace_now();
+	struct tze_trace_buf_t *buf = tze_trace_buf();
+
+	if (buf == NULL) {
+		tze_trace_drop();
+		return;
+	}
+
+	if (buf->count == buf->capacity) {
+		const size_t capacity = (buf->capacity == 0) ?
+			TZE_TRACE_MIN_EVENTS : buf->capacity * 2;
+		struct tze_trace_event_t *events =
+			realloc(buf->events, sizeof(*events) * capacity);
+
+		if (events == NULL) {
+			tze_trace_drop();
+			return;
+		}
+
+		buf->events = events;
+		buf->capacity = capacity;
+	}
+
+	struct tze_trace_event_t *ev = &buf->events[buf->count++];
+
+	ev->name = name;
+	ev->begin = begin;
+	ev->end = end;
+	ev->detail[0] = '\0';
+
+	if (detail != NULL) {
+		strncat(ev->detail, detail, sizeof(ev->detail) - 1);
+	}
+}
+
+int tze_trace_start(struct tze_err_t *err)
+{
+	const int ret = pthread_key_create(&tze_trace_key, NULL);
+
+	if (ret != 0) {
+		tze_err_set(err, ret, "unable to create a trace buffer key");
+		return -1;
+	}
+
+	tze_trace_epoch = 0;
+	tze_trace_epoch = tze_trace_now();
+	tze_trace_enabled = true;
+
+	/* a calling thread goes first */
+	if (tze_trace_buf() == NULL) {
+		tze_trace_enabled = false;
+		pthread_key_delete(tze_trace_key);
+		tze_err_set(err, ENOMEM, "unable to allocate a trace buffer");
+		return -1;
+	}
+
+	return 0;
+}
+
+static void tze_trace_print_str(FILE	   *out,
+								const char *s)
+{
+	for (; *s != '\0'; s++) {
+		const unsigned char c = (unsigned char) *s;
+
+		if (c == '"' || c == '\\') {
+			fprintf(out, "\\%c", c);
+		} else if (c < 0x20) {
+			fprintf(out, "\\u%04x", c);
+		} else {
+			fputc(c, out);
+		}
+	}
+}
+
+static void tze_trace_print_us(FILE			*out,
+							   const int64_t  ns)
+{
+	fprintf(out, "%" PRId64 ".%03d", ns / 1000, (int) (ns % 1000));
+}
+
+int tze_trace_write(const char		 *const file_name,
+					struct tze_err_t *err)
+{
+	const long pid = (long) getpid();
+	struct tze_trace_buf_t *buf;
+	int ret = -1;
+
+	tze_trace_enabled = false;
+
+	FILE *out = fopen(file_name, "w");
+
+	if (out == NULL) {
+		tze_err_set(err, errno, "%s: unable to create", file_name);
+		goto free_bufs;
+	}
+
+	fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%ld,"
+			"\"tid\":1,\"args\":{\"name\":\"tze\"}}", pid);
+
+	for (buf = tze_trace_bufs; buf != NULL; buf = buf->next) {
+		fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+				"\"pid\":%ld,\"tid\":%u,\"args\":{\"name\":\"%s %u\"}}",
+				pid, buf->tid, (buf->tid == 1) ? "main" : "thread", buf->tid);
+
+		for (size_t i = 0; i < buf->count; i++) {
+			const struct tze_trace_event_t *ev = &buf->events[i];
+
+			fprintf(out, ",\n{\"name\":\"%s\",\"cat\":\"tze\",\"ph\":\"X\","
+					"\"pid\":%ld,\"tid\":%u,\"ts\":", ev->name, pid, buf->tid);
+			tze_trace_print_us(out, ev->begin);
+			fprintf(out, ",\"dur\":");
+			tze_trace_print_us(out, ev->end - ev->begin);
+
+			if (ev->detail[0] != '\0') {
+				fprintf(out, ",\"args\":{\"detail\":\"");
+				tze_trace_print_str(out, ev->detail);
+				fprintf(out, "\"}");
+			}
+
+			fputc('}', out);
+		}
+	}
+
+	if (tze_trace_dropped > 0) {
+		fprintf(out, ",\n{\"name\":\"dropped\",\"ph\":\"C\",\"pid\":%ld,"
+				"\"tid\":1,\"ts\":0,\"args\":{\"spans\":%zu}}",
+				pid, tze_trace_dropped);
+	}
+
+	fprintf(out, "\n]}\n");
+
+	if (ferror(out)) {
+		tze_err_set(err, EIO, "%s: unable to write", file_name);
+		fclose(out);
+		goto free_bufs;
+	}
+
+	if (fclose(out) != 0) {
+		tze_err_set(err, errno, "%s: unable to write", file_name);
+		goto free_bufs;
+	}
+
+	ret = 0;
+
+free_bufs:
+	while (tze_trace_bufs != NULL) {
+		buf = tze_trace_bufs;
+		tze_trace_bufs = buf->next;
+		free(buf->events);
+		free(buf);
+	}
+
+	tze_trace_tid_count = 0;
+	tze_trace_dropped = 0;
+	pthread_key_delete(tze_trace_key);
+
+	return ret;
+}
@@ -0,0 +1,60 @@
+#ifndef TZE_TRACE_H
+#define TZE_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * A timeline of a run in the Chrome trace event format, which Perfetto
+ * and chrome://tracing load. Spans are complete ("X") events kept
+ * in a buffer of their thread, so recording takes no lock, and buffers
+ * are written as a single JSON file after all threads are joined.
+ * A disabled trace costs a branch per span.
+ **/
+
+#define TZE_TRACE_DETAIL_MAX			(64)
+
+struct tze_err_t;
+
+extern bool tze_trace_enabled;
+
+int64_t tze_trace_now(void);
+
+/**
+ * Records a span started by tze_trace_begin(), a detail is copied
+ * and truncated to TZE_TRACE_DETAIL_MAX - 1 bytes, NULL is none.
+ **/
+
+void tze_trace_span(const char	  *const name,
+					const char	  *const detail,
+					const int64_t  begin);
+
+static inline int64_t tze_trace_begin(void)
+{
+	return tze_trace_enabled ? tze_trace_now() : 0;
+}
+
+static inline void tze_trace_end(const char	   *const name,
+								 const char	   *const detail,
+								 const int64_t  begin)
+{
+	if (tze_trace_enabled) {
+		tze_trace_span(name, detail, begin);
+	}
+}
+
+/**
+ * Starts recording, timestamps are relative to this call.
+ **/
+
+int tze_trace_start(struct tze_err_t *err);
+
+/**
+ * Writes recorded spans to a file and stops recording, all traced
+ * threads should be finished.
+ **/
+
+int tze_trace_write(const char		 *const file_name,
+					struct tze_err_t *err);
+
+#endif /* TZE_TRACE_H */
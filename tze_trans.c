@@ -0,0 +1,515 @@
+#include <errno.h>
+#include <stdio.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "tze_tz.h"
+#include "tze_err.h"
+#include "tze_list.h"
+#include "tze_trans.h"
+#include "tze_locality.h"
+
+#define TZE_TRANS_VARINT_MAX			(10)
+#define TZE_TRANS_RECORD_MAX			(TZE_TRANS_VARINT_MAX + 1)
+
+static const char TZE_TRANS_BASE64[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static inline uint64_t tze_trans_zigzag(const int64_t v)
+{
+	return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static inline int64_t tze_trans_unzigzag(const uint64_t v)
+{
+	return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+static inline uint8_t *tze_trans_put_varint(uint8_t	*p,
+											uint64_t v)
+{
+	while (v >= 0x80) {
+		*p++ = (uint8_t) (v | 0x80);
+		v >>= 7;
+	}
+
+	*p++ = (uint8_t) v;
+	return p;
+}
+
+/**
+ * Decodes a record at an offset, returns a next record offset
+ * or 0 on malformed data.
+ **/
+
+static size_t tze_trans_record(const struct tze_trans_t *trans,
+							   size_t					 offs,
+							   const int64_t			 base,
+							   int64_t					*time,
+							   uint8_t					*type)
+{
+	uint64_t v = 0;
+
+	for (unsigned shift = 0; ; shift += 7) {
+		if (offs >= trans->size || shift >= 64) {
+			return 0;
+		}
+
+		const uint8_t b = trans->data[offs++];
+
+		v |= (uint64_t) (b & 0x7f) << shift;
+
+		if ((b & 0x80) == 0) {
+			break;
+		}
+	}
+
+	if (offs >= trans->size || trans->data[offs] >= trans->type_count) {
+		return 0;
+	}
+
+	*time = (int64_t) ((uint64_t) base + (uint64_t) tze_trans_unzigzag(v));
+	*type = trans->data[offs++];
+
+	return offs;
+}
+
+/**
+ * Marks every interval-th record, validates records on the way.
+ **/
+
+static int tze_trans_mark(struct tze_trans_t *trans)
+{
+	trans->mark_count = (trans->count + TZE_TRANS_INTERVAL - 1) /
+		TZE_TRANS_INTERVAL;
+	trans->marks = malloc(sizeof(*trans->marks) * (trans->mark_count + 1));
+
+	if (trans->marks == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	size_t offs = 0;
+	int64_t prev = 0;
+	uint8_t prev_type = 0;
+
+	for (size_t i = 0; i < trans->count; i++) {
+		int64_t time;
+		uint8_t type;
+		const size_t next = tze_trans_record(trans, offs, prev,
+											 &time, &type);
+
+		if (next == 0 || (i > 0 && time <= prev)) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		if (i % TZE_TRANS_INTERVAL == 0) {
+			struct tze_trans_mark_t *m = &trans->marks[i / TZE_TRANS_INTERVAL];
+
+			m->time = time;
+			m->base = prev;
+			m->offs = (uint32_t) offs;
+			m->type = prev_type;
+		}
+
+		offs = next;
+		prev = time;
+		prev_type = type;
+	}
+
+	if (offs != trans->size) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+static int tze_trans_add_type(struct tze_trans_t	  *trans,
+							  const int32_t			   offset,
+							  const bool			   dst,
+							  const char			  *const abbr)
+{
+	for (size_t i = 0; i < trans->type_count; i++) {
+		const struct tze_trans_type_t *t = &trans->types[i];
+
+		if (t->offset == offset && t->dst == dst &&
+			strcmp(t->abbr, abbr) == 0) {
+			return (int) i;
+		}
+	}
+
+	if (trans->type_count == TZE_TRANS_TYPE_MAX ||
+		strlen(abbr) > TZE_RULE_ABBR_MAX) {
+		return -1;
+	}
+
+	struct tze_trans_type_t *t = &trans->types[trans->type_count];
+
+	t->offset = offset;
+	t->dst = dst;
+	snprintf(t->abbr, sizeof(t->abbr), "%s", abbr);
+
+	return (int) trans->type_count++;
+}
+
+int tze_trans_build(struct tze_trans_t		   *trans,
+					const struct tze_tz_data_t *data,
+					struct tze_err_t		   *err)
+{
+	*trans = (struct tze_trans_t) TZE_TRANS_INIT;
+	trans->types = malloc(sizeof(*trans->types) * TZE_TRANS_TYPE_MAX);
+	trans->data = malloc(data->time_count * TZE_TRANS_RECORD_MAX + 1);
+
+	if (trans->types == NULL || trans->data == NULL) {
+		tze_err_set(err, ENOMEM, "unable to allocate a transition table");
+		goto fail;
+	}
+
+	int type_map[TZE_TRANS_TYPE_MAX];
+
+	for (size_t i = 0; i < data->type_count; i++) {
+		type_map[i] = -1;
+	}
+
+	uint8_t *p = trans->data;
+	int64_t prev = 0;
+
+	for (size_t i = 0; i <= data->time_count; i++) {
+		/* type 0 stays first, it applies before the first transition */
+		const uint8_t type = (i == 0) ? 0 : data->indexes[i - 1];
+
+		if (type_map[type] < 0) {
+			type_map[type] = tze_trans_add_type(trans,
+												tze_tz_gmtoff(data, type),
+												tze_tz_isdst(data, type),
+												tze_tz_abbr(data, type));
+
+			if (type_map[type] < 0) {
+				tze_err_set(err, 0, "\"%s\" abbreviation is too long",
+							tze_tz_abbr(data, type));
+				goto fail;
+			}
+		}
+
+		if (i > 0) {
+			const int64_t time = tze_tz_time(data, i - 1);
+
+			p = tze_trans_put_varint(p, tze_trans_zigzag(time - prev));
+			*p++ = (uint8_t) type_map[type];
+			prev = time;
+		}
+	}
+
+	trans->size = (size_t) (p - trans->data);
+	trans->count = data->time_count;
+
+	if (tze_trans_mark(trans) < 0) {
+		tze_err_set(err, errno, "unable to index a transition table");
+		goto fail;
+	}
+
+	return 0;
+
+fail:
+	tze_trans_free(trans);
+	return -1;
+}
+
+static int tze_trans_parse_type(struct tze_trans_type_t *t,
+								const char				*p,
+								const size_t			 size)
+{
+	char buf[TZE_RULE_ABBR_MAX + TZE_RULE_TIME_MAX + 4];
+	long offset;
+	int dst;
+	int n = 0;
+
+	if (size >= sizeof(buf)) {
+		return -1;
+	}
+
+	memcpy(buf, p, size);
+	buf[size] = '\0';
+
+	if (sscanf(buf, "%ld/%d/%n", &offset, &dst, &n) != 2 || n == 0 ||
+		offset <= INT32_MIN || offset >= INT32_MAX || (dst != 0 && dst != 1) ||
+		size - (size_t) n > TZE_RULE_ABBR_MAX) {
+		return -1;
+	}
+
+	t->offset = (int32_t) offset;
+	t->dst = (dst != 0);
+	snprintf(t->abbr, sizeof(t->abbr), "%s", buf + n);
+
+	return 0;
+}
+
+static int tze_trans_parse_base64(struct tze_trans_t *trans,
+								  const char		 *p,
+								  const size_t		  size)
+{
+	uint32_t acc = 0;
+	unsigned bits = 0;
+
+	trans->data = malloc(size * 3 / 4 + 1);
+	trans->size = 0;
+
+	if (trans->data == NULL) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < size; i++) {
+		const char *const c = (p[i] == '\0') ?
+			NULL : strchr(TZE_TRANS_BASE64, p[i]);
+
+		if (c == NULL) {
+			return -1;
+		}
+
+		acc = (acc << 6) | (uint32_t) (c - TZE_TRANS_BASE64);
+		bits += 6;
+
+		if (bits >= 8) {
+			bits -= 8;
+			trans->data[trans->size++] = (uint8_t) (acc >> bits);
+		}
+	}
+
+	return 0;
+}
+
+int tze_trans_parse(struct tze_trans_t *trans,
+					const char		   *const line,
+					const char			sep,
+					struct tze_err_t   *err)
+{
+	const char *p = line;
+	const char *end = strchr(p, sep);
+
+	*trans = (struct tze_trans_t) TZE_TRANS_INIT;
+	trans->types = malloc(sizeof(*trans->types) * TZE_TRANS_TYPE_MAX);
+
+	if (trans->types == NULL) {
+		tze_err_set(err, ENOMEM, "unable to allocate a transition table");
+		return -1;
+	}
+
+	if (end == NULL) {
+		goto malformed;
+	}
+
+	while (p < end) {
+		const char *const comma = memchr(p, ',', (size_t) (end - p));
+		const char *const type_end = (comma == NULL) ? end : comma;
+
+		if (trans->type_count == TZE_TRANS_TYPE_MAX ||
+			tze_trans_parse_type(&trans->types[trans->type_count++], p,
+								 (size_t) (type_end - p)) < 0) {
+			goto malformed;
+		}
+
+		p = (comma == NULL) ? end : comma + 1;
+	}
+
+	char *count_end;
+
+	errno = 0;
+	trans->count = strtoul(end + 1, &count_end, 10);
+
+	if (trans->type_count == 0 || errno != 0 ||
+		end[1] < '0' || end[1] > '9' || *count_end != sep) {
+		goto malformed;
+	}
+
+	p = count_end + 1;
+	end = p + strcspn(p, "\n");
+
+	if (tze_trans_parse_base64(trans, p, (size_t) (end - p)) < 0 ||
+		tze_trans_mark(trans) < 0) {
+		goto malformed;
+	}
+
+	return 0;
+
+malformed:
+	tze_err_set(err, 0, "a malformed transition table");
+	tze_trans_free(trans);
+	return -1;
+}
+
+void tze_trans_seek(const struct tze_trans_t  *trans,
+					const int64_t			   time,
+					struct tze_trans_cursor_t *cursor)
+{
+	size_t lo = 0;
+	size_t hi = trans->mark_count;
+
+	/* a last mark at or before the time */
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+
+		if (trans->marks[mid].time <= time) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (lo == 0) {
+		*cursor = (struct tze_trans_cursor_t) {
+			.offs = 0, .index = 0, .time = 0, .type = 0
+		};
+	} else {
+		const struct tze_trans_mark_t *m = &trans->marks[lo - 1];
+
+		*cursor = (struct tze_trans_cursor_t) {
+			.offs	= m->offs,
+			.index	= (lo - 1) * TZE_TRANS_INTERVAL,
+			.time	= m->base,
+			.type	= m->type
+		};
+	}
+
+	while (cursor->index < trans->count) {
+		int64_t next_time;
+		uint8_t next_type;
+		const size_t next = tze_trans_record(trans, cursor->offs,
+											 cursor->time,
+											 &next_time, &next_type);
+
+		if (next_time > time) {
+			break;
+		}
+
+		cursor->offs = next;
+		cursor->index++;
+		cursor->time = next_time;
+		cursor->type = next_type;
+	}
+}
+
+int tze_trans_next(const struct tze_trans_t	 *trans,
+				   struct tze_trans_cursor_t *cursor,
+				   int64_t					 *time,
+				   uint8_t					 *type)
+{
+	if (cursor->index >= trans->count) {
+		return 0;
+	}
+
+	cursor->offs = tze_trans_record(trans, cursor->offs, cursor->time,
+									time, type);
+	cursor->index++;
+	cursor->time = *time;
+	cursor->type = *type;
+
+	return 1;
+}
+
+const struct tze_trans_type_t *
+tze_trans_find(const struct tze_trans_t *trans,
+			   const int64_t			 time)
+{
+	struct tze_trans_cursor_t cursor;
+
+	tze_trans_seek(trans, time, &cursor);
+
+	return &trans->types[cursor.type];
+}
+
+int tze_trans_print(FILE					 *out,
+					const struct tze_trans_t *trans,
+					const char				  sep)
+{
+	for (size_t i = 0; i < trans->type_count; i++) {
+		const struct tze_trans_type_t *t = &trans->types[i];
+
+		fprintf(out, "%s%" PRId32 "/%d/%s", (i == 0) ? "" : ",",
+				t->offset, t->dst ? 1 : 0, t->abbr);
+	}
+
+	fprintf(out, "%c%zu%c", sep, trans->count, sep);
+
+	uint32_t acc = 0;
+	unsigned bits = 0;
+
+	for (size_t i = 0; i < trans->size; i++) {
+		acc = (acc << 8) | trans->data[i];
+		bits += 8;
+
+		while (bits >= 6) {
+			bits -= 6;
+			fputc(TZE_TRANS_BASE64[(acc >> bits) & 0x3f], out);
+		}
+	}
+
+	if (bits > 0) {
+		fputc(TZE_TRANS_BASE64[(acc << (6 - bits)) & 0x3f], out);
+	}
+
+	fputc('\n', out);
+
+	return ferror(out) ? -1 : 0;
+}
+
+int tze_trans_print_list(FILE					 *out,
+						 const char *const		 *roots,
+						 const size_t			  root_count,
+						 const struct tze_list_t *loc_list,
+						 const char				  sep,
+						 struct tze_err_t		 *err)
+{
+	const struct tze_locality_t *loc;
+
+	tze_list_foreach_entry(loc, struct tze_locality_t, list, loc_list) {
+		char file_name[PATH_MAX];
+		struct tze_tz_data_t data;
+		struct tze_trans_t trans;
+
+		if (tze_tz_locate(roots, root_count, loc->name,
+						  file_name, err) < 0) {
+			return -1;
+		}
+
+		const int ret = tze_tz_load(file_name, loc->name, &data, err);
+
+		if (ret != 0) {
+			if (ret > 0) {
+				tze_err_set(err, 0, "%s: not a timezone file", loc->name);
+			}
+
+			return -1;
+		}
+
+		if (tze_trans_build(&trans, &data, err) < 0) {
+			tze_tz_unload(&data);
+			return -1;
+		}
+
+		fprintf(out, "%s%c", loc->name, sep);
+
+		const int print_ret = tze_trans_print(out, &trans, sep);
+
+		tze_trans_free(&trans);
+		tze_tz_unload(&data);
+
+		if (print_ret < 0) {
+			tze_err_set(err, errno, "unable to write a transition table");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void tze_trans_free(struct tze_trans_t *trans)
+{
+	free(trans->types);
+	free(trans->data);
+	free(trans->marks);
+	*trans = (struct tze_trans_t) TZE_TRANS_INIT;
+}
@@ -0,0 +1,134 @@
+#ifndef TZE_TRANS_H
+#define TZE_TRANS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "tze_rule.h"
+
+/**
+ * A compact transition table of a zone. Local time types are
+ * deduplicated, type 0 is the one before a first transition.
+ * Transitions are a byte stream of records:
+ *
+ *   {zigzag varint time delta}{type index}
+ *
+ * with a first delta from 0. Every TZE_TRANS_INTERVAL-th record
+ * has a mark for a binary search, so a lookup decodes one interval
+ * at most. A printed table is a single line, tze_trans_print() writes
+ * fields following a name:
+ *
+ *   {name}{sep}{types}{sep}{transition count}{sep}{records}
+ *
+ * with types as "{offset}/{0|1}/{abbr}" joined with "," and records
+ * in base64 without padding. A footer rule is not a part of a table,
+ * it applies after a last transition.
+ **/
+
+#define TZE_TRANS_INTERVAL				(16)
+#define TZE_TRANS_TYPE_MAX				(256)
+
+#define TZE_TRANS_INIT					\
+	{									\
+		.types		= 0,				\
+		.type_count	= 0,				\
+		.data		= 0,				\
+		.size		= 0,				\
+		.count		= 0,				\
+		.marks		= 0,				\
+		.mark_count	= 0					\
+	}
+
+struct tze_err_t;
+struct tze_list_t;
+struct tze_tz_data_t;
+
+struct tze_trans_type_t {
+	int32_t offset;						/* seconds east of UTC			 */
+	bool	dst;
+	char	abbr[TZE_RULE_ABBR_MAX + 1];
+};
+
+struct tze_trans_mark_t {
+	int64_t	 time;						/* of a marked record			 */
+	int64_t	 base;						/* of a previous record			 */
+	uint32_t offs;
+	uint8_t	 type;						/* in effect before a record	 */
+};
+
+struct tze_trans_t {
+	struct tze_trans_type_t *types;
+	size_t					 type_count;
+	uint8_t					*data;
+	size_t					 size;
+	size_t					 count;
+	struct tze_trans_mark_t *marks;
+	size_t					 mark_count;
+};
+
+struct tze_trans_cursor_t {
+	size_t	offs;						/* of a next record				 */
+	size_t	index;						/* of a next record				 */
+	int64_t	time;						/* of a previous record			 */
+	uint8_t	type;						/* in effect					 */
+};
+
+int tze_trans_build(struct tze_trans_t		   *trans,
+					const struct tze_tz_data_t *data,
+					struct tze_err_t		   *err);
+
+/**
+ * Parses printed types, a count and records, i.e. a table line
+ * following a name and a separator.
+ **/
+
+int tze_trans_parse(struct tze_trans_t *trans,
+					const char		   *const line,
+					const char			sep,
+					struct tze_err_t   *err);
+
+/**
+ * Positions a cursor after all transitions at or before a time.
+ **/
+
+void tze_trans_seek(const struct tze_trans_t  *trans,
+					const int64_t			   time,
+					struct tze_trans_cursor_t *cursor);
+
+/**
+ * Decodes a next transition, returns 0 at the end.
+ **/
+
+int tze_trans_next(const struct tze_trans_t	 *trans,
+				   struct tze_trans_cursor_t *cursor,
+				   int64_t					 *time,
+				   uint8_t					 *type);
+
+/**
+ * Returns a local time type in effect at a time, O(log n).
+ **/
+
+const struct tze_trans_type_t *
+tze_trans_find(const struct tze_trans_t *trans,
+			   const int64_t			 time);
+
+int tze_trans_print(FILE					 *out,
+					const struct tze_trans_t *trans,
+					const char				  sep);
+
+/**
+ * Prints a table of every locality, zone files are read from the latest
+ * root having them.
+ **/
+
+int tze_trans_print_list(FILE					 *out,
+						 const char *const		 *roots,
+						 const size_t			  root_count,
+						 const struct tze_list_t *loc_list,
+						 const char				  sep,
+						 struct tze_err_t		 *err);
+
+void tze_trans_free(struct tze_trans_t *trans);
+
+#endif /* TZE_TRANS_H */
@@ -0,0 +1,303 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "tze_trie.h"
+#include "tze_index.h"
+
+static uint32_t tze_trie_add(struct tze_trie_t *trie,
+							 const uint32_t		parent,
+							 uint32_t		   *last_child,
+							 const char		   *const label,
+							 const size_t		label_size,
+							 const size_t		depth,
+							 const size_t		lo,
+							 const size_t		hi)
+{
+	const uint32_t node = (uint32_t) trie->count++;
+	struct tze_trie_node_t *n = &trie->nodes[node];
+
+	n->label = label;
+	n->label_size = (uint32_t) label_size;
+	n->depth = (uint32_t) depth;
+	n->lo = (uint32_t) lo;
+	n->hi = (uint32_t) hi;
+	n->child = 0;
+	n->sibling = 0;
+
+	if (*last_child == 0) {
+		trie->nodes[parent].child = node;
+	} else {
+		trie->nodes[*last_child].sibling = node;
+	}
+
+	*last_child = node;
+
+	return node;
+}
+
+/**
+ * All names of a range share a depth long prefix, a name equal
+ * to the prefix sorts first and ends at the parent node.
+ **/
+
+static void tze_trie_build_range(struct tze_trie_t		  *trie,
+								 const struct tze_index_t *index,
+								 const uint32_t			   parent,
+								 const size_t			   lo,
+								 const size_t			   hi,
+								 const size_t			   depth)
+{
+	const struct tze_index_entry_t *const e = index->entries;
+	uint32_t last_child = 0;
+	size_t i = lo;
+
+	if (i < hi && e[i].name[depth] == '\0') {
+		i++;
+	}
+
+	while (i < hi) {
+		const char c = e[i].name[depth];
+		size_t j = i + 1;
+
+		while (j < hi && e[j].name[depth] == c) {
+			j++;
+		}
+
+		/* the first and the last names bound a common prefix */
+		const char *const first = e[i].name;
+		const char *const last = e[j - 1].name;
+		size_t end = depth + 1;
+
+		while (first[end] != '\0' && first[end] == last[end]) {
+			end++;
+		}
+
+		const uint32_t node = tze_trie_add(trie, parent, &last_child,
+										   first + depth, end - depth,
+										   depth, i, j);
+
+		tze_trie_build_range(trie, index, node, i, j, end);
+		i = j;
+	}
+}
+
+int tze_trie_build(struct tze_trie_t		*trie,
+				   const struct tze_index_t *index)
+{
+	if (index->count >= UINT32_MAX / 2) {
+		errno = EFBIG;
+		return -1;
+	}
+
+	/* a radix tree has less than two nodes per name */
+	trie->nodes = malloc(sizeof(*trie->nodes) * (index->count * 2 + 1));
+	trie->count = 0;
+
+	if (trie->nodes == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	uint32_t none = 0;
+
+	tze_trie_add(trie, 0, &none, "", 0, 0, 0, index->count);
+	trie->nodes[0].child = 0;
+	tze_trie_build_range(trie, index, 0, 0, index->count, 0);
+
+	return 0;
+}
+
+int tze_trie_link(struct tze_trie_t *trie,
+				  const uint32_t	*parents)
+{
+	uint32_t *last_child = calloc(trie->count + 1, sizeof(*last_child));
+
+	if (last_child == NULL) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	trie->nodes[0].depth = 0;
+	trie->nodes[0].child = 0;
+	trie->nodes[0].sibling = 0;
+
+	for (size_t i = 1; i < trie->count; i++) {
+		const uint32_t parent = parents[i];
+		struct tze_trie_node_t *n = &trie->nodes[i];
+		struct tze_trie_node_t *p = &trie->nodes[parent];
+
+		if (parent >= i) {
+			free(last_child);
+			errno = EINVAL;
+			return -1;
+		}
+
+		n->depth = p->depth + p->label_size;
+		n->child = 0;
+		n->sibling = 0;
+
+		if (last_child[parent] == 0) {
+			p->child = (uint32_t) i;
+		} else {
+			trie->nodes[last_child[parent]].sibling = (uint32_t) i;
+		}
+
+		last_child[parent] = (uint32_t) i;
+	}
+
+	free(last_child);
+
+	return 0;
+}
+
+/**
+ * Descends along a prefix, returns a node whose path starts with it
+ * and sets a number of label characters matched, SIZE_MAX if none.
+ **/
+
+static size_t tze_trie_find(const struct tze_trie_t *trie,
+							const char				*const prefix,
+							size_t					*matched)
+{
+	const size_t size = strlen(prefix);
+	size_t node = 0;
+	size_t off = 0;
+
+	*matched = 0;
+
+	if (trie->count == 0) {
+		return SIZE_MAX;
+	}
+
+	while (off < size) {
+		uint32_t child = trie->nodes[node].child;
+
+		while (child != 0 && trie->nodes[child].label[0] != prefix[off]) {
+			child = trie->nodes[child].sibling;
+		}
+
+		if (child == 0) {
+			return SIZE_MAX;
+		}
+
+		const struct tze_trie_node_t *n = &trie->nodes[child];
+		const size_t rest = size - off;
+		const size_t cmp = (rest < n->label_size) ? rest : n->label_size;
+
+		if (memcmp(n->label, prefix + off, cmp) != 0) {
+			return SIZE_MAX;
+		}
+
+		node = child;
+		off += cmp;
+		*matched = cmp;
+	}
+
+	return node;
+}
+
+size_t tze_trie_prefix(const struct tze_trie_t *trie,
+					   const char			   *const prefix,
+					   size_t				   *count)
+{
+	size_t matched;
+	const size_t node = tze_trie_find(trie, prefix, &matched);
+
+	if (node == SIZE_MAX) {
+		*count = 0;
+		return 0;
+	}
+
+	*count = trie->nodes[node].hi - trie->nodes[node].lo;
+
+	return trie->nodes[node].lo;
+}
+
+static size_t tze_trie_complete_node(const struct tze_trie_t  *trie,
+									 const struct tze_index_t *index,
+									 const uint32_t			   node,
+									 const size_t			   from,
+									 tze_trie_cb_t			   cb,
+									 void					  *arg)
+{
+	const struct tze_trie_node_t *n = &trie->nodes[node];
+	const char *const name = index->entries[n->lo].name;
+	const char *const slash = (n->label_size > from) ?
+		memchr(n->label + from, '/', n->label_size - from) : NULL;
+
+	if (slash != NULL) {
+		/* the whole subtree is under a single region */
+		cb(name, n->depth + (size_t) (slash - n->label) + 1, arg);
+		return 1;
+	}
+
+	const size_t end = n->depth + n->label_size;
+	size_t count = 0;
+
+	if (name[end] == '\0' && end > 0) {
+		cb(name, end, arg);
+		count++;
+	}
+
+	for (uint32_t child = n->child; child != 0;
+		 child = trie->nodes[child].sibling) {
+		count += tze_trie_complete_node(trie, index, child, 0, cb, arg);
+	}
+
+	return count;
+}
+
+size_t tze_trie_complete(const struct tze_trie_t  *trie,
+						 const struct tze_index_t *index,
+						 const char				  *const prefix,
+						 tze_trie_cb_t			   cb,
+						 void					  *arg)
+{
+	size_t matched;
+	const size_t node = tze_trie_find(trie, prefix, &matched);
+
+	if (node == SIZE_MAX) {
+		return 0;
+	}
+
+	return tze_trie_complete_node(trie, index, (uint32_t) node,
+								  matched, cb, arg);
+}
+
+static void tze_trie_print_node(FILE					*out,
+								const struct tze_trie_t *trie,
+								const uint32_t			 node,
+								const size_t			 level,
+								const char				 sep)
+{
+	for (uint32_t child = trie->nodes[node].child; child != 0;
+		 child = trie->nodes[child].sibling) {
+		const struct tze_trie_node_t *n = &trie->nodes[child];
+
+		fprintf(out, "%zu%c%.*s%c%" PRIu32 "%c%" PRIu32 "\n",
+				level, sep, (int) n->label_size, n->label,
+				sep, n->lo, sep, n->hi - n->lo);
+		tze_trie_print_node(out, trie, child, level + 1, sep);
+	}
+}
+
+int tze_trie_print(FILE					   *out,
+				   const struct tze_trie_t *trie,
+				   const char				sep)
+{
+	if (trie->count > 0) {
+		tze_trie_print_node(out, trie, 0, 1, sep);
+	}
+
+	return ferror(out) ? -1 : 0;
+}
+
+void tze_trie_free(struct tze_trie_t *trie)
+{
+	free(trie->nodes);
+	trie->nodes = NULL;
+	trie->count = 0;
+}
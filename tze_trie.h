@@ -0,0 +1,90 @@
+#ifndef TZE_TRIE_H
+#define TZE_TRIE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A radix tree over strcmp(3) sorted names. Every node covers
+ * a contiguous range of sorted names sharing the node path as a prefix,
+ * so a prefix listing is a descent followed by a range walk.
+ * The root is node 0 with an empty label, 0 also means no node.
+ **/
+
+#define TZE_TRIE_INIT					\
+	{									\
+		.nodes	= 0,					\
+		.count	= 0						\
+	}
+
+struct tze_index_t;
+
+struct tze_trie_node_t {
+	const char *label;
+	uint32_t	label_size;
+	uint32_t	depth;					/* a label offset in a name		 */
+	uint32_t	lo;						/* a sorted name range			 */
+	uint32_t	hi;
+	uint32_t	child;
+	uint32_t	sibling;
+};
+
+struct tze_trie_t {
+	struct tze_trie_node_t *nodes;
+	size_t					count;
+};
+
+typedef void (*tze_trie_cb_t)(const char   *const name,
+							  const size_t	size,
+							  void		   *arg);
+
+/**
+ * Labels point to index names, the index should outlive a trie.
+ **/
+
+int tze_trie_build(struct tze_trie_t		*trie,
+				   const struct tze_index_t *index);
+
+/**
+ * Links nodes stored in a preorder to their parents
+ * and sets node depths, e.g. after reading a printed trie.
+ **/
+
+int tze_trie_link(struct tze_trie_t *trie,
+				  const uint32_t	*parents);
+
+/**
+ * Finds a sorted name range starting with a prefix,
+ * returns a first name index and sets a number of names.
+ **/
+
+size_t tze_trie_prefix(const struct tze_trie_t *trie,
+					   const char			   *const prefix,
+					   size_t				   *count);
+
+/**
+ * Lists distinct completions of a prefix up to and including
+ * the next "/", e.g. "America/" completes to "America/Argentina/"
+ * and "America/New_York". Visits nodes proportional to the result.
+ **/
+
+size_t tze_trie_complete(const struct tze_trie_t  *trie,
+						 const struct tze_index_t *index,
+						 const char				  *const prefix,
+						 tze_trie_cb_t			   cb,
+						 void					  *arg);
+
+/**
+ * Writes non-root nodes in a preorder, one per line:
+ *
+ *   {level}{sep}{label}{sep}{first name}{sep}{name count}
+ **/
+
+int tze_trie_print(FILE					   *out,
+				   const struct tze_trie_t *trie,
+				   const char				sep);
+
+void tze_trie_free(struct tze_trie_t *trie);
+
+#endif /* TZE_TRIE_H */
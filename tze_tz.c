@@ -1,4 +1,6 @@
 #include <errno.h>
+#include <stdio.h>
+#include <limits.h>
 #include <fcntl.h>
 #include <string.h>
 #include <stdint.h>
@@ -10,7 +12,10 @@
 #include <arpa/inet.h>
 #include "tze_tz.h"
 #include "tze_err.h"
+#include "tze_rule.h"
 #include "tze_attr.h"
+#include "tze_simd.h"
+#include "tze_trace.h"
 
 #define TZE_TZ_CHR_SPACE				0x20
 #define TZE_TZ_CHR_LAST					0x7f
@@ -24,6 +29,7 @@
 #define TZE_TZ_DEF_OFFSET				(0)
 #define TZE_TZ_TIMECNT_MAX				(0x400)
 #define TZE_TZ_TYPECNT_MAX				(0x0ff)
+#define TZE_TZ_READ_STACK				(4096)
 
 struct tze_tz_header_t {
 	uint8_t	 tzh_magic[sizeof(TZE_TZ_MAGIC) - 1];
@@ -124,22 +130,15 @@ tze_tz_read_all_at(int				 fd,
 						   data_size, err);
 }
 
-static inline int
-tze_tz_read_header_at(int					  fd,
-					  const off_t			  file_size,
-					  const char			 *const locality,
-					  const off_t			  offs,
-					  struct tze_tz_header_t *hdr,
-					  struct tze_err_t		 *err)
-{
-	const char *const htype = (offs == 0) ?
-		"a primary header" : "a secondary header";
-
-	if (tze_tz_read_all_at(fd, file_size, locality, htype,
-						   offs, hdr, sizeof(*hdr), err) < 0) {
-		return -1;
-	}
+/**
+ * Validates a header already in host byte order.
+ **/
 
+static int tze_tz_check_header(struct tze_tz_header_t *hdr,
+							   const char			  *const locality,
+							   const char			  *const htype,
+							   struct tze_err_t		  *err)
+{
 	if (memcmp(hdr->tzh_magic, TZE_TZ_MAGIC,
 			   sizeof(TZE_TZ_MAGIC) - 1) != 0) {
 		/* not a timezone file */
@@ -199,15 +198,307 @@ tze_tz_read_header_at(int					  fd,
 	return 0;
 }
 
+static inline int
+tze_tz_read_header_at(int					  fd,
+					  const off_t			  file_size,
+					  const char			 *const locality,
+					  const off_t			  offs,
+					  struct tze_tz_header_t *hdr,
+					  struct tze_err_t		 *err)
+{
+	const char *const htype = (offs == 0) ?
+		"a primary header" : "a secondary header";
+
+	if (tze_tz_read_all_at(fd, file_size, locality, htype,
+						   offs, hdr, sizeof(*hdr), err) < 0) {
+		return -1;
+	}
+
+	return tze_tz_check_header(hdr, locality, htype, err);
+}
+
+/**
+ * Returns a pointer to a range of a buffer, NULL when it does not fit.
+ **/
+
+static inline const uint8_t *
+tze_tz_range(const uint8_t	  *data,
+			 const size_t	   len,
+			 const char		  *const locality,
+			 const char		  *const data_description,
+			 const size_t	   offs,
+			 const size_t	   size,
+			 struct tze_err_t *err)
+{
+	if (offs > len || size > len - offs) {
+		tze_err_set(err, 0,
+					"%s: unable to read %s beyond a data end (%zu/%zu)",
+					locality, data_description, offs + size, len);
+		return NULL;
+	}
+
+	return data + offs;
+}
+
+static inline int
+tze_tz_header_at(const uint8_t			*data,
+				 const size_t			 len,
+				 const char				*const locality,
+				 const size_t			 offs,
+				 struct tze_tz_header_t *hdr,
+				 struct tze_err_t		*err)
+{
+	const char *const htype = (offs == 0) ?
+		"a primary header" : "a secondary header";
+	const uint8_t *p = tze_tz_range(data, len, locality, htype,
+									offs, sizeof(*hdr), err);
+
+	if (p == NULL) {
+		return -1;
+	}
+
+	memcpy(hdr, p, sizeof(*hdr));
+
+	return tze_tz_check_header(hdr, locality, htype, err);
+}
+
+int tze_tz_parse(const void		  *const data,
+				 const size_t	   len,
+				 const char		  *const locality,
+				 const char		 **rule,
+				 size_t			  *rule_size,
+				 bool			  *v3,
+				 struct tze_err_t *err)
+{
+	const uint8_t *const buf = data;
+	struct tze_tz_header_t hdr;
+
+	*rule = NULL;
+	*rule_size = 0;
+	*v3 = false;
+
+	if (len <= sizeof(hdr)) {
+		/* wrong format */
+		return 1;
+	}
+
+	int ret = tze_tz_header_at(buf, len, locality, 0, &hdr, err);
+
+	if (ret != 0) {
+		return ret;
+	}
+
+	const size_t tzh_offs =
+		sizeof(hdr) +
+		hdr.tzh_timecnt * (sizeof(uint32_t) + 1) +
+		hdr.tzh_typecnt * sizeof(struct tze_tz_ttinfo_t) +
+		hdr.tzh_charcnt +
+		hdr.tzh_leapcnt * (2 * sizeof(uint32_t)) +
+		hdr.tzh_ttisgmtcnt +
+		hdr.tzh_ttisstdcnt;
+
+	ret = tze_tz_header_at(buf, len, locality, tzh_offs, &hdr, err);
+
+	if (ret != 0) {
+		if (ret > 0) {
+			tze_err_set(err, 0, "%s: a secondary header corrupted: "
+						"wrong magic", locality);
+		}
+
+		return -1;
+	}
+
+	const size_t indexes_offs = tzh_offs + sizeof(hdr) +
+		hdr.tzh_timecnt * sizeof(int64_t);
+	const uint8_t *const indexes =
+		tze_tz_range(buf, len, locality, "transition type indexes",
+					 indexes_offs, hdr.tzh_timecnt, err);
+
+	if (indexes == NULL) {
+		return -1;
+	}
+
+	/* a type count is in [1, 255], so 255 is never a valid index */
+	const size_t valid = tze_simd_span(indexes, hdr.tzh_timecnt, 0,
+									   (uint8_t) (hdr.tzh_typecnt - 1),
+									   UINT8_MAX);
+
+	if (valid < hdr.tzh_timecnt) {
+		tze_err_set(err, 0, "%s: wrong transition type index "
+					"(%" PRIu8 " >= %" PRIu32 ")",
+					locality, indexes[valid], hdr.tzh_typecnt);
+		return -1;
+	}
+
+	const uint8_t *const ttinfo =
+		tze_tz_range(buf, len, locality, "local time types",
+					 indexes_offs + hdr.tzh_timecnt,
+					 hdr.tzh_typecnt * sizeof(struct tze_tz_ttinfo_t), err);
+
+	if (ttinfo == NULL) {
+		return -1;
+	}
+
+	for (size_t i = 0; i < hdr.tzh_typecnt; i++) {
+		uint32_t v;
+
+		memcpy(&v, ttinfo + i * sizeof(struct tze_tz_ttinfo_t), sizeof(v));
+
+		const int32_t gmtoff = (int32_t) ntohl(v);
+
+		if (gmtoff <= -TZE_TZ_MAX_OFFSET / 2 ||
+			gmtoff >= +TZE_TZ_MAX_OFFSET / 2) {
+			tze_err_set(err, 0,
+						"%s: time offset %" PRIi32 " is out of range "
+						"(%i, %i)",
+						locality, gmtoff,
+						+TZE_TZ_MAX_OFFSET / 2,
+						-TZE_TZ_MAX_OFFSET / 2);
+			return -1;
+		}
+	}
+
+	const size_t tzh2_size =
+		sizeof(hdr) +
+		hdr.tzh_timecnt * (sizeof(int64_t) + 1) +
+		hdr.tzh_typecnt * sizeof(struct tze_tz_ttinfo_t) +
+		hdr.tzh_charcnt +
+		hdr.tzh_leapcnt * (sizeof(int64_t) + sizeof(uint32_t)) +
+		hdr.tzh_ttisgmtcnt +
+		hdr.tzh_ttisstdcnt;
+	const size_t rule_offs = tzh_offs + tzh2_size + 1;
+
+	if (rule_offs >= len) {
+		tze_err_set(err, 0, "%s: invalid rule offset: %zu",
+					locality, rule_offs);
+		return -1;
+	}
+
+	const char *const rule_value = (const char *) buf + rule_offs;
+	const size_t rule_value_size = len - rule_offs - 1;
+
+	if (rule_value[rule_value_size] != '\n') {
+		tze_err_set(err, 0, "%s: wrong rule trailer (0x%02" PRIx8 ")",
+					locality, (uint8_t) rule_value[rule_value_size]);
+		return -1;
+	}
+
+	if (tze_simd_span(rule_value, rule_value_size, TZE_TZ_CHR_SPACE + 1,
+					  TZE_TZ_CHR_LAST, 0) < rule_value_size) {
+		tze_err_set(err, 0, "%s: a rule has non-ASCII characters", locality);
+		return -1;
+	}
+
+	*rule = rule_value;
+	*rule_size = rule_value_size;
+	*v3 = (hdr.tzh_version == TZE_TZ_VERSION_3);
+
+	return 0;
+}
+
 int tze_tz_read(const char		  *const file_name,
 				const char		  *const locality,
 				char			 **rule,
 				bool			  *v3,
 				struct tze_err_t  *err)
 {
+	uint8_t stack_buf[TZE_TZ_READ_STACK];
+	uint8_t *buf = stack_buf;
+	struct stat st;
+	int ret = -1;
+
 	*rule = NULL;
 	*v3 = false;
 
+	const int64_t span = tze_trace_begin();
+	const int fd = open(file_name, O_RDONLY | O_CLOEXEC);
+
+	tze_trace_end("open file", locality, span);
+
+	if (fd < 0) {
+		tze_err_set(err, errno, "%s: unable to open", locality);
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		tze_err_set(err, errno, "%s: unable to get a file size", locality);
+		goto close_fd;
+	}
+
+	const size_t file_size = (size_t) st.st_size;
+
+	if (file_size <= sizeof(struct tze_tz_header_t)) {
+		/* wrong format */
+		ret = 1;
+		goto close_fd;
+	}
+
+	if (file_size > sizeof(stack_buf)) {
+		/* many transitions */
+		buf = malloc(file_size);
+
+		if (buf == NULL) {
+			tze_err_set(err, errno,
+						"%s: unable to allocate a file buffer", locality);
+			goto close_fd;
+		}
+	}
+
+	/* a single read for a whole file, a parse does the rest */
+	for (size_t done = 0; done < file_size; ) {
+		const ssize_t n = read(fd, buf + done, file_size - done);
+
+		if (n < 0) {
+			if (errno == EINTR || errno == EAGAIN) {
+				continue;
+			}
+
+			tze_err_set(err, errno, "%s: unable to read", locality);
+			goto free_buf;
+		}
+
+		if (n == 0) {
+			tze_err_set(err, 0, "%s: a file is truncated while read",
+						locality);
+			goto free_buf;
+		}
+
+		done += (size_t) n;
+	}
+
+	const char *rule_value;
+	size_t rule_size;
+
+	ret = tze_tz_parse(buf, file_size, locality,
+					   &rule_value, &rule_size, v3, err);
+
+	if (ret == 0) {
+		*rule = strndup(rule_value, rule_size);
+
+		if (*rule == NULL) {
+			tze_err_set(err, ENOMEM,
+						"%s: unable to allocate a rule buffer", locality);
+			ret = -1;
+		}
+	}
+
+free_buf:
+	if (buf != stack_buf) {
+		free(buf);
+	}
+
+close_fd:
+	tze_tz_close_fd(fd);
+	return ret;
+}
+
+int tze_tz_load(const char			 *const file_name,
+				const char			 *const locality,
+				struct tze_tz_data_t *data,
+				struct tze_err_t	 *err)
+{
+	*data = (struct tze_tz_data_t) TZE_TZ_DATA_INIT;
+
 	int fd = open(file_name, O_RDONLY);
 
 	if (fd < 0) {
@@ -219,13 +510,14 @@ int tze_tz_read(const char		  *const file_name,
 
 	if (file_size < 0) {
 		tze_err_set(err, errno, "%s: unable to get a file size", locality);
-		goto close_fd;
+		goto fail;
 	}
 
 	struct tze_tz_header_t hdr;
 
-	if (file_size <= sizeof(hdr)) {
+	if (file_size <= (off_t) sizeof(hdr)) {
 		/* wrong format */
+		tze_tz_close_fd(fd);
 		return 1;
 	}
 
@@ -237,7 +529,7 @@ int tze_tz_read(const char		  *const file_name,
 			return ret;
 		}
 
-		goto close_fd;
+		goto fail;
 	}
 
 	const off_t tzh_offs = (off_t)
@@ -249,140 +541,434 @@ int tze_tz_read(const char		  *const file_name,
 		hdr.tzh_ttisgmtcnt +
 		hdr.tzh_ttisstdcnt);
 
-	ret = tze_tz_read_header_at(fd, file_size, locality,
-								tzh_offs, &hdr, err);
+	if (tze_tz_read_header_at(fd, file_size, locality,
+							  tzh_offs, &hdr, err) != 0) {
+		goto fail;
+	}
 
-	if (ret != 0) {
-		goto close_fd;
+	const off_t data_offs = tzh_offs + (off_t) sizeof(hdr);
+
+	if (data_offs >= file_size) {
+		tze_err_set(err, 0, "%s: a secondary header has no data", locality);
+		goto fail;
 	}
 
-	const off_t indexes_offs = tzh_offs +
-		(off_t) (sizeof(hdr) + hdr.tzh_timecnt * sizeof(int64_t));
-	uint8_t indexes[TZE_TZ_TIMECNT_MAX];
-	const size_t indexes_count = (hdr.tzh_timecnt > 0) ? hdr.tzh_timecnt : 1;
+	const size_t data_size = (size_t) (file_size - data_offs);
 
-	if (hdr.tzh_timecnt == 0) {
-		indexes[0] = 0;
-	} else {
-		if (tze_tz_read_all_at(fd, file_size, locality,
-							   "transition time moments",
-							   indexes_offs, indexes,
-							   sizeof(indexes[0]) * indexes_count,
-							   err) < 0) {
-			goto close_fd;
+	data->buf = malloc(data_size);
+
+	if (data->buf == NULL) {
+		tze_err_set(err, errno, "%s: unable to allocate a data buffer",
+					locality);
+		goto fail;
+	}
+
+	if (tze_tz_read_all_at(fd, file_size, locality, "a secondary data block",
+						   data_offs, data->buf, data_size, err) < 0) {
+		goto fail;
+	}
+
+	data->v3 = (hdr.tzh_version == TZE_TZ_VERSION_3);
+	data->time_count = hdr.tzh_timecnt;
+	data->type_count = hdr.tzh_typecnt;
+	data->char_count = hdr.tzh_charcnt;
+	data->leap_count = hdr.tzh_leapcnt;
+	data->isstd_count = hdr.tzh_ttisstdcnt;
+	data->isgmt_count = hdr.tzh_ttisgmtcnt;
+
+	const size_t body_size =
+		data->time_count * (sizeof(int64_t) + 1) +
+		data->type_count * TZE_TZ_TTINFO_SIZE +
+		data->char_count +
+		data->leap_count * (sizeof(int64_t) + sizeof(uint32_t)) +
+		data->isstd_count + data->isgmt_count;
+
+	if (body_size + 2 > data_size ||
+		data->buf[body_size] != '\n' || data->buf[data_size - 1] != '\n') {
+		tze_err_set(err, 0, "%s: wrong rule trailer", locality);
+		goto fail;
+	}
+
+	data->times = data->buf;
+	data->indexes = data->times + data->time_count * sizeof(int64_t);
+	data->ttinfo = data->indexes + data->time_count;
+	data->chars = (const char *) data->ttinfo +
+		data->type_count * TZE_TZ_TTINFO_SIZE;
+	data->leaps = (const uint8_t *) data->chars + data->char_count;
+	data->isstd = data->leaps +
+		data->leap_count * (sizeof(int64_t) + sizeof(uint32_t));
+	data->isgmt = data->isstd + data->isstd_count;
+	data->rule = (const char *) data->buf + body_size + 1;
+	data->rule_size = data_size - body_size - 2;
+	data->buf[data_size - 1] = '\0';
+
+	for (size_t i = 0; i < data->time_count; i++) {
+		if (data->indexes[i] >= data->type_count) {
+			tze_err_set(err, 0, "%s: wrong transition type index "
+						"(%" PRIu8 " >= %zu)",
+						locality, data->indexes[i], data->type_count);
+			goto fail;
 		}
 
-		for (size_t i = 0; i < indexes_count; i++) {
-			if (indexes[i] < hdr.tzh_typecnt) {
+		if (i > 0 && tze_tz_time(data, i) <= tze_tz_time(data, i - 1)) {
+			tze_err_set(err, 0, "%s: unordered transition time moments",
+						locality);
+			goto fail;
+		}
+	}
+
+	for (size_t i = 0; i < data->type_count; i++) {
+		const uint8_t abbr = data->ttinfo[i * TZE_TZ_TTINFO_SIZE +
+										  sizeof(int32_t) + 1];
+
+		if (abbr >= data->char_count ||
+			memchr(data->chars + abbr, '\0', data->char_count - abbr) == NULL) {
+			tze_err_set(err, 0, "%s: wrong abbreviation index (%" PRIu8 ")",
+						locality, abbr);
+			goto fail;
+		}
+	}
+
+	tze_tz_close_fd(fd);
+	return 0;
+
+fail:
+	tze_tz_unload(data);
+	tze_tz_close_fd(fd);
+	return -1;
+}
+
+int tze_tz_locate(const char *const *roots,
+				  const size_t		 root_count,
+				  const char		*const name,
+				  char				*file_name,
+				  struct tze_err_t	*err)
+{
+	for (size_t i = root_count; i > 0; i--) {
+		const int n = snprintf(file_name, PATH_MAX, "%s/%s",
+							   roots[i - 1], name);
+
+		if (n < 0 || n >= PATH_MAX) {
+			tze_err_set(err, ENAMETOOLONG, "%s: too long file name", name);
+			return -1;
+		}
+
+		if (access(file_name, R_OK) == 0) {
+			return 0;
+		}
+	}
+
+	tze_err_set(err, ENOENT, "%s: unable to find in roots", name);
+	return -1;
+}
+
+void tze_tz_unload(struct tze_tz_data_t *data)
+{
+	free(data->buf);
+	*data = (struct tze_tz_data_t) TZE_TZ_DATA_INIT;
+}
+
+static inline uint8_t *tze_tz_put_u32(uint8_t		 *p,
+									  const uint32_t  v)
+{
+	const uint32_t be = htonl(v);
+
+	memcpy(p, &be, sizeof(be));
+	return p + sizeof(be);
+}
+
+static inline uint8_t *tze_tz_put_header(uint8_t							  *p,
+										 const struct tze_tz_header_t *hdr)
+{
+	memcpy(p, hdr->tzh_magic, sizeof(hdr->tzh_magic));
+	p += sizeof(hdr->tzh_magic);
+	*p++ = hdr->tzh_version;
+	memset(p, 0, sizeof(hdr->tzh_zero));
+	p += sizeof(hdr->tzh_zero);
+	p = tze_tz_put_u32(p, hdr->tzh_ttisgmtcnt);
+	p = tze_tz_put_u32(p, hdr->tzh_ttisstdcnt);
+	p = tze_tz_put_u32(p, hdr->tzh_leapcnt);
+	p = tze_tz_put_u32(p, hdr->tzh_timecnt);
+	p = tze_tz_put_u32(p, hdr->tzh_typecnt);
+	return tze_tz_put_u32(p, hdr->tzh_charcnt);
+}
+
+static int tze_tz_write_all(const int		  fd,
+							const char		 *const out_name,
+							const uint8_t	 *data,
+							size_t			  size,
+							struct tze_err_t *err)
+{
+	while (size > 0) {
+		const ssize_t n = write(fd, data, size);
+
+		if (n < 0) {
+			if (errno == EINTR || errno == EAGAIN) {
 				continue;
 			}
 
-			tze_err_set(err, 0, "%s: wrong transition type index "
-						"(%" PRIu8 " >= %" PRIu32 ")",
-						locality, indexes[i], hdr.tzh_typecnt);
-			goto close_fd;
+			tze_err_set(err, errno, "%s: unable to write", out_name);
+			return -1;
 		}
+
+		data += n;
+		size -= (size_t) n;
 	}
 
-	struct tze_tz_ttinfo_t ttinfo[TZE_TZ_TYPECNT_MAX];
-	const size_t ttinfo_count = (hdr.tzh_typecnt > 0) ? hdr.tzh_typecnt : 1;
+	return 0;
+}
 
-	if (hdr.tzh_typecnt == 0) {
-		ttinfo[0].tt_isdst = 0;
-		ttinfo[0].tt_gmtoff = 0;
-		ttinfo[0].tt_abbrind = 0; /* should be ignored */
-	} else {
-		if (tze_tz_read_all(fd, file_size, locality,
-							"transition time moments", ttinfo,
-							sizeof(ttinfo[0]) * ttinfo_count, err) < 0) {
-			goto close_fd;
+/**
+ * Checks that a footer rule yields the same transitions as the ones
+ * of a [first, last) range, an offset tells a DST start from its end
+ * as some zones mark a winter time as DST.
+ **/
+
+static bool tze_tz_slim_covered(const struct tze_tz_data_t *data,
+								const char				   *const locality,
+								const size_t				first,
+								const size_t				last)
+{
+	struct tze_rule_t parsed;
+	struct tze_err_t err = TZE_ERR_INIT;
+
+	if (tze_rule_parse(data->rule, locality, data->v3, &parsed, &err) < 0) {
+		return false;
+	}
+
+	for (size_t i = first; i < last; i++) {
+		const int64_t time = tze_tz_time(data, i);
+		const int32_t offset = tze_tz_gmtoff(data, data->indexes[i]);
+		const bool start = parsed.dst && offset == parsed.dst_offset;
+
+		if (!start && offset != parsed.std_offset) {
+			return false;
 		}
 
-		for (size_t i = 0; i < ttinfo_count; i++) {
-			struct tze_tz_ttinfo_t *info = &ttinfo[i];
+		if (!parsed.dst) {
+			continue;
+		}
 
-			info->tt_gmtoff = (int32_t) ntohl((uint32_t) info->tt_gmtoff);
+		const int32_t year = tze_rule_year_of(time);
+		bool found = false;
 
-			if (info->tt_gmtoff <= -TZE_TZ_MAX_OFFSET / 2 ||
-				info->tt_gmtoff >= +TZE_TZ_MAX_OFFSET / 2) {
-				tze_err_set(err, 0,
-							"%s: time offset %" PRIi32 " is out of range "
-							"(%i, %i)",
-							locality, info->tt_gmtoff,
-							+TZE_TZ_MAX_OFFSET / 2,
-							-TZE_TZ_MAX_OFFSET / 2);
-				goto close_fd;
-			}
+		/* a local date may be in an adjacent year */
+		for (int32_t y = year - 1; y <= year + 1 && !found; y++) {
+			found = (tze_rule_transition(&parsed, y, start) == time);
+		}
+
+		if (!found) {
+			return false;
 		}
 	}
 
-	const off_t tzh2_size = (off_t)
-		(sizeof(hdr) +
-		 hdr.tzh_timecnt * (sizeof(int64_t) + 1) +
-		 hdr.tzh_typecnt * sizeof(struct tze_tz_ttinfo_t) +
-		 hdr.tzh_charcnt +
-		 hdr.tzh_leapcnt * (sizeof(int64_t) + sizeof(uint32_t)) +
-		 hdr.tzh_ttisgmtcnt +
-		 hdr.tzh_ttisstdcnt);
-	const off_t rule_offs = tzh_offs + tzh2_size + 1;
-
-	if (rule_offs >= file_size) {
-		tze_err_set(err, 0, "%s: invalid rule offset: %zi",
-					locality, (ssize_t) rule_offs);
-		goto close_fd;
+	return true;
+}
+
+/**
+ * Keeps transitions of [from, until) plus the last one before the window
+ * which sets the type in effect at its start. Later transitions are
+ * dropped only when a footer rule covers them. Unused local time types
+ * and abbreviations are dropped as well, the v1 data block is reduced
+ * to a single placeholder type as zic(8) "-b slim" does.
+ **/
+
+int tze_tz_slim(const char		 *const file_name,
+				const char		 *const out_name,
+				const char		 *const locality,
+				const int64_t	  from,
+				const int64_t	  until,
+				struct tze_err_t *err)
+{
+	struct tze_tz_data_t data;
+	uint8_t *new_chars = NULL;
+	uint8_t *out = NULL;
+	int out_fd = -1;
+	const int ret = tze_tz_load(file_name, locality, &data, err);
+
+	if (ret != 0) {
+		return ret;
 	}
 
-	if (lseek(fd, rule_offs, SEEK_SET) < 0) {
-		tze_err_set(err, errno, "%s: unable to seek to read a rule",
-					locality);
-		goto close_fd;
+	/* a transition range to keep */
+	size_t lo = 0;
+	size_t hi = data.time_count;
+
+	while (lo + 1 < data.time_count && tze_tz_time(&data, lo + 1) <= from) {
+		lo++;
 	}
 
-	size_t rule_size = (size_t) (file_size - rule_offs);
-	char *rule_value = malloc(rule_size);
+	if (data.rule_size > 0) {
+		while (hi > lo && tze_tz_time(&data, hi - 1) >= until) {
+			hi--;
+		}
 
-	if (rule_value == NULL) {
-		tze_err_set(err, errno,
-					"%s: unable to allocate a rule buffer", locality);
-		goto close_fd;
+		if (!tze_tz_slim_covered(&data, locality, hi, data.time_count)) {
+			hi = data.time_count;
+		}
 	}
 
-	if (tze_tz_read_all_at(fd, file_size, locality, "a transition rule",
-						   rule_offs, rule_value, rule_size, err) < 0) {
-		goto free_rule;
+	/* type 0 applies before the first kept transition */
+	int type_map[TZE_TZ_TYPECNT_MAX];
+	uint8_t types[TZE_TZ_TYPECNT_MAX];
+	size_t new_type_count = 0;
+
+	for (size_t i = 0; i < data.type_count; i++) {
+		type_map[i] = -1;
 	}
 
-	rule_size--;
+	for (size_t i = lo; i <= hi; i++) {
+		const uint8_t type = (i == lo) ?
+			((lo == 0) ? 0 : data.indexes[lo - 1]) : data.indexes[i - 1];
 
-	if (rule_value[rule_size] != '\n') {
-		tze_err_set(err, 0, "%s: wrong rule trailer (0x%02" PRIx8 ")",
-					locality, rule_value[rule_size]);
-		goto free_rule;
+		if (type_map[type] < 0) {
+			type_map[type] = (int) new_type_count;
+			types[new_type_count++] = type;
+		}
 	}
 
-	rule_value[rule_size] = '\0';
+	/* abbreviations of kept types, shared when equal */
+	uint8_t new_abbrs[TZE_TZ_TYPECNT_MAX];
+	size_t new_char_count = 0;
 
-	for (size_t i = 0; i < rule_size; i++) {
-		const uint8_t c = (uint8_t) rule_value[i];
+	new_chars = malloc(new_type_count * data.char_count);
 
-		if (c > TZE_TZ_CHR_SPACE && c <= TZE_TZ_CHR_LAST) {
-			continue;
+	if (new_chars == NULL) {
+		tze_err_set(err, errno,
+					"%s: unable to allocate an abbreviation buffer",
+					locality);
+		goto fail;
+	}
+
+	for (size_t i = 0; i < new_type_count; i++) {
+		const char *const abbr = tze_tz_abbr(&data, types[i]);
+		size_t offs = 0;
+
+		while (offs < new_char_count &&
+			   strcmp((const char *) new_chars + offs, abbr) != 0) {
+			offs += strlen((const char *) new_chars + offs) + 1;
 		}
 
-		tze_err_set(err, 0, "%s: a rule has non-ASCII characters", locality);
-		goto free_rule;
+		if (offs > UINT8_MAX) {
+			tze_err_set(err, 0, "%s: too many abbreviations", locality);
+			goto fail;
+		}
+
+		if (offs == new_char_count) {
+			const size_t abbr_size = strlen(abbr) + 1;
+
+			memcpy(new_chars + offs, abbr, abbr_size);
+			new_char_count += abbr_size;
+		}
+
+		new_abbrs[i] = (uint8_t) offs;
 	}
 
-	*rule = rule_value;
-	*v3 = (hdr.tzh_version == TZE_TZ_VERSION_3);
+	const size_t new_time_count = hi - lo;
+	const size_t leaps_size = data.leap_count *
+		(sizeof(int64_t) + sizeof(uint32_t));
+	const size_t out_size =
+		2 * sizeof(struct tze_tz_header_t) + TZE_TZ_TTINFO_SIZE + 1 +
+		new_time_count * (sizeof(int64_t) + 1) +
+		new_type_count * (TZE_TZ_TTINFO_SIZE + 2) +
+		new_char_count + leaps_size + data.rule_size + 2;
 
-	tze_tz_close_fd(fd);
+	out = malloc(out_size);
+
+	if (out == NULL) {
+		tze_err_set(err, errno, "%s: unable to allocate an output buffer",
+					locality);
+		goto fail;
+	}
+
+	/* a v1 block of a single placeholder type */
+	struct tze_tz_header_t out_hdr = {
+		.tzh_magic		= { 'T', 'Z', 'i', 'f' },
+		.tzh_version	= data.v3 ? TZE_TZ_VERSION_3 : TZE_TZ_VERSION_2,
+		.tzh_ttisgmtcnt	= 0,
+		.tzh_ttisstdcnt	= 0,
+		.tzh_leapcnt	= 0,
+		.tzh_timecnt	= 0,
+		.tzh_typecnt	= 1,
+		.tzh_charcnt	= 1
+	};
+	uint8_t *p = tze_tz_put_header(out, &out_hdr);
+
+	memset(p, 0, TZE_TZ_TTINFO_SIZE + 1);
+	p += TZE_TZ_TTINFO_SIZE + 1;
+
+	out_hdr.tzh_ttisgmtcnt = (data.isgmt_count > 0) ?
+		(uint32_t) new_type_count : 0;
+	out_hdr.tzh_ttisstdcnt = (data.isstd_count > 0) ?
+		(uint32_t) new_type_count : 0;
+	out_hdr.tzh_leapcnt = (uint32_t) data.leap_count;
+	out_hdr.tzh_timecnt = (uint32_t) new_time_count;
+	out_hdr.tzh_typecnt = (uint32_t) new_type_count;
+	out_hdr.tzh_charcnt = (uint32_t) new_char_count;
+	p = tze_tz_put_header(p, &out_hdr);
+
+	memcpy(p, data.times + lo * sizeof(int64_t),
+		   new_time_count * sizeof(int64_t));
+	p += new_time_count * sizeof(int64_t);
+
+	for (size_t i = lo; i < hi; i++) {
+		*p++ = (uint8_t) type_map[data.indexes[i]];
+	}
+
+	for (size_t i = 0; i < new_type_count; i++) {
+		memcpy(p, data.ttinfo + types[i] * TZE_TZ_TTINFO_SIZE,
+			   TZE_TZ_TTINFO_SIZE);
+		p[sizeof(int32_t) + 1] = new_abbrs[i];
+		p += TZE_TZ_TTINFO_SIZE;
+	}
+
+	memcpy(p, new_chars, new_char_count);
+	p += new_char_count;
+	memcpy(p, data.leaps, leaps_size);
+	p += leaps_size;
+
+	for (size_t i = 0; i < out_hdr.tzh_ttisstdcnt; i++) {
+		*p++ = (types[i] < data.isstd_count) ? data.isstd[types[i]] : 0;
+	}
+
+	for (size_t i = 0; i < out_hdr.tzh_ttisgmtcnt; i++) {
+		*p++ = (types[i] < data.isgmt_count) ? data.isgmt[types[i]] : 0;
+	}
+
+	*p++ = '\n';
+	memcpy(p, data.rule, data.rule_size);
+	p += data.rule_size;
+	*p++ = '\n';
+
+	out_fd = open(out_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if (out_fd < 0) {
+		tze_err_set(err, errno, "%s: unable to create", out_name);
+		goto fail;
+	}
+
+	if (tze_tz_write_all(out_fd, out_name, out, (size_t) (p - out), err) < 0) {
+		goto fail;
+	}
+
+	if (close(out_fd) < 0) {
+		out_fd = -1;
+		tze_err_set(err, errno, "%s: unable to write", out_name);
+		goto fail;
+	}
+
+	free(out);
+	free(new_chars);
+	tze_tz_unload(&data);
 	return 0;
 
-free_rule:
-	free(rule_value);
+fail:
+	if (out_fd >= 0) {
+		tze_tz_close_fd(out_fd);
+	}
 
-close_fd:
-	tze_tz_close_fd(fd);
+	free(out);
+	free(new_chars);
+	tze_tz_unload(&data);
 	return -1;
 }
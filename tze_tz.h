@@ -1,15 +1,149 @@
 #ifndef TZE_TZ_H
 #define TZE_TZ_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 #include <stdbool.h>
+#include <arpa/inet.h>
+
+#define TZE_TZ_TTINFO_SIZE				(6)
 
 struct tze_err_t;
 
+/**
+ * A validated 64-bit data block of a TZif file, all pointers are
+ * to a single buffer holding big-endian data as it is on a disk.
+ **/
+
+#define TZE_TZ_DATA_INIT				\
+	{									\
+		.buf			= 0,			\
+		.v3				= false,		\
+		.time_count		= 0,			\
+		.type_count		= 0,			\
+		.char_count		= 0,			\
+		.leap_count		= 0,			\
+		.isstd_count	= 0,			\
+		.isgmt_count	= 0,			\
+		.rule_size		= 0				\
+	}
+
+struct tze_tz_data_t {
+	uint8_t		  *buf;
+	bool		   v3;
+	size_t		   time_count;
+	size_t		   type_count;
+	size_t		   char_count;
+	size_t		   leap_count;
+	size_t		   isstd_count;
+	size_t		   isgmt_count;
+	const uint8_t *times;				/* of int64_t					 */
+	const uint8_t *indexes;
+	const uint8_t *ttinfo;				/* of TZE_TZ_TTINFO_SIZE		 */
+	const char	  *chars;
+	const uint8_t *leaps;
+	const uint8_t *isstd;
+	const uint8_t *isgmt;
+	const char	  *rule;				/* NUL terminated footer		 */
+	size_t		   rule_size;
+};
+
+static inline int64_t tze_tz_time(const struct tze_tz_data_t *data,
+								  const size_t				  i)
+{
+	const uint8_t *p = data->times + i * sizeof(int64_t);
+	uint64_t v = 0;
+
+	for (size_t j = 0; j < sizeof(v); j++) {
+		v = (v << 8) | p[j];
+	}
+
+	return (int64_t) v;
+}
+
+static inline int32_t tze_tz_gmtoff(const struct tze_tz_data_t *data,
+									const size_t				type)
+{
+	uint32_t v;
+
+	memcpy(&v, data->ttinfo + type * TZE_TZ_TTINFO_SIZE, sizeof(v));
+	return (int32_t) ntohl(v);
+}
+
+static inline bool tze_tz_isdst(const struct tze_tz_data_t *data,
+								const size_t				type)
+{
+	return data->ttinfo[type * TZE_TZ_TTINFO_SIZE + sizeof(int32_t)] != 0;
+}
+
+static inline const char *tze_tz_abbr(const struct tze_tz_data_t *data,
+									  const size_t				  type)
+{
+	return data->chars +
+		data->ttinfo[type * TZE_TZ_TTINFO_SIZE + sizeof(int32_t) + 1];
+}
+
+/**
+ * Parses a TZif image in memory, e.g. a mapped or downloaded one, and
+ * finds its footer rule. A rule points into data and is not NUL
+ * terminated, nothing is copied or allocated. A locality only names
+ * data in messages. Returns 1 for an unknown format.
+ **/
+
+int tze_tz_parse(const void		  *const data,
+				 const size_t	   len,
+				 const char		  *const locality,
+				 const char		 **rule,
+				 size_t			  *rule_size,
+				 bool			  *v3,
+				 struct tze_err_t *err);
+
+/**
+ * Reads a whole file with a single read and parses it with
+ * tze_tz_parse(), a rule is a NUL terminated copy to free(3).
+ **/
+
 int tze_tz_read(const char		  *const file_name,
 				const char		  *const zone_name,
 				char			 **rule,
 				bool			  *v3,
 				struct tze_err_t  *err);
 
+/**
+ * Loads and validates a 64-bit data block, returns 1 for an unknown
+ * file format.
+ **/
+
+int tze_tz_load(const char			 *const file_name,
+				const char			 *const locality,
+				struct tze_tz_data_t *data,
+				struct tze_err_t	 *err);
+
+void tze_tz_unload(struct tze_tz_data_t *data);
+
+/**
+ * Finds a zone file of a locality in the latest root having it,
+ * a file name buffer should have PATH_MAX bytes.
+ **/
+
+int tze_tz_locate(const char *const *roots,
+				  const size_t		 root_count,
+				  const char		*const name,
+				  char				*file_name,
+				  struct tze_err_t	*err);
+
+/**
+ * Rewrites a TZif file into a slim one keeping transitions of
+ * a [from, until) window only, see tze_tz.c for details.
+ * Returns 1 for an unknown file format.
+ **/
+
+int tze_tz_slim(const char		 *const file_name,
+				const char		 *const out_name,
+				const char		 *const locality,
+				const int64_t	  from,
+				const int64_t	  until,
+				struct tze_err_t *err);
+
 #endif /* TZE_TZ_H */
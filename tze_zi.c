@@ -0,0 +1,1276 @@
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tze_zi.h"
+#include "tze_err.h"
+#include "tze_rule.h"
+#include "tze_scan.h"
+#include "tze_filter.h"
+
+#define TZE_ZI_NAME_MAX					PATH_MAX
+#define TZE_ZI_FORMAT_MAX				(TZE_RULE_ABBR_MAX)
+#define TZE_ZI_LINK_HOPS_MAX			(40)
+#define TZE_ZI_YEAR_MAX					INT32_MAX
+#define TZE_ZI_DEF_TIME					(2 * 3600)
+#define TZE_ZI_DATE_MAX					(64)
+
+enum tze_zi_dycode_t {
+	TZE_ZI_DOM,							/* a day of a month				 */
+	TZE_ZI_DOWGEQ,						/* a weekday on or after a day	 */
+	TZE_ZI_DOWLEQ						/* a weekday on or before a day	 */
+};
+
+struct tze_zi_field_t {
+	const char *p;						/* not NUL terminated			 */
+	size_t		size;
+};
+
+struct tze_zi_rule_t {
+	struct tze_zi_field_t name;
+	size_t				  order;		/* in a file					 */
+	int32_t				  hiyear;
+	bool				  hiwasnum;
+	int					  month;		/* 0-based						 */
+	enum tze_zi_dycode_t  dycode;
+	int					  dayofmonth;
+	int					  wday;
+	int32_t				  tod;
+	bool				  todisstd;
+	bool				  todisut;
+	int32_t				  save;
+	bool				  isdst;
+	struct tze_zi_field_t letters;
+};
+
+/**
+ * A last line of a zone, the only one a footer depends on.
+ **/
+
+struct tze_zi_zone_t {
+	struct tze_zi_field_t name;
+	struct tze_zi_field_t rules;
+	struct tze_zi_field_t format;
+	int32_t				  stdoff;
+	size_t				  line;
+	char				 *rule;			/* derived footer				 */
+};
+
+struct tze_zi_link_t {
+	struct tze_zi_field_t target;
+	struct tze_zi_field_t name;
+};
+
+struct tze_zi_t {
+	struct tze_zi_rule_t *rules;
+	size_t				  rule_count;
+	size_t				  rule_cap;
+	struct tze_zi_zone_t *zones;
+	size_t				  zone_count;
+	size_t				  zone_cap;
+	struct tze_zi_link_t *links;
+	size_t				  link_count;
+	size_t				  link_cap;
+};
+
+static const char *const TZE_ZI_MONTHS[] = {
+	"January", "February", "March", "April", "May", "June", "July",
+	"August", "September", "October", "November", "December", NULL
+};
+
+static const char *const TZE_ZI_WDAYS[] = {
+	"Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday",
+	"Saturday", NULL
+};
+
+static const char *const TZE_ZI_LINES[] = {
+	"Rule", "Zone", "Link", NULL
+};
+
+enum tze_zi_year_t {
+	TZE_ZI_YEAR_MIN,
+	TZE_ZI_YEAR_MAXIMUM,
+	TZE_ZI_YEAR_ONLY
+};
+
+static const char *const TZE_ZI_YEARS[] = {
+	"minimum", "maximum", "only", NULL
+};
+
+static const int TZE_ZI_MONTH_DAYS[] = {
+	31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
+
+static const int TZE_ZI_YEAR_DAYS[] = {
+	0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+};
+
+static bool tze_zi_equal(const struct tze_zi_field_t *f,
+						 const char					 *const str)
+{
+	return (strlen(str) == f->size && memcmp(f->p, str, f->size) == 0) ?
+		true : false;
+}
+
+static int tze_zi_field_compar(const struct tze_zi_field_t *l,
+							   const struct tze_zi_field_t *r)
+{
+	const int ret = memcmp(l->p, r->p, (l->size < r->size) ?
+						   l->size : r->size);
+
+	if (ret != 0) {
+		return ret;
+	}
+
+	return (l->size < r->size) ? -1 : (l->size > r->size) ? 1 : 0;
+}
+
+/**
+ * Looks a word up as zic(8) does: an exact match first, a unique
+ * case-insensitive prefix otherwise. Returns -1 when not found.
+ **/
+
+static int tze_zi_lookup(const struct tze_zi_field_t *f,
+						 const char *const			 *words)
+{
+	int found = -1;
+
+	if (f->size == 0) {
+		return -1;
+	}
+
+	for (int i = 0; words[i] != NULL; i++) {
+		if (strlen(words[i]) == f->size &&
+			strncasecmp(words[i], f->p, f->size) == 0) {
+			return i;
+		}
+	}
+
+	for (int i = 0; words[i] != NULL; i++) {
+		if (strlen(words[i]) > f->size &&
+			strncasecmp(words[i], f->p, f->size) == 0) {
+			if (found >= 0) {
+				return -1;
+			}
+
+			found = i;
+		}
+	}
+
+	return found;
+}
+
+static int tze_zi_number(const struct tze_zi_field_t *f,
+						 int32_t					 *v)
+{
+	const char *p = f->p;
+	const char *const end = f->p + f->size;
+	const bool negative = (p < end && *p == '-');
+	int64_t n = 0;
+
+	if (negative) {
+		p++;
+	}
+
+	if (p == end) {
+		return -1;
+	}
+
+	for (; p < end; p++) {
+		if (!isdigit((unsigned char) *p) || n > INT32_MAX / 10) {
+			return -1;
+		}
+
+		n = n * 10 + (*p - '0');
+	}
+
+	*v = (int32_t) (negative ? -n : n);
+
+	return 0;
+}
+
+/**
+ * Parses "[-]hh[:mm[:ss]]", a lone "-" means zero.
+ **/
+
+static int tze_zi_hms(const struct tze_zi_field_t *f,
+					  int32_t					  *secs)
+{
+	const char *p = f->p;
+	const char *const end = f->p + f->size;
+	const bool negative = (p < end && *p == '-');
+	int32_t parts[3] = { 0, 0, 0 };
+	size_t n = 0;
+
+	if (negative) {
+		p++;
+	}
+
+	if (p == end) {
+		*secs = 0;
+		return negative ? 0 : -1;
+	}
+
+	while (n < 3) {
+		const char *const start = p;
+		int32_t v = 0;
+
+		for (; p < end && isdigit((unsigned char) *p); p++) {
+			if (v > 1000000) {
+				return -1;
+			}
+
+			v = v * 10 + (*p - '0');
+		}
+
+		if (p == start) {
+			return -1;
+		}
+
+		parts[n++] = v;
+
+		if (p == end) {
+			break;
+		}
+
+		if (*p++ != ':') {
+			return -1;
+		}
+	}
+
+	if (p != end || parts[0] > 24 * 7 || parts[1] >= 60 || parts[2] >= 60) {
+		return -1;
+	}
+
+	const int32_t t = parts[0] * 3600 + parts[1] * 60 + parts[2];
+
+	*secs = negative ? -t : t;
+
+	return 0;
+}
+
+/**
+ * Splits a line into whitespace separated fields up to a comment,
+ * returns a field count or -1 for too many fields.
+ **/
+
+static int tze_zi_split(const char			  *p,
+						const char			  *const end,
+						struct tze_zi_field_t *fields)
+{
+	int n = 0;
+
+	while (p < end) {
+		if (isspace((unsigned char) *p)) {
+			p++;
+			continue;
+		}
+
+		if (*p == '#') {
+			break;
+		}
+
+		if (n == TZE_ZI_FIELD_MAX) {
+			return -1;
+		}
+
+		const char *const start = p;
+
+		while (p < end && !isspace((unsigned char) *p) && *p != '#') {
+			p++;
+		}
+
+		fields[n].p = start;
+		fields[n].size = (size_t) (p - start);
+		n++;
+	}
+
+	return n;
+}
+
+static void *tze_zi_grow(void	*items,
+						 size_t	*cap,
+						 size_t	 count,
+						 size_t	 item_size)
+{
+	if (count < *cap) {
+		return items;
+	}
+
+	const size_t new_cap = (*cap == 0) ? 64 : *cap * 2;
+	void *grown = realloc(items, new_cap * item_size);
+
+	if (grown != NULL) {
+		*cap = new_cap;
+	}
+
+	return grown;
+}
+
+/**
+ * Parses "R NAME FROM TO - IN ON AT SAVE LETTER".
+ **/
+
+static int tze_zi_rule_line(struct tze_zi_t				*zi,
+							const struct tze_zi_field_t *fields,
+							const int					 count)
+{
+	if (count != 10) {
+		return -1;
+	}
+
+	struct tze_zi_rule_t *grown = tze_zi_grow(zi->rules, &zi->rule_cap,
+											  zi->rule_count,
+											  sizeof(*zi->rules));
+
+	if (grown == NULL) {
+		return -2;
+	}
+
+	zi->rules = grown;
+
+	struct tze_zi_rule_t *r = &zi->rules[zi->rule_count];
+	const struct tze_zi_field_t *on = &fields[6];
+	const struct tze_zi_field_t *at = &fields[7];
+	const struct tze_zi_field_t *save = &fields[8];
+	int32_t loyear = 0;
+	int word;
+
+	r->name = fields[1];
+	r->order = zi->rule_count;
+
+	word = tze_zi_lookup(&fields[2], TZE_ZI_YEARS);
+
+	if (word < 0 && tze_zi_number(&fields[2], &loyear) < 0) {
+		return -1;
+	}
+
+	if (word != -1 && word != TZE_ZI_YEAR_MIN) {
+		return -1;
+	}
+
+	word = tze_zi_lookup(&fields[3], TZE_ZI_YEARS);
+	r->hiwasnum = false;
+
+	if (word == TZE_ZI_YEAR_MAXIMUM) {
+		r->hiyear = TZE_ZI_YEAR_MAX;
+	} else if (word == TZE_ZI_YEAR_ONLY) {
+		r->hiyear = loyear;
+	} else if (word < 0 && tze_zi_number(&fields[3], &r->hiyear) == 0) {
+		r->hiwasnum = true;
+	} else {
+		return -1;
+	}
+
+	r->month = tze_zi_lookup(&fields[5], TZE_ZI_MONTHS);
+
+	if (r->month < 0) {
+		return -1;
+	}
+
+	const char *const lt = memchr(on->p, '<', on->size);
+	const char *const gt = memchr(on->p, '>', on->size);
+
+	if (on->size > 4 && strncasecmp(on->p, "last", 4) == 0) {
+		const struct tze_zi_field_t wday = { on->p + 4, on->size - 4 };
+
+		r->dycode = TZE_ZI_DOWLEQ;
+		r->wday = tze_zi_lookup(&wday, TZE_ZI_WDAYS);
+		r->dayofmonth = TZE_ZI_MONTH_DAYS[r->month];
+	} else if (lt != NULL || gt != NULL) {
+		const char *const op = (lt != NULL) ? lt : gt;
+		const struct tze_zi_field_t wday = { on->p, (size_t) (op - on->p) };
+		const char *const end = on->p + on->size;
+		struct tze_zi_field_t day = { op + 2, 0 };
+		int32_t v;
+
+		if (op + 1 >= end || op[1] != '=') {
+			return -1;
+		}
+
+		day.size = (size_t) (end - day.p);
+		r->dycode = (lt != NULL) ? TZE_ZI_DOWLEQ : TZE_ZI_DOWGEQ;
+		r->wday = tze_zi_lookup(&wday, TZE_ZI_WDAYS);
+
+		if (tze_zi_number(&day, &v) < 0) {
+			return -1;
+		}
+
+		r->dayofmonth = (int) v;
+	} else {
+		int32_t v;
+
+		if (tze_zi_number(on, &v) < 0) {
+			return -1;
+		}
+
+		r->dycode = TZE_ZI_DOM;
+		r->wday = 0;
+		r->dayofmonth = (int) v;
+	}
+
+	if (r->wday < 0 || r->dayofmonth <= 0 ||
+		r->dayofmonth > TZE_ZI_MONTH_DAYS[r->month]) {
+		return -1;
+	}
+
+	struct tze_zi_field_t tod = *at;
+
+	r->todisstd = false;
+	r->todisut = false;
+
+	if (tod.size > 0) {
+		switch (tod.p[tod.size - 1]) {
+		case 'w':
+			tod.size--;
+			break;
+
+		case 's':
+			r->todisstd = true;
+			tod.size--;
+			break;
+
+		case 'u':
+		case 'g':
+		case 'z':
+			r->todisstd = true;
+			r->todisut = true;
+			tod.size--;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	if (tze_zi_hms(&tod, &r->tod) < 0) {
+		return -1;
+	}
+
+	struct tze_zi_field_t save_hms = *save;
+	int dst = -1;
+
+	if (save_hms.size > 0) {
+		if (save_hms.p[save_hms.size - 1] == 'd') {
+			dst = 1;
+			save_hms.size--;
+		} else if (save_hms.p[save_hms.size - 1] == 's') {
+			dst = 0;
+			save_hms.size--;
+		}
+	}
+
+	if (tze_zi_hms(&save_hms, &r->save) < 0) {
+		return -1;
+	}
+
+	r->isdst = (dst < 0) ? (r->save != 0) : (dst != 0);
+	r->letters = fields[9];
+
+	if (tze_zi_equal(&r->letters, "-")) {
+		r->letters.size = 0;
+	}
+
+	zi->rule_count++;
+
+	return 0;
+}
+
+/**
+ * Keeps a zone line, returns 1 when an UNTIL column follows
+ * and a continuation line is expected.
+ **/
+
+static int tze_zi_zone_line(struct tze_zi_t				*zi,
+							const struct tze_zi_field_t *name,
+							const struct tze_zi_field_t *fields,
+							const int					 count,
+							const size_t				 line)
+{
+	if (count < 3) {
+		return -1;
+	}
+
+	if (count > 3) {
+		return 1;
+	}
+
+	struct tze_zi_zone_t *grown = tze_zi_grow(zi->zones, &zi->zone_cap,
+											  zi->zone_count,
+											  sizeof(*zi->zones));
+
+	if (grown == NULL) {
+		return -2;
+	}
+
+	zi->zones = grown;
+
+	struct tze_zi_zone_t *z = &zi->zones[zi->zone_count];
+
+	if (tze_zi_hms(&fields[0], &z->stdoff) < 0 ||
+		fields[2].size > TZE_ZI_FORMAT_MAX) {
+		return -1;
+	}
+
+	z->name = *name;
+	z->rules = fields[1];
+	z->format = fields[2];
+	z->line = line;
+	z->rule = NULL;
+	zi->zone_count++;
+
+	return 0;
+}
+
+static int tze_zi_link_line(struct tze_zi_t				*zi,
+							const struct tze_zi_field_t *fields,
+							const int					 count)
+{
+	if (count != 3) {
+		return -1;
+	}
+
+	struct tze_zi_link_t *grown = tze_zi_grow(zi->links, &zi->link_cap,
+											  zi->link_count,
+											  sizeof(*zi->links));
+
+	if (grown == NULL) {
+		return -2;
+	}
+
+	zi->links = grown;
+	zi->links[zi->link_count].target = fields[1];
+	zi->links[zi->link_count].name = fields[2];
+	zi->link_count++;
+
+	return 0;
+}
+
+static int tze_zi_parse(struct tze_zi_t  *zi,
+						const char		 *data,
+						const size_t	  size,
+						struct tze_err_t *err)
+{
+	const char *p = data;
+	const char *const end = data + size;
+	struct tze_zi_field_t zone_name = { NULL, 0 };
+	bool continuation = false;
+	size_t line = 0;
+
+	while (p < end) {
+		const char *eol = memchr(p, '\n', (size_t) (end - p));
+
+		if (eol == NULL) {
+			eol = end;
+		}
+
+		struct tze_zi_field_t fields[TZE_ZI_FIELD_MAX];
+		const int count = tze_zi_split(p, eol, fields);
+		int ret = 0;
+
+		line++;
+		p = eol + 1;
+
+		if (count < 0) {
+			ret = -1;
+		} else if (count == 0) {
+			continue;
+		} else if (continuation) {
+			ret = tze_zi_zone_line(zi, &zone_name, fields, count, line);
+			continuation = (ret == 1);
+		} else {
+			switch (tze_zi_lookup(&fields[0], TZE_ZI_LINES)) {
+			case 0:
+				ret = tze_zi_rule_line(zi, fields, count);
+				break;
+
+			case 1:
+				if (count < 2) {
+					ret = -1;
+					break;
+				}
+
+				zone_name = fields[1];
+				ret = tze_zi_zone_line(zi, &zone_name, fields + 2,
+									   count - 2, line);
+				continuation = (ret == 1);
+				break;
+
+			case 2:
+				ret = tze_zi_link_line(zi, fields, count);
+				break;
+
+			default:
+				ret = -1;
+				break;
+			}
+		}
+
+		if (ret == -2) {
+			tze_err_set(err, ENOMEM, "unable to allocate zic input data");
+			return -1;
+		}
+
+		if (ret < 0) {
+			tze_err_set(err, 0, "line %zu: invalid zic input line", line);
+			return -1;
+		}
+	}
+
+	if (continuation) {
+		tze_err_set(err, 0, "line %zu: a zone continuation line expected",
+					line);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int tze_zi_rule_compar(const void *l,
+							  const void *r)
+{
+	const struct tze_zi_rule_t *lr = l;
+	const struct tze_zi_rule_t *rr = r;
+	const int ret = tze_zi_field_compar(&lr->name, &rr->name);
+
+	if (ret != 0) {
+		return ret;
+	}
+
+	return (lr->order < rr->order) ? -1 : (lr->order > rr->order) ? 1 : 0;
+}
+
+static int tze_zi_zone_compar(const void *l,
+							  const void *r)
+{
+	return tze_zi_field_compar(&((const struct tze_zi_zone_t *) l)->name,
+							   &((const struct tze_zi_zone_t *) r)->name);
+}
+
+static int tze_zi_link_compar(const void *l,
+							  const void *r)
+{
+	return tze_zi_field_compar(&((const struct tze_zi_link_t *) l)->name,
+							   &((const struct tze_zi_link_t *) r)->name);
+}
+
+/**
+ * Finds rules of a name in a sorted rule array.
+ **/
+
+static const struct tze_zi_rule_t *
+tze_zi_find_rules(const struct tze_zi_t		  *zi,
+				  const struct tze_zi_field_t *name,
+				  size_t					  *count)
+{
+	size_t lo = 0;
+	size_t hi = zi->rule_count;
+
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+
+		if (tze_zi_field_compar(&zi->rules[mid].name, name) < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	*count = 0;
+
+	while (lo + *count < zi->rule_count &&
+		   tze_zi_field_compar(&zi->rules[lo + *count].name, name) == 0) {
+		(*count)++;
+	}
+
+	return &zi->rules[lo];
+}
+
+/**
+ * Orders rules as zic(8) does when it looks for a latest one.
+ **/
+
+static int tze_zi_latest_compar(const struct tze_zi_rule_t *a,
+								const struct tze_zi_rule_t *b)
+{
+	if (a == NULL) {
+		return (b == NULL) ? 0 : -1;
+	}
+
+	if (b == NULL) {
+		return 1;
+	}
+
+	if (a->hiyear != b->hiyear) {
+		return (a->hiyear < b->hiyear) ? -1 : 1;
+	}
+
+	if (a->hiyear == TZE_ZI_YEAR_MAX) {
+		return 0;
+	}
+
+	if (a->month != b->month) {
+		return a->month - b->month;
+	}
+
+	return a->dayofmonth - b->dayofmonth;
+}
+
+static int tze_zi_append(char		  *buf,
+						 const size_t  size,
+						 size_t		  *len,
+						 const char	  *const str)
+{
+	const size_t n = strlen(str);
+
+	if (*len + n >= size) {
+		return -1;
+	}
+
+	memcpy(buf + *len, str, n + 1);
+	*len += n;
+
+	return 0;
+}
+
+/**
+ * Formats an offset as zic(8) does for a rule, i.e. in the shortest
+ * "[-]h[:mm[:ss]]" form.
+ **/
+
+static void tze_zi_format_offset(int32_t  offset,
+								 char	 *buf,
+								 size_t	  size)
+{
+	const char *sign = "";
+
+	if (offset < 0) {
+		offset = -offset;
+		sign = "-";
+	}
+
+	if (offset % 60 != 0) {
+		snprintf(buf, size, "%s%" PRId32 ":%02" PRId32 ":%02" PRId32,
+				 sign, offset / 3600, offset / 60 % 60, offset % 60);
+	} else if (offset / 60 % 60 != 0) {
+		snprintf(buf, size, "%s%" PRId32 ":%02" PRId32,
+				 sign, offset / 3600, offset / 60 % 60);
+	} else {
+		snprintf(buf, size, "%s%" PRId32, sign, offset / 3600);
+	}
+}
+
+/**
+ * Expands a zone format into an abbreviation quoted when needed:
+ * "A/B" pairs, "%s" letters and "%z" numeric offsets.
+ **/
+
+static int tze_zi_abbr(const struct tze_zi_zone_t  *z,
+					   const struct tze_zi_field_t *letters,
+					   const bool					isdst,
+					   const int32_t				save,
+					   char						   *buf,
+					   const size_t					size,
+					   size_t					   *len)
+{
+	char abbr[TZE_RULE_ABBR_MAX + 1];
+	const char *p = z->format.p;
+	const char *end = p + z->format.size;
+	const char *const slash = memchr(p, '/', z->format.size);
+	size_t n = 0;
+
+	if (slash != NULL) {
+		if (isdst) {
+			p = slash + 1;
+		} else {
+			end = slash;
+		}
+	}
+
+	for (; p < end; p++) {
+		char sub[TZE_RULE_ABBR_MAX + 1];
+		const char *s = sub;
+
+		if (*p != '%') {
+			sub[0] = *p;
+			sub[1] = '\0';
+		} else if (p + 1 < end && p[1] == 's' && slash == NULL) {
+			if (letters->size > TZE_RULE_ABBR_MAX) {
+				return -1;
+			}
+
+			memcpy(sub, letters->p, letters->size);
+			sub[letters->size] = '\0';
+			p++;
+		} else if (p + 1 < end && p[1] == 'z' && slash == NULL) {
+			int32_t offset = z->stdoff + save;
+			const char sign = (offset < 0) ? '-' : '+';
+
+			offset = (offset < 0) ? -offset : offset;
+
+			if (offset / 3600 >= 100) {
+				return -1;
+			}
+
+			if (offset % 60 != 0) {
+				snprintf(sub, sizeof(sub),
+						 "%c%02" PRId32 "%02" PRId32 "%02" PRId32,
+						 sign, offset / 3600, offset / 60 % 60, offset % 60);
+			} else if (offset / 60 % 60 != 0) {
+				snprintf(sub, sizeof(sub), "%c%02" PRId32 "%02" PRId32,
+						 sign, offset / 3600, offset / 60 % 60);
+			} else {
+				snprintf(sub, sizeof(sub), "%c%02" PRId32,
+						 sign, offset / 3600);
+			}
+
+			p++;
+		} else {
+			return -1;
+		}
+
+		for (; *s != '\0'; s++) {
+			if (n == TZE_RULE_ABBR_MAX) {
+				return -1;
+			}
+
+			abbr[n++] = *s;
+		}
+	}
+
+	abbr[n] = '\0';
+
+	bool alpha = (n > 0);
+
+	for (size_t i = 0; i < n; i++) {
+		if (!isalpha((unsigned char) abbr[i])) {
+			alpha = false;
+			break;
+		}
+	}
+
+	return (tze_zi_append(buf, size, len, alpha ? "" : "<") < 0 ||
+			tze_zi_append(buf, size, len, abbr) < 0 ||
+			tze_zi_append(buf, size, len, alpha ? "" : ">") < 0) ? -1 : 0;
+}
+
+/**
+ * Formats a transition date and a time of a rule, the time is local
+ * to a period ending at it, see stringrule() of zic(8).
+ **/
+
+static int tze_zi_date(const struct tze_zi_rule_t *r,
+					   const int32_t			   save,
+					   const int32_t			   stdoff,
+					   char						  *buf,
+					   const size_t				   size,
+					   size_t					  *len)
+{
+	char date[TZE_ZI_DATE_MAX];
+	int32_t tod = r->tod;
+
+	if (r->dycode == TZE_ZI_DOM) {
+		const int total = TZE_ZI_YEAR_DAYS[r->month];
+
+		if (r->month == 1 && r->dayofmonth == 29) {
+			return -1;
+		}
+
+		/* "J" is omitted in January and February, it is shorter */
+		if (r->month <= 1) {
+			snprintf(date, sizeof(date), ",%d", total + r->dayofmonth - 1);
+		} else {
+			snprintf(date, sizeof(date), ",J%d", total + r->dayofmonth);
+		}
+	} else {
+		int wday = r->wday;
+		int week;
+
+		if (r->dycode == TZE_ZI_DOWGEQ) {
+			const int wdayoff = (r->dayofmonth - 1) % 7;
+
+			wday -= wdayoff;
+			tod += wdayoff * 86400;
+			week = 1 + (r->dayofmonth - 1) / 7;
+		} else if (r->dayofmonth == TZE_ZI_MONTH_DAYS[r->month]) {
+			week = 5;
+		} else {
+			const int wdayoff = r->dayofmonth % 7;
+
+			wday -= wdayoff;
+			tod += wdayoff * 86400;
+			week = r->dayofmonth / 7;
+		}
+
+		if (wday < 0) {
+			wday += 7;
+		}
+
+		snprintf(date, sizeof(date), ",M%d.%d.%d", r->month + 1, week, wday);
+	}
+
+	if (tze_zi_append(buf, size, len, date) < 0) {
+		return -1;
+	}
+
+	if (r->todisut) {
+		tod += stdoff;
+	}
+
+	if (r->todisstd && !r->isdst) {
+		tod += save;
+	}
+
+	if (tod != TZE_ZI_DEF_TIME) {
+		char time[TZE_RULE_TIME_MAX];
+
+		tze_zi_format_offset(tod, time, sizeof(time));
+
+		if (tze_zi_append(buf, size, len, "/") < 0 ||
+			tze_zi_append(buf, size, len, time) < 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Derives a footer rule of a zone as stringzone() of zic(8) does:
+ * two rules running through a maximum year give DST, otherwise
+ * a latest rule gives standard time or perpetual DST.
+ **/
+
+static int tze_zi_footer(const struct tze_zi_t		*zi,
+						 const struct tze_zi_zone_t *z,
+						 char						*buf,
+						 const size_t				 size)
+{
+	const struct tze_zi_field_t none = { "", 0 };
+	const struct tze_zi_rule_t *rules = NULL;
+	const struct tze_zi_rule_t *stdrp = NULL;
+	const struct tze_zi_rule_t *dstrp = NULL;
+	struct tze_zi_rule_t stdr, dstr;
+	size_t rule_count = 0;
+	bool fixed_dst = false;
+	size_t len = 0;
+
+	buf[0] = '\0';
+
+	if (!tze_zi_equal(&z->rules, "-")) {
+		rules = tze_zi_find_rules(zi, &z->rules, &rule_count);
+	}
+
+	if (rule_count == 0 && rules != NULL) {
+		/* a fixed amount of saved time */
+		struct tze_zi_field_t save = z->rules;
+		int32_t secs;
+		int dst = -1;
+
+		if (save.size > 0 && (save.p[save.size - 1] == 'd' ||
+							  save.p[save.size - 1] == 's')) {
+			dst = (save.p[save.size - 1] == 'd');
+			save.size--;
+		}
+
+		if (tze_zi_hms(&save, &secs) < 0) {
+			return -1;
+		}
+
+		fixed_dst = (dst < 0) ? (secs != 0) : (dst != 0);
+	}
+
+	for (size_t i = 0; i < rule_count; i++) {
+		const struct tze_zi_rule_t *r = &rules[i];
+
+		if (r->hiwasnum || r->hiyear != TZE_ZI_YEAR_MAX) {
+			continue;
+		}
+
+		const struct tze_zi_rule_t **rp = r->isdst ? &dstrp : &stdrp;
+
+		if (*rp != NULL) {
+			return -1;
+		}
+
+		*rp = r;
+	}
+
+	if (stdrp == NULL && dstrp == NULL) {
+		const struct tze_zi_rule_t *stdabbrrp = NULL;
+
+		for (size_t i = 0; i < rule_count; i++) {
+			const struct tze_zi_rule_t *r = &rules[i];
+
+			if (!r->isdst && tze_zi_latest_compar(stdabbrrp, r) < 0) {
+				stdabbrrp = r;
+			}
+
+			if (tze_zi_latest_compar(stdrp, r) < 0) {
+				stdrp = r;
+			}
+		}
+
+		if (stdrp != NULL && stdrp->isdst) {
+			/* perpetual DST, from January 1 to December 31 24:00 */
+			dstr = *stdrp;
+			dstr.month = 0;
+			dstr.dycode = TZE_ZI_DOM;
+			dstr.dayofmonth = 1;
+			dstr.tod = 0;
+			dstr.todisstd = false;
+			dstr.todisut = false;
+			stdr = dstr;
+			stdr.month = 11;
+			stdr.dayofmonth = 31;
+			stdr.tod = 86400 + stdrp->save;
+			stdr.isdst = false;
+			stdr.save = 0;
+			stdr.letters = (stdabbrrp != NULL) ? stdabbrrp->letters : none;
+			dstrp = &dstr;
+			stdrp = &stdr;
+		}
+	}
+
+	if (stdrp == NULL && (rule_count != 0 || fixed_dst)) {
+		return -1;
+	}
+
+	char offset[TZE_RULE_TIME_MAX];
+
+	if (tze_zi_abbr(z, (stdrp == NULL) ? &none : &stdrp->letters,
+					false, 0, buf, size, &len) < 0) {
+		return -1;
+	}
+
+	tze_zi_format_offset(-z->stdoff, offset, sizeof(offset));
+
+	if (tze_zi_append(buf, size, &len, offset) < 0) {
+		return -1;
+	}
+
+	if (dstrp == NULL) {
+		return 0;
+	}
+
+	if (tze_zi_abbr(z, &dstrp->letters, dstrp->isdst, dstrp->save,
+					buf, size, &len) < 0) {
+		return -1;
+	}
+
+	if (dstrp->save != 3600) {
+		tze_zi_format_offset(-(z->stdoff + dstrp->save),
+							 offset, sizeof(offset));
+
+		if (tze_zi_append(buf, size, &len, offset) < 0) {
+			return -1;
+		}
+	}
+
+	if (tze_zi_date(dstrp, dstrp->save, z->stdoff, buf, size, &len) < 0 ||
+		tze_zi_date(stdrp, dstrp->save, z->stdoff, buf, size, &len) < 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+static int tze_zi_name(const struct tze_zi_field_t *f,
+					   char						   *name)
+{
+	if (f->size > TZE_ZI_NAME_MAX) {
+		return -1;
+	}
+
+	memcpy(name, f->p, f->size);
+	name[f->size] = '\0';
+
+	return 0;
+}
+
+/**
+ * Finds a rule of a link target following link chains.
+ **/
+
+static const char *tze_zi_link_rule(const struct tze_zi_t	   *zi,
+									const struct tze_zi_link_t *link)
+{
+	struct tze_zi_field_t target = link->target;
+
+	for (size_t hops = 0; hops < TZE_ZI_LINK_HOPS_MAX; hops++) {
+		const struct tze_zi_zone_t key_zone = { .name = target };
+		const struct tze_zi_link_t key_link = { .name = target };
+		const struct tze_zi_zone_t *z = (zi->zone_count == 0) ? NULL :
+			bsearch(&key_zone, zi->zones, zi->zone_count,
+					sizeof(*zi->zones), tze_zi_zone_compar);
+
+		if (z != NULL) {
+			return z->rule;
+		}
+
+		const struct tze_zi_link_t *next =
+			bsearch(&key_link, zi->links, zi->link_count,
+					sizeof(*zi->links), tze_zi_link_compar);
+
+		if (next == NULL) {
+			return NULL;
+		}
+
+		target = next->target;
+	}
+
+	return NULL;
+}
+
+static int tze_zi_add(struct tze_zi_t	*zi,
+					  struct tze_root_t *root,
+					  struct tze_err_t	*err)
+{
+	const struct tze_filter_t *filter = &root->conf->filter;
+	char name[TZE_ZI_NAME_MAX + 1];
+	char target[TZE_ZI_NAME_MAX + 1];
+
+	if (zi->rule_count > 0) {
+		qsort(zi->rules, zi->rule_count, sizeof(*zi->rules),
+			  tze_zi_rule_compar);
+	}
+
+	for (size_t i = 0; i < zi->zone_count; i++) {
+		struct tze_zi_zone_t *z = &zi->zones[i];
+		char rule[TZE_RULE_MAX];
+
+		if (tze_zi_name(&z->name, name) < 0) {
+			tze_err_set(err, 0, "line %zu: a zone name is too long", z->line);
+			return -1;
+		}
+
+		if (tze_zi_footer(zi, z, rule, sizeof(rule)) < 0 || *rule == '\0') {
+			tze_err_set(err, 0, "%s: unable to derive a timezone rule", name);
+			return -1;
+		}
+
+		z->rule = strdup(rule);
+
+		if (z->rule == NULL) {
+			tze_err_set(err, errno, "%s: unable to allocate a rule", name);
+			return -1;
+		}
+
+		if (tze_filter_path(filter, name) &&
+			tze_root_add(root, name, NULL, z->rule, true, err) < 0) {
+			return -1;
+		}
+	}
+
+	if (zi->link_count == 0) {
+		return 0;
+	}
+
+	if (zi->zone_count > 0) {
+		qsort(zi->zones, zi->zone_count, sizeof(*zi->zones),
+			  tze_zi_zone_compar);
+	}
+
+	qsort(zi->links, zi->link_count, sizeof(*zi->links), tze_zi_link_compar);
+
+	for (size_t i = 0; i < zi->link_count; i++) {
+		const struct tze_zi_link_t *link = &zi->links[i];
+
+		if (tze_zi_name(&link->name, name) < 0 ||
+			tze_zi_name(&link->target, target) < 0) {
+			tze_err_set(err, 0, "a link name is too long");
+			return -1;
+		}
+
+		if (!tze_filter_path(filter, name)) {
+			continue;
+		}
+
+		const char *const rule = tze_zi_link_rule(zi, link);
+
+		if (rule == NULL) {
+			tze_err_set(err, 0, "%s: no \"%s\" target found", name, target);
+			return -1;
+		}
+
+		if (tze_root_add(root, name, target, rule, true, err) < 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int tze_zi_scan(struct tze_root_t *root,
+				struct tze_err_t  *err)
+{
+	struct tze_zi_t zi = {
+		.rules		= NULL,
+		.rule_count	= 0,
+		.rule_cap	= 0,
+		.zones		= NULL,
+		.zone_count	= 0,
+		.zone_cap	= 0,
+		.links		= NULL,
+		.link_count	= 0,
+		.link_cap	= 0
+	};
+	struct stat st;
+	void *data = MAP_FAILED;
+	int ret = -1;
+	const int fd = open(root->dir, O_RDONLY | O_CLOEXEC);
+
+	if (fd < 0) {
+		tze_err_set(err, errno, "unable to open zic input");
+		return -1;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		tze_err_set(err, errno, "unable to stat zic input");
+		goto close_fd;
+	}
+
+	if (st.st_size > 0) {
+		data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+		if (data == MAP_FAILED) {
+			tze_err_set(err, errno, "unable to map zic input");
+			goto close_fd;
+		}
+
+		/* a single sequential pass */
+		posix_madvise(data, (size_t) st.st_size, POSIX_MADV_SEQUENTIAL);
+
+		if (tze_zi_parse(&zi, data, (size_t) st.st_size, err) < 0) {
+			goto unmap;
+		}
+	}
+
+	ret = tze_zi_add(&zi, root, err);
+
+unmap:
+	if (data != MAP_FAILED) {
+		munmap(data, (size_t) st.st_size);
+	}
+
+	for (size_t i = 0; i < zi.zone_count; i++) {
+		free(zi.zones[i].rule);
+	}
+
+	free(zi.rules);
+	free(zi.zones);
+	free(zi.links);
+
+close_fd:
+	close(fd);
+	return ret;
+}
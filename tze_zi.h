@@ -0,0 +1,25 @@
+#ifndef TZE_ZI_H
+#define TZE_ZI_H
+
+/**
+ * Reads zic(8) source text, e.g. a tzdata.zi file, in place of
+ * a compiled tree. Zone and Rule lines give every zone a footer rule
+ * derived the same way zic(8) does for a last zone line, Link lines
+ * give links. Keywords, months and weekdays may be abbreviated
+ * as zic(8) allows, quoted fields are not supported.
+ **/
+
+#define TZE_ZI_FIELD_MAX				(16)
+
+struct tze_err_t;
+struct tze_root_t;
+
+/**
+ * Reads a root file with a single sequential pass over its mapping,
+ * localities and links are added as a directory scan does.
+ **/
+
+int tze_zi_scan(struct tze_root_t *root,
+				struct tze_err_t  *err);
+
+#endif /* TZE_ZI_H */